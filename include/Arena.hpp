@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+// One allocation made up front, carved into cache-line aligned arrays and
+// freed in one go. Nothing is destroyed individually, so only trivially
+// destructible types may live in it.
+class Arena {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    // Bytes an array of `count` T takes in the arena, padding included
+    template <typename T>
+    static constexpr size_t footprint(size_t count) {
+        return (sizeof(T) * count + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    explicit Arena(size_t bytes)
+        : base(static_cast<unsigned char*>(::operator new(bytes ? bytes : kAlignment, std::align_val_t(kAlignment))))
+        , size(bytes)
+        , used(0)
+    {}
+    ~Arena() { ::operator delete(base, std::align_val_t(kAlignment)); }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Value-initialised array of `count` T; throws std::bad_alloc when the arena is full
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena never runs destructors");
+        size_t bytes = footprint<T>(count);
+        if (bytes > size - used) {
+            throw std::bad_alloc();
+        }
+        T* first = reinterpret_cast<T*>(base + used);
+        for (size_t i = 0; i < count; ++i) {
+            new (first + i) T();
+        }
+        used += bytes;
+        return first;
+    }
+
+    size_t capacity() const { return size; }
+    size_t bytesUsed() const { return used; }
+
+private:
+    unsigned char* base;
+    size_t size;
+    size_t used;
+};
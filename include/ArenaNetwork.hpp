@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "Arena.hpp"
+#include "Clock.hpp"
+#include "ControllerParams.hpp"
+#include "TrafficLight.hpp"
+
+using ArenaIntersection = uint32_t;
+using ArenaLane = uint32_t;
+
+// A whole network's lanes, lights and controller state in one Arena, as
+// parallel arrays indexed by handle. It is the counterpart of a set of
+// Intersection objects for very large simulations. There are no ids,
+// mutexes or per-object heap allocations, and decisions match the greedy
+// policy of Intersection (see GreedyPolicy.hpp). Capacity is fixed at
+// construction. An intersection's lanes are contiguous, so lanes are added
+// to the most recently added intersection.
+//
+// Differences from Intersection: one control tick per step for the whole
+// network, and a switch completes within the tick (yellow is not simulated).
+// Only the greedy policy is supported, without demand-horizon sizing.
+// Smoothed occupancy is kept in float, so with smoothOccupancy (the default)
+// lanes whose occupancies nearly tie may be chosen differently; decisions
+// match exactly on the raw occupancy.
+// Not thread-safe: one caller feeds events and steps.
+class ArenaNetwork {
+public:
+    static constexpr size_t kMaxLanesPerIntersection = 64;
+
+    // Throws std::invalid_argument for zero capacities or unsupported params
+    ArenaNetwork(size_t maxIntersections, size_t maxLanes, const ControllerParams& params = ControllerParams());
+
+    // Both throw std::runtime_error when the network is full
+    ArenaIntersection addIntersection();
+    ArenaLane addLane(ArenaIntersection intersection, int capacity);
+    size_t getIntersectionCount() const;
+    size_t getLaneCount() const;
+
+    // Clamp to the capacity / zero and return how many changed, like Lane
+    int addVehicles(ArenaLane lane, int count);
+    int removeVehicles(ArenaLane lane, int count);
+    void reportEmergencyVehicle(ArenaLane lane, EmergencyVehicleType type);
+    void clearEmergencyVehicle(ArenaLane lane);
+    void requestPedestrianCrossing(ArenaIntersection intersection);
+    void clearPedestrianCrossing(ArenaIntersection intersection);
+
+    // Samples every lane and runs one control tick of every intersection
+    void step(Clock::time_point now);
+
+    int getVehicleCount(ArenaLane lane) const;
+    int getCapacity(ArenaLane lane) const;
+    LightState getLightState(ArenaLane lane) const;
+    double getSmoothedOccupancy(ArenaLane lane) const;
+    ArenaIntersection getIntersection(ArenaLane lane) const;
+    // Green time the intersection's current green lane was given
+    std::chrono::seconds getGreenDuration(ArenaIntersection intersection) const;
+
+    // Everything the network holds lives in the arena, so this is its footprint
+    size_t getArenaBytes() const;
+    // Arena bytes per lane at full capacity, intersection state included
+    double getBytesPerLane() const;
+
+private:
+    void stepIntersection(ArenaIntersection intersection, Clock::time_point now);
+    void checkLane(ArenaLane lane) const;
+    void checkIntersection(ArenaIntersection intersection) const;
+    static size_t arenaSize(size_t maxIntersections, size_t maxLanes);
+
+    ControllerParams params;
+    size_t maxIntersections;
+    size_t maxLanes;
+    Arena arena;
+    size_t intersectionCount = 0;
+    size_t laneCount = 0;
+    Clock::time_point lastStep{};
+    bool sampled = false;
+
+    // Per lane
+    uint16_t* vehicles;
+    uint16_t* capacities;
+    uint8_t* lights;              // LightState
+    uint8_t* emergencies;         // EmergencyVehicleType
+    float* smoothedOccupancy;     // EWMA, as LaneStatistics
+    Clock::time_point* lastGreen; // time_point::min() until the first tick sees the lane
+
+    // Per intersection
+    uint32_t* firstLane;
+    uint16_t* laneCounts;
+    uint16_t* greenSeconds;
+    uint8_t* pedestrians;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+// Time source used by the controller. The default follows the wall clock;
+// ManualClock lets simulations advance time step by step without sleeping.
+class Clock {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+    using duration = std::chrono::steady_clock::duration;
+
+    virtual ~Clock() = default;
+
+    virtual time_point now() const = 0;
+    virtual void sleepFor(duration d) = 0;
+
+    static std::shared_ptr<Clock> steady();
+};
+
+class SteadyClock : public Clock {
+public:
+    time_point now() const override;
+    void sleepFor(duration d) override;
+};
+
+class ManualClock : public Clock {
+public:
+    ManualClock();
+    explicit ManualClock(time_point start);
+
+    time_point now() const override;
+    // Sleeping on a manual clock advances it instead of blocking
+    void sleepFor(duration d) override;
+
+    void advance(duration d);
+    // Moves the clock forward to t; never moves it backwards
+    void advanceTo(time_point t);
+
+private:
+    std::atomic<duration::rep> ticks;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+
+enum class ControlPolicy {
+    GREEDY,            // serve the fullest lane, or rotate when every lane is saturated
+    ROLLING_HORIZON    // search green sequences over a short horizon (see HorizonPlanner)
+};
+
+// Tuning constants of the intersection controller
+struct ControllerParams {
+    ControlPolicy policy = ControlPolicy::GREEDY;
+    // When every lane is at least this full, green rotates to the lane served least recently
+    double saturationThreshold = 0.8;
+    // A green light is kept at least this long before the controller may switch it
+    std::chrono::milliseconds minGreen{5000};
+    // Normal green duration is baseGreen + occupancy * greenRange (30-60 s by default)
+    std::chrono::seconds baseGreen{30};
+    std::chrono::seconds greenRange{30};
+    std::chrono::seconds emergencyGreen{90};
+    std::chrono::milliseconds yellow{1000};
+    // Pick the green lane from smoothed occupancy so one noisy sample cannot flip the decision
+    bool smoothOccupancy = true;
+    // When non-zero, green duration is sized from the demand predicted over this horizon
+    // (queue plus estimated arrivals) instead of the current queue alone
+    std::chrono::seconds demandHorizon{0};
+
+    // Rolling horizon: plan horizonSteps decisions of horizonStep each, spending at
+    // most planningBudget per tick. A switch costs yellow plus startupLostTime of green.
+    int horizonSteps = 6;
+    std::chrono::seconds horizonStep{5};
+    std::chrono::microseconds planningBudget{200};
+    std::chrono::milliseconds startupLostTime{2000};
+    // Vehicles per second a lane discharges while green; a lane's measured
+    // discharge rate averages over red time too, so it is only used when higher
+    double saturationFlow = 0.5;
+    // A vehicle on a lane that has been red this long counts double, so light
+    // approaches are not starved by busy ones
+    std::chrono::seconds waitWeightTime{30};
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Wakes a sleeping controller thread. Urgent notifications (threshold
+// crossings, emergencies, pedestrian requests) end the current sleep;
+// ordinary activity only sets a flag the controller reads when it next
+// plans its sleep, so busy lanes cost no system calls.
+class ControllerWakeup {
+public:
+    ControllerWakeup();
+
+    void notifyUrgent();
+    void markActivity();
+
+    // Sleeps for up to `timeout`; returns true if woken early. With
+    // `wakeOnActivity` the first markActivity() also ends the sleep.
+    bool waitFor(std::chrono::steady_clock::duration timeout, bool wakeOnActivity);
+    // Returns whether there was activity since the last call, and clears it
+    bool consumeActivity();
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool urgent;
+    std::atomic<bool> activity;
+    std::atomic<bool> activityWakes;
+};
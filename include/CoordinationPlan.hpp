@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Clock.hpp"
+
+// Fixed-time coordination handed to one intersection by a corridor plan: the
+// arterial approaches are green for `green` out of every `cycle`, starting
+// `offset` into each cycle counted from `epoch`; the other approaches get the
+// rest of the cycle.
+struct CoordinationPlan {
+    Clock::time_point epoch{};
+    std::chrono::milliseconds cycle{0};
+    std::chrono::milliseconds offset{0};
+    std::chrono::milliseconds green{0};
+    std::vector<std::string> arterialLanes;
+    // A lane held red by the plan that is at least this full hands control
+    // back to the local policy until it has drained
+    double overrideOccupancy = 0.9;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Clock.hpp"
+#include "Intersection.hpp"
+
+// One intersection on an emergency vehicle's route
+struct RouteLeg {
+    std::shared_ptr<Intersection> intersection;
+    std::string laneId;                           // approach the vehicle arrives on
+    std::chrono::duration<double> travelTime{0};  // from the previous leg, or from dispatch for the first
+};
+
+struct CorridorParams {
+    // Floor on a lane's discharge estimate, and the rate used before it has
+    // one (vehicles per second)
+    double fallbackDischargeRate = 0.5;
+    // Start-up lost time of a queue once its light turns green
+    std::chrono::duration<double> startupLostTime{2.0};
+    // Never pre-clear later than this before the ETA
+    std::chrono::duration<double> minimumLead{5.0};
+    // A leg the vehicle never reports passing is released this long after its ETA
+    std::chrono::duration<double> releaseTimeout{30.0};
+};
+
+enum class LegPhase {
+    PENDING,
+    PREEMPTED,
+    RELEASED
+};
+
+struct CorridorLegStatus {
+    std::string intersectionId;
+    std::string laneId;
+    LegPhase phase;
+    Clock::time_point eta;
+    Clock::time_point clearAt;    // when preemption starts given the current queue
+    bool timedOut;
+};
+
+struct CorridorStats {
+    uint64_t runsDispatched = 0;
+    uint64_t legsPreempted = 0;
+    uint64_t legsReleasedOnPass = 0;
+    uint64_t legsTimedOut = 0;
+    double totalHoldSeconds = 0.0;   // cross traffic held, summed over legs
+    double maxHoldSeconds = 0.0;
+};
+
+// Preempts the intersections along an emergency vehicle's route just in time.
+// Each approach is cleared at ETA minus the time its current queue needs to
+// discharge (start-up lost time + queue / discharge rate + yellow), and is
+// released as soon as the vehicle reports passing it. Passing a leg re-bases
+// the ETAs of the legs downstream on the observed time.
+//
+// Runs that share an approach share its preemption: it is cleared when the
+// last of them releases it, and only if this class set it. An emergency a
+// detector or feed reported on the approach first is left for them to clear.
+class CorridorPreemption {
+public:
+    using RunId = uint64_t;
+
+    explicit CorridorPreemption(std::shared_ptr<Clock> clock = Clock::steady(),
+                                const CorridorParams& params = CorridorParams());
+    ~CorridorPreemption();
+
+    RunId dispatch(EmergencyVehicleType type, const std::vector<RouteLeg>& route);
+    // The vehicle has cleared leg `legIndex` (and every leg before it)
+    void reportPassed(RunId run, size_t legIndex);
+    // Releases every leg of a run that is still held
+    void cancel(RunId run);
+
+    // Preempts legs whose clear time has come and releases timed-out legs
+    void update();
+    // Calls update() from a background thread
+    void start();
+    void stop();
+
+    std::vector<CorridorLegStatus> status(RunId run) const;
+    size_t activeRuns() const;
+    CorridorStats getStats() const;
+
+private:
+    struct Leg {
+        RouteLeg route;
+        LegPhase phase = LegPhase::PENDING;
+        Clock::time_point eta;
+        Clock::time_point preemptedAt;
+        bool timedOut = false;
+    };
+
+    struct Run {
+        RunId id;
+        EmergencyVehicleType type;
+        std::vector<Leg> legs;
+    };
+
+    void updateLocked(Clock::time_point now);
+    Clock::duration clearanceLead(const Leg& leg) const;
+    void preempt(Leg& leg, EmergencyVehicleType type, Clock::time_point now);
+    void release(Leg& leg, Clock::time_point now, bool passed);
+    void removeFinishedRuns();
+    void updateLoop();
+
+    std::shared_ptr<Clock> clock;
+    CorridorParams params;
+    std::vector<Run> runs;
+
+    // Preempted approaches, keyed by intersection and lane id
+    struct Hold {
+        size_t holders = 0;
+        bool ours = false;    // the emergency on the lane was reported here
+        EmergencyVehicleType type = EmergencyVehicleType::NONE;
+    };
+    std::map<std::pair<const Intersection*, std::string>, Hold> holds;
+    RunId nextRunId;
+    CorridorStats stats;
+    std::atomic<bool> running;
+    std::unique_ptr<std::thread> updateThread;
+    mutable std::mutex mutex;
+};
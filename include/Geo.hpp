@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cmath>
+
+// Planar position in metres in a local east/north frame
+struct Position {
+    double x = 0.0;  // east
+    double y = 0.0;  // north
+
+    // Equirectangular projection around an origin; accurate to well under a
+    // metre across a city
+    static Position fromLatLon(double latitude, double longitude, double originLatitude, double originLongitude);
+};
+
+// Headings and bearings are degrees clockwise from north, in [0, 360)
+double distanceBetween(const Position& a, const Position& b);
+double bearingBetween(const Position& from, const Position& to);
+// Smallest absolute difference between two headings, in [0, 180]
+double headingDifference(double a, double b);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include "Clock.hpp"
+#include "ControllerParams.hpp"
+#include "TrafficLight.hpp"
+
+// The default controller decision as pure functions over per-lane arrays, so
+// the object model (Intersection) and the arena model (ArenaNetwork) make the
+// same choices.
+
+struct GreedyChoice {
+    int lane = -1;
+    // Every lane was saturated, so green rotates to the lane served least
+    // recently and restarts even if that lane already has it
+    bool rotation = false;
+};
+
+// occupancy[i] is the decision occupancy of lane i and lastGreen[i] when it
+// last got green. Serves the fullest lane (the first on ties) unless every lane
+// is at least saturationThreshold full.
+GreedyChoice chooseGreedyLane(const double* occupancy, const Clock::time_point* lastGreen, size_t count,
+                              double saturationThreshold);
+
+// baseGreen + occupancy * greenRange, at least 4 seconds
+std::chrono::seconds greedyGreenDuration(const ControllerParams& params, double occupancy);
+
+// Fire truck > ambulance > police; 0 for no emergency vehicle
+int emergencyPriority(EmergencyVehicleType type);
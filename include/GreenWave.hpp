@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Clock.hpp"
+
+class Intersection;
+
+struct GreenWaveSettings {
+    // Candidate cycle lengths, in seconds (at most kMaxCycle)
+    int minCycle = 60;
+    int maxCycle = 120;
+    int cycleStep = 5;
+    // Bands are measured over every run of this many consecutive signals
+    int span = 8;
+    // Offset searches per cycle length; the first two start from perfect
+    // forward and perfect reverse progression, the rest from random offsets
+    int restarts = 8;
+    int maxSweeps = 30;
+    // Weight of the reverse band against the forward one
+    double reverseWeight = 1.0;
+    // Directional balance, as MAXBAND's b' >= k * b applied both ways: each
+    // band must be at least this fraction of the other. The weighted sum is
+    // maximised among plans that meet it; plans that cannot come after, by
+    // how far they fall short. 0 leaves the bands unconstrained.
+    double balance = 0.5;
+    unsigned threads = 0;   // 0 = all cores
+    uint64_t seed = 1;
+};
+
+struct GreenWavePlan {
+    int cycle = 0;                 // seconds
+    std::vector<int> offsets;      // start of arterial green at each signal, seconds into the cycle
+    std::vector<int> greens;       // arterial green at each signal, seconds
+    // Seconds per cycle that pass a run of `span` signals without stopping,
+    // averaged over the runs
+    double forwardBandwidth = 0.0;
+    double reverseBandwidth = 0.0;
+    double efficiency = 0.0;       // weighted bandwidth as a fraction of the cycle
+    uint64_t sweeps = 0;           // coordinate-descent sweeps over all searches
+};
+
+// Maximises two-way progression bandwidth along a chain of signals. Every
+// signal shares one cycle; each gives the arterial a fixed fraction of it and
+// the search chooses the offsets. Time is discretised to one second: a band
+// is the set of departure seconds that meet green at every signal of a run of
+// `span` consecutive signals. On an arterial no longer than the span this is
+// the classic through band; on longer ones a through band in both directions
+// rarely exists, so the bands of all runs are averaged instead.
+//
+// Offsets are found by coordinate descent. With the other signals fixed, the
+// departures each run still lets through are known (one bitset per signal
+// and direction), and both bands for every offset of one signal follow from
+// a circular window sum over them. Left alone, a weighted sum settles on one
+// strong direction on long arterials, hence the balance constraint. Cycle
+// lengths and restarts run in parallel; results do not depend on the thread
+// count.
+class GreenWaveOptimizer {
+public:
+    static constexpr int kMaxCycle = 256;
+
+    // greenFractions: one per signal. forwardTravel[i] / reverseTravel[i]: seconds
+    // from signal i to i + 1 and back. Throws std::invalid_argument on mismatched
+    // sizes, fractions outside (0, 1) or negative or non-finite travel times.
+    GreenWaveOptimizer(std::vector<double> greenFractions, std::vector<double> forwardTravel,
+                       std::vector<double> reverseTravel);
+
+    GreenWavePlan optimize(const GreenWaveSettings& settings) const;
+
+    // Forward and reverse bandwidth of the given cycle and offsets, as in GreenWavePlan
+    std::pair<double, double> bandwidth(int cycle, const std::vector<int>& offsets, int span) const;
+
+private:
+    GreenWavePlan search(int cycle, int restart, const GreenWaveSettings& settings) const;
+    std::vector<int> greensFor(int cycle) const;
+
+    std::vector<double> greenFractions;
+    std::vector<int> forwardArrival;   // seconds from signal 0 to each signal
+    std::vector<int> reverseArrival;   // seconds from the last signal to each signal
+};
+
+// One signal of an arterial: the approaches carrying traffic in each direction
+struct WaveSignal {
+    std::shared_ptr<Intersection> intersection;
+    std::string forwardLane;
+    std::string reverseLane;
+};
+
+// Hands each intersection its share of the plan (see Intersection::setCoordinationPlan)
+void applyGreenWave(const std::vector<WaveSignal>& signals, const GreenWavePlan& plan, Clock::time_point epoch,
+                    double overrideOccupancy = 0.9);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Demand of one approach as the planner sees it
+struct PlannerLane {
+    double queue = 0.0;          // vehicles waiting now
+    double arrivalRate = 0.0;    // vehicles per second
+    double dischargeRate = 0.0;  // vehicles per second while green
+    double weight = 1.0;         // cost of one vehicle-second of queueing on this lane
+};
+
+struct HorizonSettings {
+    int steps = 6;                // decisions looked ahead (at most HorizonPlan::kMaxSteps)
+    double stepSeconds = 5.0;     // length of one decision
+    double lostSeconds = 3.0;     // yellow plus start-up lost time of a switch
+    double minGreenSeconds = 5.0;
+    // Hard limit on search time; the best plan found so far is returned when it runs out
+    std::chrono::nanoseconds budget{std::chrono::microseconds(200)};
+};
+
+struct HorizonPlan {
+    static constexpr int kMaxSteps = 16;
+
+    int phases[kMaxSteps] = {};  // lane served in each step
+    int steps = 0;
+    double cost = 0.0;           // predicted vehicle-seconds of queueing
+    uint64_t nodes = 0;          // search nodes expanded
+    bool complete = false;       // the search finished, so the plan is optimal for the model
+
+    int firstPhase() const { return steps > 0 ? phases[0] : -1; }
+    // Number of leading steps that serve the first phase
+    int firstRun() const;
+};
+
+// Chooses which approach to serve next by branch-and-bound over phase
+// sequences on a fluid queue model: each step one lane discharges, every lane
+// receives its arrivals, and a switch loses lostSeconds of green. The cost is
+// the weighted queueing delay over the horizon plus one step of the queue left
+// at its end. A greedy rollout (serve the longest queue) seeds the incumbent, so a
+// plan exists however small the budget, and the search improves it until the
+// tree is exhausted or the budget runs out. Scratch space is kept between
+// calls, so planning does not allocate once it has seen the largest lane count.
+class HorizonPlanner {
+public:
+    HorizonPlan plan(const std::vector<PlannerLane>& lanes, int currentGreen, double greenElapsed,
+                     const HorizonSettings& settings);
+
+    // Model cost of serving `phases[0..steps)` in turn, or infinity when the
+    // sequence cuts a green short of the minimum
+    static double sequenceCost(const std::vector<PlannerLane>& lanes, int currentGreen, double greenElapsed,
+                               const HorizonSettings& settings, const int* phases, int steps);
+
+private:
+    void search(int depth, int phase, double run, double cost);
+    double lowerBound(int depth, double total) const;
+
+    // Per-call inputs
+    const std::vector<PlannerLane>* lanes = nullptr;
+    const HorizonSettings* settings = nullptr;
+    int steps = 0;
+    double totalArrivals = 0.0;
+    double maxDischarge = 0.0;
+    double minWeight = 0.0;
+    std::chrono::steady_clock::time_point deadline;
+    bool outOfTime = false;
+
+    // Scratch, (steps + 1) x lanes queue states and steps x lanes child orders
+    std::vector<double> queues;
+    std::vector<int> order;
+    int path[HorizonPlan::kMaxSteps] = {};
+    HorizonPlan best;
+};
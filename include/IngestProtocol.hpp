@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Wire format shared by IngestServer and its clients. All integers are
+// little-endian.
+//
+//   frame  := length:u32  batch          (length = bytes of batch)
+//   batch  := magic:u16  version:u16  count:u32  record[count]
+//   record := kind:u8  vehicle:u8  lane:u16  intersection:u32  value:i32  reserved:u32
+//
+// Records are fixed-size, so a server decodes a batch in place without
+// allocating. Intersections and lanes are addressed by index in the order the
+// server was given them.
+namespace ingest {
+
+constexpr uint16_t kMagic = 0x4954;  // "TI"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kLengthBytes = 4;
+constexpr size_t kBatchHeaderBytes = 8;
+constexpr size_t kRecordBytes = 16;
+constexpr uint32_t kMaxRecordsPerBatch = 4096;
+constexpr size_t kMaxFrameBytes = kLengthBytes + kBatchHeaderBytes + kMaxRecordsPerBatch * kRecordBytes;
+
+enum class RecordKind : uint8_t {
+    VEHICLE_ARRIVALS = 1,    // value vehicles joined the lane
+    VEHICLE_DEPARTURES = 2,  // value vehicles left the lane
+    EMERGENCY_REPORT = 3,    // vehicle holds the EmergencyVehicleType
+    EMERGENCY_CLEAR = 4,
+    PEDESTRIAN_REQUEST = 5,  // lane is ignored
+    PEDESTRIAN_CLEAR = 6
+};
+
+struct Record {
+    RecordKind kind;
+    uint8_t vehicle;
+    uint16_t lane;
+    uint32_t intersection;
+    int32_t value;
+};
+
+inline void storeU16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+inline void storeU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+inline uint16_t loadU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t loadU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline size_t frameBytes(size_t records) {
+    return kLengthBytes + kBatchHeaderBytes + records * kRecordBytes;
+}
+
+// Writes one frame holding `count` records into `out`, which must have room
+// for frameBytes(count). Returns the bytes written.
+inline size_t encodeFrame(const Record* records, uint32_t count, uint8_t* out) {
+    storeU32(out, static_cast<uint32_t>(kBatchHeaderBytes + count * kRecordBytes));
+    uint8_t* p = out + kLengthBytes;
+    storeU16(p, kMagic);
+    storeU16(p + 2, kVersion);
+    storeU32(p + 4, count);
+    p += kBatchHeaderBytes;
+    for (uint32_t i = 0; i < count; ++i, p += kRecordBytes) {
+        p[0] = static_cast<uint8_t>(records[i].kind);
+        p[1] = records[i].vehicle;
+        storeU16(p + 2, records[i].lane);
+        storeU32(p + 4, records[i].intersection);
+        storeU32(p + 8, static_cast<uint32_t>(records[i].value));
+        storeU32(p + 12, 0);
+    }
+    return static_cast<size_t>(p - out);
+}
+
+inline Record decodeRecord(const uint8_t* p) {
+    Record record;
+    record.kind = static_cast<RecordKind>(p[0]);
+    record.vehicle = p[1];
+    record.lane = loadU16(p + 2);
+    record.intersection = loadU32(p + 4);
+    record.value = static_cast<int32_t>(loadU32(p + 8));
+    return record;
+}
+
+} // namespace ingest
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IngestProtocol.hpp"
+#include "Intersection.hpp"
+
+struct IngestStats {
+    uint64_t connectionsAccepted = 0;
+    uint64_t frames = 0;
+    uint64_t records = 0;
+    uint64_t recordsRejected = 0;   // unknown kind, out-of-range address or non-positive count
+    uint64_t protocolErrors = 0;    // connections dropped for a malformed frame
+};
+
+// Accepts detector and emergency feeds from other processes. One epoll-driven
+// I/O thread serves every connection; each connection has a fixed receive
+// buffer allocated when it is accepted, and records are applied to the lanes
+// straight out of that buffer (see IngestProtocol.hpp for the format).
+//
+// Lanes are addressed by their current index in the intersection. Each
+// intersection's lane table is re-read when its configuration version
+// changes (checked once per batch), so records follow lanes that are added
+// or closed while the server runs. Records for a lane index that no longer
+// exists are rejected.
+class IngestServer {
+public:
+    explicit IngestServer(const std::vector<std::shared_ptr<Intersection>>& intersections);
+    ~IngestServer();
+
+    IngestServer(const IngestServer&) = delete;
+    IngestServer& operator=(const IngestServer&) = delete;
+
+    // Listening endpoints; call before start(). Throw std::runtime_error on failure.
+    void listenUnix(const std::string& path);
+    // Binds 127.0.0.1; port 0 picks a free port. Returns the bound port.
+    uint16_t listenTcp(uint16_t port);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    IngestStats getStats() const;
+
+private:
+    struct Connection;
+
+    void ioLoop();
+    void acceptConnections(int listener);
+    // Returns false when the connection should be closed
+    bool readConnection(Connection& connection);
+    void applyBatch(const uint8_t* batch, uint32_t count);
+    void closeConnection(int fd);
+
+    struct LaneTable {
+        bool loaded = false;
+        uint64_t version = 0;
+        uint64_t checkedBatch = 0;
+        std::vector<std::shared_ptr<Lane>> lanes;
+    };
+    // Lanes of one intersection, re-read if its configuration changed
+    const LaneTable& lanesOf(uint32_t intersection);
+
+    std::vector<std::shared_ptr<Intersection>> intersections;
+    std::vector<LaneTable> laneTables;   // one per intersection
+    uint64_t batchNumber = 0;
+
+    std::vector<int> listeners;
+    std::string unixPath;
+    int epollFd;
+    int wakeFd;
+    std::vector<std::unique_ptr<Connection>> connections;   // indexed by fd
+    std::atomic<bool> running;
+    std::unique_ptr<std::thread> ioThread;
+
+    std::atomic<uint64_t> connectionsAccepted;
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> records;
+    std::atomic<uint64_t> recordsRejected;
+    std::atomic<uint64_t> protocolErrors;
+};
@@ -1,38 +1,182 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <memory>
 #include <thread>
+#include "BoundedQueue.hpp"
+#include "Clock.hpp"
+#include "ControllerParams.hpp"
+#include "CoordinationPlan.hpp"
+#include "Geo.hpp"
+#include "HorizonPlanner.hpp"
 #include "Lane.hpp"
+#include "RcuCell.hpp"
 #include "TrafficLight.hpp"
-#include <unordered_map>
 
+class ControllerWakeup;
+class SignalEventHub;
+class Subscription;
+struct SubscriptionOptions;
+
+// Lanes, parameters, clock and location live in an immutable snapshot that
+// reconfiguration replaces atomically (see RcuCell), so the control tick reads
+// them without a lock and lanes can be added or closed while it runs.
 class Intersection {
 public:
     Intersection(const std::string& id);
     ~Intersection();
 
     void addLane(std::shared_ptr<Lane> lane, std::shared_ptr<TrafficLight> light);
+    // Closes a lane: its light goes to red and the lane stops taking part in
+    // control. Later lanes move down one index. Returns false for an unknown id.
+    bool removeLane(const std::string& laneId);
     void start();
     void stop();
     bool isRunning() const;
+    // Number of times the background controller has woken up to run a tick
+    uint64_t getWakeupCount() const;
+
+    // Runs a single control tick on the calling thread (used by stepped simulations)
+    void step();
+    void setClock(std::shared_ptr<Clock> clock);
+    // Throws std::invalid_argument for a threshold outside [0, 1], a negative
+    // duration or a non-positive horizon, leaving the current parameters
+    void setParams(const ControllerParams& params);
+    ControllerParams getParams() const;
+    // Bumped by every change to lanes, parameters, clock or location
+    uint64_t getConfigVersion() const;
+
+    const std::string& getId() const;
+    size_t getLaneCount() const;
+    std::shared_ptr<Lane> getLane(size_t index) const;
+    std::shared_ptr<TrafficLight> getLight(size_t index) const;
+
+    // Where the intersection is, and the heading of traffic on each approach
+    // as it drives towards the stop line (NaN until set)
+    void setLocation(const Position& position);
+    Position getLocation() const;
+    void setApproachHeading(size_t laneIndex, double heading);
+    double getApproachHeading(size_t laneIndex) const;
+
+    // Follows a corridor timing plan (see GreenWave.hpp) until cleared.
+    // Emergencies, pedestrian crossings and a held lane filling past
+    // plan.overrideOccupancy take precedence. Throws std::invalid_argument for
+    // a malformed plan or an unknown arterial lane.
+    void setCoordinationPlan(const CoordinationPlan& plan);
+    void clearCoordinationPlan();
+    bool isCoordinated() const;
+
+    // Outcome of the latest rolling-horizon decision (ControlPolicy::ROLLING_HORIZON)
+    HorizonPlan getLastPlan() const;
+
+    // Fills `out` with one statistics snapshot per lane, in lane order
+    void collectStatistics(std::vector<LaneStatisticsSnapshot>& out) const;
     
     // Emergency vehicle methods
     void reportEmergencyVehicle(const std::string& laneId, EmergencyVehicleType type);
     void clearEmergencyVehicle(const std::string& laneId);
+    // By lane index, skipping the id lookup; out-of-range indices are ignored
+    void reportEmergencyVehicle(size_t laneIndex, EmergencyVehicleType type);
+    void clearEmergencyVehicle(size_t laneIndex);
+    // Never block, for feeds that must not wait for a control tick (a tick
+    // holds the controller through each yellow). Applied at once when no
+    // tick is running, otherwise queued for the start of the next tick, in
+    // order. Return false when the queue is full.
+    bool postEmergencyVehicle(const Lane& lane, EmergencyVehicleType type);
+    bool postEmergencyClear(const Lane& lane);
+
+    // Pedestrian crossing: holds every non-emergency approach at red
+    void requestPedestrianCrossing();
+    void clearPedestrianCrossing();
+    bool isPedestrianCrossingActive() const;
+
+    // Push notifications for light state, duration, emergency and pedestrian
+    // changes. Each subscriber gets its own bounded queue; returns nullptr
+    // when the subscriber limit is reached.
+    std::shared_ptr<Subscription> subscribe();
+    std::shared_ptr<Subscription> subscribe(const SubscriptionOptions& options);
+    void unsubscribe(const std::shared_ptr<Subscription>& subscription);
     
 private:
+    // The background controller sleeps between ticks instead of polling:
+    // through minimum green, then at this period while lanes are changing or
+    // smoothed occupancy is settling, otherwise until a green expires, an
+    // urgent event arrives or kMaxIdleSleep passes.
+    static constexpr std::chrono::milliseconds kActivityPeriod{500};
+    static constexpr std::chrono::seconds kMaxIdleSleep{60};
+
+    // Per-lane state kept by the tick. Shared by successive snapshots so it
+    // survives reconfiguration, and freed with the last snapshot holding the lane.
+    struct LaneControl {
+        Clock::time_point lastGreen;
+        bool seen = false;
+    };
+
+    struct LaneEntry {
+        std::shared_ptr<Lane> lane;
+        std::shared_ptr<TrafficLight> light;
+        double approachHeading;
+        std::shared_ptr<LaneControl> control;
+        bool arterial = false;   // green in the arterial phase of the coordination plan
+    };
+
+    struct Configuration {
+        std::vector<LaneEntry> lanes;
+        ControllerParams params;
+        std::shared_ptr<Clock> clock = Clock::steady();
+        Position location;
+        std::shared_ptr<const CoordinationPlan> coordination;
+        uint64_t version = 0;
+    };
+
     void controlLoop();
-    void optimizeTrafficFlow();
-    void handleEmergencyVehicles();
+    Clock::duration planSleep(bool activity, bool& wakeOnActivity);
+    void optimizeTrafficFlow(const Configuration& config);
+    void optimizeWithHorizon(const Configuration& config, Clock::time_point now);
+    // Returns false when a local override hands the tick back to the policy
+    bool followCoordinationPlan(const Configuration& config, Clock::time_point now);
+    static Clock::duration intoCycle(const CoordinationPlan& plan, Clock::time_point now);
+    void handleEmergencyVehicles(const Configuration& config);
+    void holdForPedestrians(const Configuration& config);
+    void reportEmergencyLocked(const LaneEntry& entry, EmergencyVehicleType type);
+    void clearEmergencyLocked(const Configuration& config, const LaneEntry& entry);
+    void sampleLaneStatistics(const Configuration& config);
+    static double decisionOccupancy(const ControllerParams& params, const Lane& lane);
+    static double greenOccupancy(const ControllerParams& params, const Lane& lane);
+    // Publishes a modified copy of the configuration; `modify` returns false
+    // when it changed nothing, which leaves the version alone
+    void reconfigure(const std::function<bool(Configuration&)>& modify);
 
     std::string id;
-    std::vector<std::pair<std::shared_ptr<Lane>, std::shared_ptr<TrafficLight>>> lanes;
+    RcuCell<Configuration> config;
     std::atomic<bool> running;
     std::unique_ptr<std::thread> controlThread;
     std::atomic<bool> emergencyActive;
-    mutable std::mutex mutex;
-
-    // Track last green time for each lane
-    std::unordered_map<Lane*, std::chrono::steady_clock::time_point> lastGreenTime;
+    std::atomic<bool> pedestrianCrossing;
+    // Posted emergency reports (type NONE clears). Lanes are matched by
+    // address against the current lanes, so a closed lane's posts are dropped.
+    struct PostedEmergency {
+        const Lane* lane;
+        EmergencyVehicleType type;
+    };
+    static constexpr size_t kPostedEmergencies = 256;
+    BoundedQueue<PostedEmergency> postedEmergencies;
+    bool postEmergency(const Lane& lane, EmergencyVehicleType type);
+    void applyPostedEmergencies(const Configuration& config);
+    void applyPostedEmergency(const Configuration& config, const PostedEmergency& posted);
+    // Serialises control ticks with emergency reports and clears;
+    // reconfiguration does not take it
+    mutable std::mutex controlMutex;
+    std::shared_ptr<SignalEventHub> events;
+    std::shared_ptr<ControllerWakeup> wakeup;
+    std::atomic<uint64_t> wakeups;
+    Clock::time_point settleUntil;
+    // Rolling-horizon scratch, used by the tick under controlMutex
+    HorizonPlanner planner;
+    std::vector<PlannerLane> plannerLanes;
+    HorizonPlan lastPlan;
+    // Greedy-policy scratch, likewise
+    std::vector<double> greedyOccupancy;
+    std::vector<Clock::time_point> greedyLastGreen;
 };
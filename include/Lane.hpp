@@ -3,8 +3,11 @@
 #include <vector>
 #include <memory>
 #include <thread>
+#include "LaneStatistics.hpp"
 #include "TrafficLight.hpp"
 
+class ControllerWakeup;
+
 class Lane {
 public:
     Lane(const std::string& id, int capacity);
@@ -12,8 +15,11 @@ public:
 
     void addVehicle();
     void removeVehicle();
+    // Batched updates: clamp to the capacity / zero and return how many changed
+    int addVehicles(int count);
+    int removeVehicles(int count);
     int getVehicleCount() const;
-    std::string getId() const;
+    const std::string& getId() const;
     int getCapacity() const;
     double getOccupancyRatio() const;
     
@@ -23,10 +29,31 @@ public:
     EmergencyVehicleType getEmergencyVehicleType() const;
     bool hasEmergencyVehicle() const;
 
+    // Rolling statistics, sampled by the owning intersection every control tick
+    void sampleStatistics(std::chrono::steady_clock::time_point now);
+    const LaneStatistics& getStatistics() const;
+    // Vehicles expected to want the green over the next `horizon`: the current
+    // queue plus the estimated arrivals, capped at capacity
+    double predictedDemand(std::chrono::duration<double> horizon) const;
+
+    // Change signalling for the owning controller. Crossing empty/non-empty,
+    // full, or the signal level (a fraction of capacity) wakes it at once;
+    // any other change is only recorded as activity.
+    void attachWakeup(std::shared_ptr<ControllerWakeup> wakeup);
+    void setSignalLevel(double fraction);
+
 private:
+    void signalChange(int before, int after);
+
     std::string id;
     std::atomic<int> vehicleCount;
     int capacity;
     std::atomic<EmergencyVehicleType> emergencyVehicle;
+    std::atomic<uint64_t> totalArrivals;
+    std::atomic<uint64_t> totalDepartures;
+    LaneStatistics statistics;
+    std::atomic<int> signalCount;
+    std::atomic<ControllerWakeup*> wakeup;
+    std::shared_ptr<ControllerWakeup> wakeupOwner;
     mutable std::mutex mutex;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Streaming estimate of one quantile using the P-square algorithm
+// (Jain & Chlamtac): five markers, constant memory, O(1) per sample.
+class P2Quantile {
+public:
+    explicit P2Quantile(double quantile);
+
+    void add(double value);
+    double value() const;
+    uint64_t count() const;
+
+private:
+    double parabolic(int i, int d) const;
+    double linear(int i, int d) const;
+
+    double p;
+    uint64_t samples;
+    std::array<double, 5> heights;
+    std::array<double, 5> positions;
+    std::array<double, 5> desired;
+    std::array<double, 5> increments;
+};
+
+struct LaneStatisticsSnapshot {
+    double arrivalRate = 0.0;        // vehicles per second, EWMA
+    double dischargeRate = 0.0;      // vehicles per second, EWMA
+    double smoothedOccupancy = 0.0;  // EWMA of the occupancy ratio
+    double windowMaxOccupancy = 0.0; // max occupancy over the recent window
+    double occupancyP50 = 0.0;
+    double occupancyP90 = 0.0;
+    double occupancyP99 = 0.0;
+    uint64_t samples = 0;
+};
+
+// Fixed-memory rolling statistics of a lane. update() is O(1) and called by a
+// single writer (the intersection's control tick); snapshot() can be read
+// from any thread without locking.
+class LaneStatistics {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    // Occupancy smoothing is short so a single noisy sample is damped without
+    // delaying real changes; rate estimates average over a longer period.
+    static constexpr double kOccupancyTimeConstant = 2.0;
+    static constexpr double kRateTimeConstant = 60.0;
+    static constexpr double kMaxWindowSeconds = 60.0;
+
+    LaneStatistics();
+
+    // Records a sample: current occupancy plus the lane's cumulative arrival
+    // and departure counters
+    void update(time_point now, double occupancy, uint64_t arrivals, uint64_t departures);
+
+    LaneStatisticsSnapshot snapshot() const;
+    double smoothedOccupancy() const;
+    double arrivalRate() const;
+    uint64_t sampleCount() const;
+
+private:
+    static constexpr int kMaxBuckets = 12;
+
+    void publish();
+
+    // Writer-only state
+    bool initialized;
+    time_point lastSample;
+    uint64_t lastArrivals;
+    uint64_t lastDepartures;
+    double arrivalEwma;
+    double dischargeEwma;
+    double occupancyEwma;
+    std::array<double, kMaxBuckets> bucketMax;
+    int64_t currentBucket;
+    P2Quantile p50;
+    P2Quantile p90;
+    P2Quantile p99;
+    uint64_t samples;
+
+    // Published values, guarded by a sequence counter
+    std::atomic<uint64_t> sequence;
+    std::atomic<double> publishedArrival;
+    std::atomic<double> publishedDischarge;
+    std::atomic<double> publishedOccupancy;
+    std::atomic<double> publishedWindowMax;
+    std::atomic<double> publishedP50;
+    std::atomic<double> publishedP90;
+    std::atomic<double> publishedP99;
+    std::atomic<uint64_t> publishedSamples;
+};
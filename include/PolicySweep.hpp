@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ControllerParams.hpp"
+#include "Scenario.hpp"
+
+// Candidate values for each controller constant; expand() forms the grid
+struct ParameterGrid {
+    std::vector<ControlPolicy> policies{ControlPolicy::GREEDY};
+    std::vector<double> saturationThresholds{0.8};
+    std::vector<std::chrono::milliseconds> minGreens{std::chrono::milliseconds(5000)};
+    std::vector<std::chrono::seconds> baseGreens{std::chrono::seconds(30)};
+    std::vector<std::chrono::seconds> greenRanges{std::chrono::seconds(30)};
+    std::vector<std::chrono::seconds> emergencyGreens{std::chrono::seconds(90)};
+    std::vector<std::chrono::milliseconds> yellows{std::chrono::milliseconds(1000)};
+
+    std::vector<ControllerParams> expand() const;
+};
+
+// Relative cost of each outcome when ranking configurations (lower is better)
+struct SweepWeights {
+    double delay = 1.0;               // per second of mean vehicle delay
+    double starvation = 0.1;          // per second of mean worst-case lane starvation
+    double emergencyLatency = 10.0;   // per second of mean preemption latency
+    double missedEmergency = 100.0;   // per run, per emergency vehicle that never got green
+};
+
+struct SweepPointResult {
+    ControllerParams params;
+    size_t runs = 0;
+    double meanDelay = 0.0;
+    double meanStarvation = 0.0;      // mean over runs of the longest starvation
+    double maxStarvation = 0.0;
+    double meanEmergencyLatency = 0.0;
+    double maxEmergencyLatency = 0.0;
+    uint64_t emergenciesMissed = 0;   // vehicles that left before getting green
+    double score = 0.0;
+};
+
+// Monte Carlo sweep of controller parameters. Every grid point is simulated
+// with the same seeds (common random numbers), so differences between points
+// come from the parameters rather than from sampling noise.
+class PolicySweep {
+public:
+    PolicySweep(const Scenario& scenario, unsigned threads = 0);
+
+    void setWeights(const SweepWeights& weights);
+
+    // Runs `runsPerPoint` seeded simulations per point across all threads and
+    // returns the points ranked best first. If a run throws (an invalid
+    // scenario or point), the sweep stops and rethrows it after every thread
+    // has finished.
+    std::vector<SweepPointResult> run(const std::vector<ControllerParams>& points,
+                                      size_t runsPerPoint, uint64_t baseSeed = 1) const;
+
+private:
+    Scenario scenario;
+    unsigned threads;
+    SweepWeights weights;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Holds an immutable value that readers use without taking a lock while
+// writers replace it wholesale (read-copy-update). A reader registers in one
+// of two counters selected by the current epoch; a writer publishes the new
+// value, flips the epoch and waits for the counter of the old epoch to drain
+// before freeing the old value. Readers never allocate or block.
+//
+// A thread holding a ReadGuard must not call update() on the same cell: it
+// would wait for itself.
+template <typename T>
+class RcuCell {
+public:
+    class ReadGuard {
+    public:
+        ReadGuard(ReadGuard&& other) noexcept : cell(other.cell), slot(other.slot), value(other.value) {
+            other.cell = nullptr;
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard& operator=(ReadGuard&&) = delete;
+        ~ReadGuard() {
+            if (cell) {
+                cell->readers[slot].count.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        const T& operator*() const { return *value; }
+        const T* operator->() const { return value; }
+
+    private:
+        friend class RcuCell;
+        ReadGuard(const RcuCell* cell, size_t slot, const T* value) : cell(cell), slot(slot), value(value) {}
+
+        const RcuCell* cell;
+        size_t slot;
+        const T* value;
+    };
+
+    explicit RcuCell(std::unique_ptr<T> initial)
+        : current(initial.release())
+        , epoch(0)
+    {}
+
+    ~RcuCell() {
+        delete current.load();
+    }
+
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    ReadGuard read() const {
+        while (true) {
+            uint64_t e = epoch.load();
+            size_t slot = e & 1;
+            readers[slot].count.fetch_add(1);
+            // A flip between the two loads may already be waiting on the other
+            // counter; retry so the writer cannot miss this reader
+            if (epoch.load() == e) {
+                return ReadGuard(this, slot, current.load());
+            }
+            readers[slot].count.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // Copies the current value, lets `modify` edit the copy and publishes it.
+    // Writers are serialised, so side effects in `modify` happen in publication
+    // order. Returns once no reader can still see the old value.
+    template <typename Modify>
+    void update(Modify&& modify) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto next = std::make_unique<T>(*current.load());
+        modify(*next);
+        const T* previous = current.exchange(next.release());
+        synchronize();
+        delete previous;
+    }
+
+private:
+    // Separate cache lines so the two reader populations do not share one
+    struct alignas(64) ReaderCount {
+        std::atomic<int64_t> count{0};
+    };
+
+    void synchronize() {
+        uint64_t e = epoch.fetch_add(1);
+        auto& old = readers[e & 1].count;
+        for (int spins = 0; old.load(std::memory_order_acquire) != 0; ++spins) {
+            // Readers may hold a snapshot across a yellow transition, so back off
+            if (spins < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    std::atomic<const T*> current;
+    std::atomic<uint64_t> epoch;
+    mutable std::array<ReaderCount, 2> readers;
+    std::mutex writerMutex;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "TrafficLight.hpp"
+
+// Declarative description of the traffic, emergency and pedestrian activity
+// at one intersection. Scenario files are line based:
+//
+//   scenario rush_hour
+//   seed 42
+//   duration 900
+//   lane North 15 arrivals 0.9 discharge 1.2
+//   emergency at 120 lane North type ambulance for 10
+//   emergency every 15-45 for 8-15
+//   pedestrian every 20-40 for 5-10
+//   demand at 600 lane North arrivals 1.4
+//
+// Times are in seconds and rates in vehicles per second. Ranges written as
+// MIN-MAX are sampled uniformly; an emergency without `lane`/`type` picks a
+// random lane and vehicle type. Lines starting with '#' are comments and a
+// file may hold several `scenario` blocks.
+
+struct ScenarioLane {
+    std::string name;
+    int capacity = 15;
+    double arrivalRate = 0.5;    // vehicles per second joining the queue
+    double dischargeRate = 1.0;  // vehicles per second leaving on green
+};
+
+struct ScenarioEvent {
+    enum class Kind {
+        EMERGENCY,
+        PEDESTRIAN,
+        DEMAND
+    };
+
+    Kind kind = Kind::EMERGENCY;
+    bool recurring = false;
+    double start = 0.0;          // timed events: when; recurring: earliest first arrival
+    double intervalMin = 0.0;    // recurring: gap between the end of one occurrence and the next
+    double intervalMax = 0.0;
+    double durationMin = 0.0;
+    double durationMax = 0.0;
+    int lane = -1;               // -1 picks a random lane
+    EmergencyVehicleType vehicle = EmergencyVehicleType::NONE;  // NONE picks a random type
+    double arrivalRate = 0.0;    // demand: new arrival rate
+};
+
+struct Scenario {
+    std::string name;
+    uint64_t seed = 1;
+    double duration = 600.0;
+    std::vector<ScenarioLane> lanes;
+    std::vector<ScenarioEvent> events;
+
+    // Parse every scenario block in the stream; throws std::runtime_error
+    // naming the source and line on malformed input
+    static std::vector<Scenario> parse(std::istream& input, const std::string& sourceName);
+    static std::vector<Scenario> loadFile(const std::string& path);
+
+    // The random emergency and pedestrian activity of the live simulator
+    static Scenario demo();
+};
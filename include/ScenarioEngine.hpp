@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "Intersection.hpp"
+#include "Scenario.hpp"
+
+struct ScenarioResult {
+    std::string name;
+    uint64_t seed = 0;
+    double simulatedSeconds = 0.0;
+    uint64_t vehiclesArrived = 0;
+    uint64_t vehiclesServed = 0;
+    uint64_t arrivalsBlocked = 0;      // arrivals lost to a full lane
+    int maxQueue = 0;                  // longest single-lane queue
+    double meanQueue = 0.0;            // mean vehicles waiting across all lanes
+    double meanDelay = 0.0;            // seconds per served vehicle (Little's law)
+    double maxStarvation = 0.0;        // longest a non-empty lane waited for green
+    uint32_t emergencies = 0;
+    uint32_t emergenciesServed = 0;    // got a green before the vehicle left
+    double meanPreemptionLatency = 0.0;
+    double maxPreemptionLatency = 0.0;
+    uint32_t pedestrianCrossings = 0;
+    std::string error;                 // set when the run threw; the counters are then empty
+};
+
+struct ScenarioSummary {
+    size_t scenarios = 0;
+    size_t failed = 0;                 // runs with an error, left out of the figures below
+    uint64_t emergencies = 0;
+    uint64_t emergenciesServed = 0;
+    double meanPreemptionLatency = 0.0;
+    double maxPreemptionLatency = 0.0;
+    int maxQueue = 0;
+    double meanDelay = 0.0;
+    double maxStarvation = 0.0;
+};
+
+// Plays a scenario's events and traffic against one intersection. The caller
+// supplies the time: the engine drives it in virtual time, the live simulator
+// from the wall clock.
+class ScenarioSimulation {
+public:
+    static constexpr double kTickSeconds = 0.25;
+
+    ScenarioSimulation(const Scenario& scenario, Intersection& intersection, uint64_t seed);
+
+    // Applies due events, vehicle arrivals and departures for the tick ending at `now` (seconds)
+    void tick(double now);
+    ScenarioResult result() const;
+
+    // Builds an intersection with one lane and light per scenario lane
+    static std::shared_ptr<Intersection> buildIntersection(const Scenario& scenario);
+
+private:
+    enum class ActionType {
+        EMERGENCY_ON,
+        EMERGENCY_OFF,
+        PEDESTRIAN_ON,
+        PEDESTRIAN_OFF,
+        DEMAND
+    };
+
+    struct Action {
+        double time;
+        uint64_t sequence;
+        ActionType type;
+        size_t event;
+        int lane;
+        EmergencyVehicleType vehicle;
+
+        bool operator>(const Action& other) const {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    struct PendingPreemption {
+        int lane;
+        double reportedAt;
+    };
+
+    void schedule(double time, ActionType type, size_t event, int lane = -1,
+                  EmergencyVehicleType vehicle = EmergencyVehicleType::NONE);
+    void scheduleOccurrence(size_t event, double after);
+    void apply(const Action& action);
+    double uniform(double low, double high);
+    int sampleCount(double rate, double dt);
+
+    const Scenario& scenario;
+    Intersection& intersection;
+    std::vector<std::shared_ptr<Lane>> lanes;
+    std::vector<std::shared_ptr<TrafficLight>> lights;
+    std::mt19937_64 rng;
+    std::priority_queue<Action, std::vector<Action>, std::greater<Action>> actions;
+    uint64_t nextSequence = 0;
+
+    std::vector<double> arrivalRates;
+    std::vector<int> activeEmergencies;
+    std::vector<double> lastServed;
+    std::vector<PendingPreemption> pendingPreemptions;
+    int activeCrossings = 0;
+    double lastTick = 0.0;
+
+    ScenarioResult stats;
+    double queueIntegral = 0.0;
+    double latencySum = 0.0;
+};
+
+// Runs many scenarios in parallel, each against its own Intersection on a
+// ManualClock, so hours of traffic replay in milliseconds.
+class ScenarioEngine {
+public:
+    explicit ScenarioEngine(unsigned threads = 0);
+
+    ScenarioResult run(const Scenario& scenario) const;
+    ScenarioResult run(const Scenario& scenario, uint64_t seed) const;
+    ScenarioResult run(const Scenario& scenario, uint64_t seed, const ControllerParams& params) const;
+    // A scenario that throws is reported in its result's `error`; the others still run
+    std::vector<ScenarioResult> runAll(const std::vector<Scenario>& scenarios) const;
+
+    static ScenarioSummary summarize(const std::vector<ScenarioResult>& results);
+
+    // Scenarios without a duration are run for this long
+    static constexpr double kDefaultDuration = 600.0;
+
+private:
+    unsigned threads;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Intersection.hpp"
+
+// Identifies a lane anywhere in a sharded network
+struct LaneAddress {
+    uint32_t shard;
+    uint32_t intersection;
+    uint32_t lane;
+};
+
+// Vehicles leaving `from` while its light is not red enter `to`. Emergency
+// vehicles follow the same link once their approach turns green.
+struct ShardLink {
+    LaneAddress from;
+    LaneAddress to;
+};
+
+struct ShardMessage {
+    enum class Kind : uint8_t {
+        VEHICLE_HANDOFF,
+        EMERGENCY_REPORT
+    };
+
+    Kind kind;
+    EmergencyVehicleType type;
+    uint32_t intersection;
+    uint32_t lane;
+};
+
+struct ShardStats {
+    uint64_t stepsCompleted;
+    uint64_t handoffsSent;
+    uint64_t handoffsReceived;
+    uint64_t handoffsDeferred;       // channel full, vehicle kept in its lane
+    uint64_t handoffsRejected;       // destination lane at capacity
+    uint64_t messagesUndeliverable;  // addressed to a lane this shard does not have
+    uint64_t emergenciesForwarded;
+    int64_t vehiclesInShard;
+};
+
+// Runs a network of intersections split across several local processes. Each
+// process builds and owns one shard; cross-shard traffic travels over
+// lock-free shared-memory rings and all shards advance in lockstep, one
+// barrier per simulated step.
+class ShardedSimulation {
+public:
+    using ShardBuilder = std::function<std::vector<std::shared_ptr<Intersection>>(uint32_t shard)>;
+
+    ShardedSimulation(uint32_t shardCount, ShardBuilder builder);
+
+    void addLink(const ShardLink& link);
+    void setStepPeriod(std::chrono::milliseconds period);
+    uint32_t getShardCount() const;
+
+    // Forks one worker per shard, runs `steps` lockstep steps and returns the
+    // per-shard statistics. Throws std::runtime_error if a worker fails,
+    // including when a link names a lane its shard's builder did not create.
+    std::vector<ShardStats> run(uint64_t steps);
+
+private:
+    void runShard(uint32_t shard, uint64_t steps, void* segment);
+
+    uint32_t shardCount;
+    ShardBuilder builder;
+    std::vector<ShardLink> links;
+    std::chrono::milliseconds stepPeriod;
+};
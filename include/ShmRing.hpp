@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Single-producer / single-consumer ring buffer that can live in memory shared
+// between processes. It holds no pointers, so it works at any mapping address;
+// construct it in place (placement new) inside the shared region.
+template <typename T, size_t Capacity>
+class ShmRing {
+    static_assert(std::is_trivially_copyable<T>::value, "ShmRing elements must be trivially copyable");
+    static_assert((Capacity & (Capacity - 1)) == 0, "ShmRing capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ShmRing needs lock-free 64-bit atomics");
+
+public:
+    ShmRing() : head(0), tail(0) {}
+
+    bool tryPush(const T& item) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire));
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) T slots[Capacity];
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "BoundedQueue.hpp"
+#include "Clock.hpp"
+#include "RcuCell.hpp"
+#include "TrafficLight.hpp"
+
+struct SignalEvent {
+    enum class Kind : uint8_t {
+        STATE_CHANGED,
+        DURATION_CHANGED,
+        EMERGENCY_ON,
+        EMERGENCY_OFF,
+        PEDESTRIAN_ON,
+        PEDESTRIAN_OFF
+    };
+
+    static constexpr uint32_t kIntersectionWide = UINT32_MAX;
+
+    Kind kind;
+    uint32_t light;                   // light index in its intersection, or kIntersectionWide
+    uint32_t source;                  // TrafficLight::getKey() of the publisher, or kIntersectionWide
+    LightState state;                 // STATE_CHANGED: the new state
+    EmergencyVehicleType vehicle;     // EMERGENCY_ON: the vehicle type
+    std::chrono::seconds duration;    // DURATION_CHANGED: the new duration
+    Clock::time_point time;
+    uint64_t sequence;                // per-intersection publication order
+};
+
+// What happens when a subscriber's queue is full
+enum class OverflowPolicy {
+    DROP_NEWEST,   // discard the event being published
+    DROP_OLDEST,   // discard the oldest queued event to make room
+    BLOCK          // wait up to blockTimeout for room, then discard the event
+};
+
+struct SubscriptionOptions {
+    size_t capacity = 1024;
+    OverflowPolicy overflow = OverflowPolicy::DROP_OLDEST;
+    std::chrono::microseconds blockTimeout{200};
+    uint32_t light = SignalEvent::kIntersectionWide;  // only this light's events, or everything
+    // Only events of the light with this key. Unlike the index, the key stays
+    // with the light when the intersection renumbers its lanes.
+    uint32_t source = SignalEvent::kIntersectionWide;
+};
+
+// Consumer end of a subscription. Events are delivered through a lock-free
+// queue owned by this subscriber, so a slow consumer never stalls the
+// publisher for longer than its own overflow policy allows.
+class Subscription {
+public:
+    explicit Subscription(const SubscriptionOptions& options);
+
+    bool tryPop(SignalEvent& event);
+    // Waits up to `timeout` for an event
+    bool waitPop(SignalEvent& event, std::chrono::milliseconds timeout);
+
+    uint64_t dropped() const;
+    uint64_t delivered() const;
+    bool isActive() const;
+
+private:
+    friend class SignalEventHub;
+
+    bool wants(const SignalEvent& event) const;
+    void offer(const SignalEvent& event);
+    void wake();
+
+    SubscriptionOptions options;
+    BoundedQueue<SignalEvent> queue;
+    std::atomic<uint64_t> droppedCount;
+    std::atomic<uint64_t> deliveredCount;
+    std::atomic<bool> active;
+
+    // Consumers parked in waitPop; the publisher only touches the mutex when
+    // one is waiting
+    std::atomic<int> waiters;
+    std::mutex waitMutex;
+    std::condition_variable ready;
+};
+
+// Fan-out point for the events of one intersection. Publishing walks a fixed
+// table of subscriber slots without locks or allocation. Subscribe,
+// unsubscribe and setClock replace the table through an RcuCell, so they wait
+// only for the publishers that were already walking the old table.
+class SignalEventHub {
+public:
+    static constexpr size_t kMaxSubscribers = 16;
+
+    SignalEventHub();
+
+    void setClock(std::shared_ptr<Clock> clock);
+
+    // Returns nullptr when all subscriber slots are taken
+    std::shared_ptr<Subscription> subscribe(const SubscriptionOptions& options = SubscriptionOptions());
+    void unsubscribe(const std::shared_ptr<Subscription>& subscription);
+
+    void publish(SignalEvent::Kind kind, uint32_t light, LightState state = LightState::OFF,
+                 EmergencyVehicleType vehicle = EmergencyVehicleType::NONE,
+                 std::chrono::seconds duration = std::chrono::seconds(0),
+                 uint32_t source = SignalEvent::kIntersectionWide);
+
+private:
+    struct Table {
+        std::shared_ptr<Clock> clock;
+        std::array<std::shared_ptr<Subscription>, kMaxSubscribers> slots;
+    };
+
+    std::atomic<uint64_t> sequence;
+    RcuCell<Table> table;
+};
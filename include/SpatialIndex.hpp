@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Geo.hpp"
+#include "Intersection.hpp"
+
+// Result of routing a position to an approach
+struct LaneMatch {
+    Intersection* intersection = nullptr;  // nullptr when nothing is in range
+    uint32_t intersectionIndex = 0;        // position in the list the index was built from
+    uint32_t lane = 0;                     // lane index within the intersection
+    double distance = 0.0;
+
+    explicit operator bool() const { return intersection != nullptr; }
+};
+
+// Immutable uniform-grid index over intersection locations. Every
+// intersection is entered in each cell its search radius overlaps, so a
+// lookup reads exactly one cell. Cells are radius-sized and only occupied
+// cells are stored: a sorted key per cell, CSR-style offsets into one flat
+// candidate array, so memory follows the network size rather than its
+// extent. Nothing changes after build(), so any number of threads can query a
+// shared index without synchronisation; publish a rebuilt index by swapping a
+// std::shared_ptr<const SpatialIndex>.
+class SpatialIndex {
+public:
+    // `radius` is how far from an intersection a report can still be routed to it
+    static std::shared_ptr<const SpatialIndex> build(const std::vector<std::shared_ptr<Intersection>>& intersections,
+                                                     double radius);
+
+    // Routes a report to the intersection the reporter is approaching and the
+    // approach whose heading best matches `heading`. A NaN heading (e.g. a
+    // fixed pedestrian button) picks the nearest intersection and the approach
+    // pointing from the reporter towards it. With a heading, intersections
+    // behind the reporter are skipped unless it is already at the stop line.
+    LaneMatch locate(const Position& position, double heading) const;
+
+    size_t intersectionCount() const;
+    // Occupied cells only
+    size_t cellCount() const;
+
+    // Within this distance an intersection matches regardless of heading
+    static constexpr double kStopLineDistance = 15.0;
+    // Largest heading mismatch accepted when choosing an approach
+    static constexpr double kMaxHeadingError = 60.0;
+
+private:
+    SpatialIndex() = default;
+
+    // row << 32 | column
+    uint64_t cellOf(double x, double y) const;
+
+    double radius = 0.0;
+    double minX = 0.0;
+    double minY = 0.0;
+    double cellSize = 1.0;
+    size_t columns = 0;
+    size_t rows = 0;
+
+    std::vector<uint64_t> cellKeys;     // occupied cells, ascending
+    std::vector<uint32_t> cellStart;    // cellKeys + 1 offsets
+    std::vector<uint32_t> candidates;   // intersection indices per cell
+
+    // Per intersection, structure of arrays
+    std::vector<std::shared_ptr<Intersection>> intersections;
+    std::vector<double> locationX;
+    std::vector<double> locationY;
+    std::vector<uint32_t> approachStart;   // intersections + 1 offsets
+    std::vector<double> approachHeading;
+    std::vector<uint32_t> approachLane;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Intersection;
+
+struct TimeSeriesSample {
+    int64_t time;    // milliseconds
+    double value;
+};
+
+struct RollupBucket {
+    int64_t start;   // milliseconds, aligned to the resolution
+    uint32_t count;
+    double min;
+    double max;
+    double sum;
+
+    double mean() const { return count ? sum / count : 0.0; }
+};
+
+enum class RollupResolution {
+    MINUTE,
+    QUARTER_HOUR,
+    HOUR
+};
+
+// Embedded append-only store for lane and signal history.
+//
+// Each series is a file of compressed blocks: timestamps are delta-of-delta
+// varints and values are XOR-compressed (Gorilla), stored as two columns per
+// block. A block header carries the time range and min/max/sum, so range scans
+// binary-search the block index and decode only overlapping blocks through a
+// read-only memory map. 1 min, 15 min and 1 h aggregates are maintained on
+// append and stored as fixed-size records next to the block file.
+//
+// Timestamps must be non-decreasing per series. Samples are buffered in memory
+// until a block fills or flush() is called; queries also see buffered samples.
+class TimeSeriesStore {
+public:
+    static constexpr size_t kBlockSamples = 1024;
+
+    // Opens (creating if needed) the store in `directory`
+    explicit TimeSeriesStore(const std::string& directory);
+    ~TimeSeriesStore();
+
+    TimeSeriesStore(const TimeSeriesStore&) = delete;
+    TimeSeriesStore& operator=(const TimeSeriesStore&) = delete;
+
+    void append(const std::string& series, int64_t time, double value);
+    void flush();
+
+    // Samples with t0 <= time < t1
+    std::vector<TimeSeriesSample> range(const std::string& series, int64_t t0, int64_t t1) const;
+    // Aggregates whose bucket starts in [t0, t1), including the open bucket
+    std::vector<RollupBucket> rollup(const std::string& series, RollupResolution resolution,
+                                     int64_t t0, int64_t t1) const;
+
+    std::vector<std::string> seriesNames() const;
+    uint64_t sampleCount(const std::string& series) const;
+    // Bytes of raw samples on disk, excluding rollups
+    uint64_t compressedBytes(const std::string& series) const;
+
+    static int64_t resolutionMillis(RollupResolution resolution);
+
+private:
+    struct Series;
+
+    Series& seriesFor(const std::string& name);
+    const Series* findSeries(const std::string& name) const;
+    void loadCatalog();
+    void openSeries(uint32_t id, const std::string& name);
+    void flushSeries(Series& series);
+    void accumulate(Series& series, size_t level, int64_t time, double value);
+    void writeRollup(Series& series, size_t level, const RollupBucket& bucket);
+
+    std::string directory;
+    std::unordered_map<std::string, std::unique_ptr<Series>> series;
+    mutable std::mutex mutex;
+};
+
+// Appends one sample per lane ("<intersection>/<lane>/occupancy") and per
+// light ("<intersection>/<light>/state", the LightState as a number)
+void recordIntersectionHistory(TimeSeriesStore& store, const Intersection& intersection, int64_t time);
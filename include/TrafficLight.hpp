@@ -2,8 +2,11 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
+#include "RcuCell.hpp"
 
 enum class LightState {
     OFF,
@@ -19,6 +22,10 @@ enum class EmergencyVehicleType {
     FIRE_TRUCK
 };
 
+class SignalEventHub;
+class Subscription;
+struct SubscriptionOptions;
+
 class TrafficLight {
 public:
     TrafficLight(const std::string& id);
@@ -26,7 +33,9 @@ public:
 
     void setState(LightState newState);
     LightState getState() const;
-    std::string getId() const;
+    const std::string& getId() const;
+    // Process-unique, fixed for the light's lifetime; events carry it as SignalEvent::source
+    uint32_t getKey() const;
     void setDuration(std::chrono::seconds duration);
     std::chrono::seconds getDuration() const;
     
@@ -36,11 +45,25 @@ public:
     bool isInEmergencyMode() const;
     EmergencyVehicleType getEmergencyVehicleType() const;
 
+    // Change notifications. A light publishes to the hub of the intersection
+    // it was added to; a standalone light creates its own hub on first use.
+    // Safe while other threads change the light: a replaced hub is released
+    // only after the publishes already using it have finished.
+    void attachEventHub(std::shared_ptr<SignalEventHub> hub, uint32_t index);
+    std::shared_ptr<Subscription> subscribe();
+    std::shared_ptr<Subscription> subscribe(const SubscriptionOptions& options);
+
 private:
     std::string id;
+    const uint32_t key;
     std::atomic<LightState> currentState;
     std::chrono::seconds stateDuration;
     std::atomic<bool> emergencyMode;
     std::atomic<EmergencyVehicleType> emergencyVehicleType;
     mutable std::mutex mutex;
+    struct EventBinding {
+        std::shared_ptr<SignalEventHub> hub;
+        uint32_t index = 0;   // re-assigned when the intersection closes a lane
+    };
+    RcuCell<EventBinding> events;
 };
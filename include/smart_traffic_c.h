@@ -0,0 +1,109 @@
+#ifndef SMART_TRAFFIC_C_H
+#define SMART_TRAFFIC_C_H
+
+/*
+ * C interface to the traffic controller, for embedding from other languages.
+ *
+ * A network owns intersections, each with its own simulated clock, and
+ * advances them together with stl_network_step(). Lanes are addressed by the
+ * handle stl_network_add_lane() returns; handles are dense, in creation
+ * order, and index the state arrays.
+ *
+ * The state arrays (vehicle counts and light states, one entry per lane) are
+ * owned by the network and kept up to date by every call that changes them,
+ * so callers read them in place. They stay valid until the next
+ * stl_network_add_lane() or stl_network_destroy(). A network must not be used
+ * from two threads at once; different networks are independent.
+ *
+ * Functions that can fail return STL_OK or a negative status, and
+ * stl_last_error() describes the most recent failure on the calling thread.
+ * The ABI only grows: existing functions and values keep their meaning, and
+ * stl_abi_version() reports what the loaded library provides.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(STL_BUILDING_C_API)
+#    define STL_API __declspec(dllexport)
+#  else
+#    define STL_API __declspec(dllimport)
+#  endif
+#else
+#  define STL_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STL_ABI_VERSION 1
+
+typedef struct stl_network stl_network;
+typedef uint32_t stl_intersection;
+typedef uint32_t stl_lane;
+
+enum {
+    STL_OK = 0,
+    STL_INVALID_ARGUMENT = -1,  /* null pointer, unknown handle or bad value */
+    STL_ERROR = -2              /* anything else; see stl_last_error() */
+};
+
+/* Values of the light state array; the same order as LightState */
+enum {
+    STL_LIGHT_OFF = 0,
+    STL_LIGHT_RED = 1,
+    STL_LIGHT_YELLOW = 2,
+    STL_LIGHT_GREEN = 3
+};
+
+enum {
+    STL_EMERGENCY_NONE = 0,
+    STL_EMERGENCY_AMBULANCE = 1,
+    STL_EMERGENCY_POLICE = 2,
+    STL_EMERGENCY_FIRE_TRUCK = 3
+};
+
+/* Caller-visible state, valid as described above. Set struct_size to
+ * sizeof(stl_state_view) before calling stl_network_state(): the library
+ * fills only that many bytes, so fields added later never write past a
+ * struct compiled against an older header. */
+typedef struct stl_state_view {
+    size_t struct_size;
+    size_t lane_count;
+    const int32_t* vehicle_counts;  /* lane_count entries */
+    const uint8_t* light_states;    /* lane_count entries, STL_LIGHT_* */
+    uint64_t step_count;
+} stl_state_view;
+
+STL_API uint32_t stl_abi_version(void);
+STL_API const char* stl_last_error(void);
+
+STL_API stl_network* stl_network_create(void);
+STL_API void stl_network_destroy(stl_network* network);
+
+STL_API int stl_network_add_intersection(stl_network* network, const char* id, stl_intersection* out);
+STL_API int stl_network_add_lane(stl_network* network, stl_intersection intersection, const char* id,
+                                 int32_t capacity, stl_lane* out);
+
+/* Events. Counts are clamped to the lane's capacity and to zero; `applied`
+ * (may be null) receives how many vehicles actually arrived or left. */
+STL_API int stl_lane_arrive(stl_network* network, stl_lane lane, int32_t vehicles, int32_t* applied);
+STL_API int stl_lane_depart(stl_network* network, stl_lane lane, int32_t vehicles, int32_t* applied);
+STL_API int stl_lane_report_emergency(stl_network* network, stl_lane lane, int type);
+STL_API int stl_lane_clear_emergency(stl_network* network, stl_lane lane);
+STL_API int stl_intersection_request_crossing(stl_network* network, stl_intersection intersection);
+STL_API int stl_intersection_clear_crossing(stl_network* network, stl_intersection intersection);
+
+/* Advances every intersection's clock by `milliseconds` and runs one control tick each */
+STL_API int stl_network_step(stl_network* network, uint32_t milliseconds);
+
+/* STL_INVALID_ARGUMENT if out->struct_size does not cover struct_size itself */
+STL_API int stl_network_state(const stl_network* network, stl_state_view* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMART_TRAFFIC_C_H */
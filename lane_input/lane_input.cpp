@@ -1,106 +1,191 @@
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <iomanip>
+#include "Intersection.hpp"
+
+// Operator scenario checker. Light and priority decisions come from the
+// library's Intersection controller, driven on a manual clock so that both the
+// interactive menu and the scripted batch mode are deterministic.
+
+namespace {
+
+constexpr int kDefaultCapacity = 100;
+constexpr int kDischargePerCommand = 5;
+constexpr auto kControlPeriod = std::chrono::milliseconds(500);
+
+struct Junction {
+    std::shared_ptr<Intersection> intersection;
+    std::shared_ptr<ManualClock> clock;
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<Lane>> lanes;
+    std::vector<std::shared_ptr<TrafficLight>> lights;
+    uint64_t ticks = 0;
+
+    explicit Junction(int capacity)
+        : intersection(std::make_shared<Intersection>("lane_input"))
+        , clock(std::make_shared<ManualClock>())
+        , names{"North", "South", "East", "West"}
+    {
+        intersection->setClock(clock);
+        for (const auto& name : names) {
+            lanes.push_back(std::make_shared<Lane>(name, capacity));
+            lights.push_back(std::make_shared<TrafficLight>(name + " Light"));
+            intersection->addLane(lanes.back(), lights.back());
+        }
+    }
+
+    int findLane(std::string_view name) const {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void step(uint64_t count) {
+        for (uint64_t i = 0; i < count; ++i) {
+            clock->advance(kControlPeriod);
+            intersection->step();
+            ++ticks;
+        }
+    }
 
-struct LaneInfo {
-    std::string name;
-    int numVehicles;
-    std::string emergencyType;
-    std::string trafficLight;
-    std::string priorityStatus;
+    void addVehicles(int laneIdx, int count) {
+        lanes[laneIdx]->addVehicles(count);
+    }
+
+    void removeVehicles(int laneIdx, int count) {
+        lanes[laneIdx]->removeVehicles(count);
+    }
+
+    // Vehicles leave every green approach. An emergency vehicle has passed
+    // once its lane is empty, so its priority request is withdrawn.
+    int discharge(int count) {
+        int discharged = 0;
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            if (lights[i]->getState() != LightState::GREEN || intersection->isPedestrianCrossingActive()) {
+                continue;
+            }
+            removeVehicles(static_cast<int>(i), count);
+            if (lanes[i]->getVehicleCount() == 0 && lanes[i]->hasEmergencyVehicle()) {
+                intersection->clearEmergencyVehicle(names[i]);
+            }
+            ++discharged;
+        }
+        return discharged;
+    }
 };
 
-std::string getEmergencyIcon(const std::string& type) {
-    if (type == "Police") return "🚓 Police";
-    if (type == "Ambulance") return "🚑 Ambulance";
-    if (type == "Fire Truck") return "🚒 Fire Truck";
-    return "None";
+bool parseEmergencyType(std::string_view token, EmergencyVehicleType& type) {
+    char folded[16];
+    size_t length = 0;
+    for (char c : token) {
+        if (c == ' ' || c == '_') continue;
+        if (length == sizeof(folded)) return false;
+        folded[length++] = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    std::string_view lower(folded, length);
+    if (lower == "police") type = EmergencyVehicleType::POLICE;
+    else if (lower == "ambulance") type = EmergencyVehicleType::AMBULANCE;
+    else if (lower == "firetruck" || lower == "fire") type = EmergencyVehicleType::FIRE_TRUCK;
+    else if (lower == "none") type = EmergencyVehicleType::NONE;
+    else return false;
+    return true;
+}
+
+char lightCode(LightState state) {
+    switch (state) {
+        case LightState::GREEN: return 'G';
+        case LightState::YELLOW: return 'Y';
+        case LightState::RED: return 'R';
+        default: return '-';
+    }
+}
+
+char emergencyCode(EmergencyVehicleType type) {
+    switch (type) {
+        case EmergencyVehicleType::POLICE: return 'P';
+        case EmergencyVehicleType::AMBULANCE: return 'A';
+        case EmergencyVehicleType::FIRE_TRUCK: return 'F';
+        default: return '-';
+    }
+}
+
+// ---------------------------------------------------------------- interactive
+
+std::string getEmergencyIcon(EmergencyVehicleType type) {
+    switch (type) {
+        case EmergencyVehicleType::POLICE: return "🚓 Police";
+        case EmergencyVehicleType::AMBULANCE: return "🚑 Ambulance";
+        case EmergencyVehicleType::FIRE_TRUCK: return "🚒 Fire Truck";
+        default: return "None";
+    }
 }
 
-std::string getTrafficLightIcon(const std::string& color) {
-    if (color == "GREEN") return "\x1b[32mGREEN\x1b[0m";
+std::string getTrafficLightIcon(LightState state) {
+    if (state == LightState::GREEN) return "\x1b[32mGREEN\x1b[0m";
+    if (state == LightState::YELLOW) return "\x1b[33mYELLOW\x1b[0m";
     return "\x1b[31mRED\x1b[0m";
 }
 
-std::string getPriorityIcon(const std::string& status) {
-    if (status == "Active") return "\x1b[32mActive\x1b[0m";
+std::string getPriorityIcon(bool active) {
+    if (active) return "\x1b[32mActive\x1b[0m";
     return "\x1b[31mWaiting\x1b[0m";
 }
 
-int main() {
-    std::vector<LaneInfo> lanes = {
-        {"North", 0, "None", "RED", "Waiting"},
-        {"South", 0, "None", "RED", "Waiting"},
-        {"East", 0, "None", "RED", "Waiting"},
-        {"West", 0, "None", "RED", "Waiting"}
-    };
+void printTable(const Junction& junction) {
+    std::cout << "\n+--------+---------------+-------------------+--------------+-----------------+\n";
+    std::cout << "| Lane   | No. of Vehicles | Emergency Type   | Traffic Light | Priority Status |\n";
+    std::cout << "+--------+---------------+-------------------+--------------+-----------------+\n";
+    for (size_t i = 0; i < junction.lanes.size(); ++i) {
+        const auto& lane = junction.lanes[i];
+        LightState state = junction.lights[i]->getState();
+        bool active = state == LightState::GREEN || lane->hasEmergencyVehicle();
+        std::cout << "| " << std::setw(6) << junction.names[i]
+                  << " | " << std::setw(13) << lane->getVehicleCount()
+                  << " | " << std::setw(17) << getEmergencyIcon(lane->getEmergencyVehicleType())
+                  << " | " << std::setw(12) << getTrafficLightIcon(state)
+                  << " | " << std::setw(15) << getPriorityIcon(active)
+                  << " |\n";
+    }
+    std::cout << "+--------+---------------+-------------------+--------------+-----------------+\n";
+}
 
+int runInteractive(Junction& junction) {
     std::cout << "Enter number of vehicles and emergency type for each lane.\n";
     std::cout << "Available emergency types: None, Police, Ambulance, Fire Truck\n";
-    for (auto& lane : lanes) {
-        std::cout << lane.name << " lane - Vehicles: ";
-        std::cin >> lane.numVehicles;
-        std::cout << lane.name << " lane - Emergency type (choose from: None, Police, Ambulance, Fire Truck): ";
+    for (size_t i = 0; i < junction.lanes.size(); ++i) {
+        int vehicles = 0;
+        std::string emergencyType;
+        std::cout << junction.names[i] << " lane - Vehicles: ";
+        std::cin >> vehicles;
+        std::cout << junction.names[i] << " lane - Emergency type (choose from: None, Police, Ambulance, Fire Truck): ";
         std::cin.ignore();
-        std::getline(std::cin, lane.emergencyType);
-        if (lane.emergencyType != "None") {
-            lane.priorityStatus = "Active";
+        std::getline(std::cin, emergencyType);
+        junction.addVehicles(static_cast<int>(i), vehicles);
+        EmergencyVehicleType type;
+        if (parseEmergencyType(emergencyType, type) && type != EmergencyVehicleType::NONE) {
+            junction.intersection->reportEmergencyVehicle(junction.names[i], type);
         }
     }
+    junction.step(1);
+    printTable(junction);
 
-    // Set traffic light: only one lane can be green (priority: emergency > max vehicles)
-    int greenIdx = -1;
-    for (int i = 0; i < 4; ++i) {
-        if (lanes[i].emergencyType != "None") {
-            greenIdx = i;
+    while (std::cin) {
+        std::cout << "\nOptions:\n1. Add vehicle\n2. Set emergency\n3. Add pedestrian waiting\n4. Remove pedestrian waiting\n5. Show table\n6. Decrease vehicles in green lane\n7. Exit\nChoose option: ";
+        int option = 0;
+        if (!(std::cin >> option)) {
             break;
         }
-    }
-    if (greenIdx == -1) {
-        int maxVehicles = -1;
-        for (int i = 0; i < 4; ++i) {
-            if (lanes[i].numVehicles > maxVehicles) {
-                maxVehicles = lanes[i].numVehicles;
-                greenIdx = i;
-            }
-        }
-    }
-    for (int i = 0; i < 4; ++i) {
-        if (i == greenIdx) {
-            lanes[i].trafficLight = "GREEN";
-            lanes[i].priorityStatus = "Active";
-        } else {
-            lanes[i].trafficLight = "RED";
-            if (lanes[i].priorityStatus != "Active")
-                lanes[i].priorityStatus = "Waiting";
-        }
-    }
-
-    // Print table function
-    auto printTable = [&]() {
-        std::cout << "\n+--------+---------------+-------------------+--------------+-----------------+\n";
-        std::cout << "| Lane   | No. of Vehicles | Emergency Type   | Traffic Light | Priority Status |\n";
-        std::cout << "+--------+---------------+-------------------+--------------+-----------------+\n";
-        for (const auto& lane : lanes) {
-            std::cout << "| " << std::setw(6) << lane.name
-                      << " | " << std::setw(13) << lane.numVehicles
-                      << " | " << std::setw(17) << getEmergencyIcon(lane.emergencyType)
-                      << " | " << std::setw(12) << getTrafficLightIcon(lane.trafficLight)
-                      << " | " << std::setw(15) << getPriorityIcon(lane.priorityStatus)
-                      << " |\n";
-        }
-        std::cout << "+--------+---------------+-------------------+--------------+-----------------+\n";
-    };
-    printTable();
-
-    // Pedestrian crossing
-    bool pedestrianWaiting = false;
-
-    while (true) {
-        std::cout << "\nOptions:\n1. Add vehicle\n2. Set emergency\n3. Add pedestrian waiting\n4. Remove pedestrian waiting\n5. Show table\n6. Decrease vehicles in green lane\n7. Exit\nChoose option: ";
-        int option;
-        std::cin >> option;
         if (option == 1) {
             std::string laneName;
             int addCount = 1;
@@ -108,174 +193,63 @@ int main() {
             std::cin >> laneName;
             std::cout << "How many vehicles to add? ";
             std::cin >> addCount;
-            for (auto& lane : lanes) {
-                if (lane.name == laneName) {
-                    lane.numVehicles += addCount;
-                    break;
-                }
+            int laneIdx = junction.findLane(laneName);
+            if (laneIdx < 0) {
+                std::cout << "Unknown lane.\n";
+                continue;
             }
+            junction.addVehicles(laneIdx, addCount);
         } else if (option == 2) {
             std::string laneName;
             std::cout << "Enter lane name (North/South/East/West): ";
             std::cin >> laneName;
             std::cout << "1. Add emergency\n2. Remove emergency\nChoose: ";
-            int emOpt;
+            int emOpt = 0;
             std::cin >> emOpt;
             std::cin.ignore();
+            int laneIdx = junction.findLane(laneName);
+            if (laneIdx < 0) {
+                std::cout << "Unknown lane.\n";
+                continue;
+            }
             if (emOpt == 1) {
                 std::string emergencyType;
                 std::cout << "Enter emergency type (Police/Ambulance/Fire Truck): ";
                 std::getline(std::cin, emergencyType);
-                for (auto& lane : lanes) {
-                    if (lane.name == laneName) {
-                        lane.emergencyType = emergencyType;
-                        lane.priorityStatus = "Active";
-                        break;
-                    }
+                EmergencyVehicleType type;
+                if (parseEmergencyType(emergencyType, type) && type != EmergencyVehicleType::NONE) {
+                    junction.intersection->reportEmergencyVehicle(junction.names[laneIdx], type);
+                } else {
+                    std::cout << "Unknown emergency type.\n";
                 }
             } else if (emOpt == 2) {
-                for (auto& lane : lanes) {
-                    if (lane.name == laneName) {
-                        lane.emergencyType = "None";
-                        lane.priorityStatus = "Waiting";
-                        break;
-                    }
-                }
+                junction.intersection->clearEmergencyVehicle(junction.names[laneIdx]);
             } else {
                 std::cout << "Invalid option.\n";
             }
         } else if (option == 3) {
-            pedestrianWaiting = true;
+            junction.intersection->requestPedestrianCrossing();
             std::cout << "Pedestrian is now waiting to cross the road!\n";
         } else if (option == 4) {
-            pedestrianWaiting = false;
+            junction.intersection->clearPedestrianCrossing();
             std::cout << "Pedestrian is no longer waiting to cross the road.\n";
         } else if (option == 5) {
-            // Emergency has higher priority than pedestrian
+            junction.step(1);
+            printTable(junction);
             bool anyEmergency = false;
-            for (int i = 0; i < 4; ++i) {
-                if (lanes[i].emergencyType != "None") {
-                    anyEmergency = true;
-                    break;
-                }
-            }
-            if (anyEmergency) {
-                int greenIdx = -1;
-                for (int i = 0; i < 4; ++i) {
-                    if (lanes[i].emergencyType != "None") {
-                        greenIdx = i;
-                        break;
-                    }
-                }
-                if (greenIdx == -1) {
-                    int maxVehicles = -1;
-                    for (int i = 0; i < 4; ++i) {
-                        if (lanes[i].numVehicles > maxVehicles) {
-                            maxVehicles = lanes[i].numVehicles;
-                            greenIdx = i;
-                        }
-                    }
-                }
-                for (int i = 0; i < 4; ++i) {
-                    if (i == greenIdx) {
-                        lanes[i].trafficLight = "GREEN";
-                        lanes[i].priorityStatus = "Active";
-                    } else {
-                        lanes[i].trafficLight = "RED";
-                        if (lanes[i].priorityStatus != "Active")
-                            lanes[i].priorityStatus = "Waiting";
-                    }
-                }
-            } else if (pedestrianWaiting) {
-                for (int i = 0; i < 4; ++i) {
-                    lanes[i].trafficLight = "RED";
-                    if (lanes[i].priorityStatus != "Active")
-                        lanes[i].priorityStatus = "Waiting";
-                }
-            } else {
-                int greenIdx = -1;
-                for (int i = 0; i < 4; ++i) {
-                    if (lanes[i].numVehicles > 0) {
-                        if (greenIdx == -1 || lanes[i].numVehicles > lanes[greenIdx].numVehicles) {
-                            greenIdx = i;
-                        }
-                    }
-                }
-                for (int i = 0; i < 4; ++i) {
-                    if (i == greenIdx && greenIdx != -1) {
-                        lanes[i].trafficLight = "GREEN";
-                        lanes[i].priorityStatus = "Active";
-                    } else {
-                        lanes[i].trafficLight = "RED";
-                        if (lanes[i].priorityStatus != "Active")
-                            lanes[i].priorityStatus = "Waiting";
-                    }
-                }
+            for (const auto& lane : junction.lanes) {
+                anyEmergency = anyEmergency || lane->hasEmergencyVehicle();
             }
-            printTable();
-            if (pedestrianWaiting && !anyEmergency) {
+            if (junction.intersection->isPedestrianCrossingActive() && !anyEmergency) {
                 std::cout << "\n[Pedestrian is waiting to cross the road!]\n";
             }
         } else if (option == 6) {
-            // Decrease vehicles in green lane by 5
-            int greenIdx = -1;
-            if (!pedestrianWaiting) {
-                for (int i = 0; i < 4; ++i) {
-                    if (lanes[i].trafficLight == "GREEN") {
-                        greenIdx = i;
-                        break;
-                    }
-                }
-                if (greenIdx != -1) {
-                    if (lanes[greenIdx].numVehicles >= 5)
-                        lanes[greenIdx].numVehicles -= 5;
-                    else
-                        lanes[greenIdx].numVehicles = 0;
-                    std::cout << "Decreased vehicles in " << lanes[greenIdx].name << " lane by 5.\n";
-                    // If vehicles become zero and emergency is set, remove emergency and reassign green
-                    if (lanes[greenIdx].numVehicles == 0 && lanes[greenIdx].emergencyType != "None") {
-                        lanes[greenIdx].emergencyType = "None";
-                        lanes[greenIdx].priorityStatus = "Waiting";
-                        // Find next eligible lane (with emergency and vehicles > 0)
-                        int nextGreen = -1;
-                        for (int i = 0; i < 4; ++i) {
-                            if (i != greenIdx && lanes[i].emergencyType != "None" && lanes[i].numVehicles > 0) {
-                                nextGreen = i;
-                                break;
-                            }
-                        }
-                        // If none, pick lane with max vehicles > 0
-                        if (nextGreen == -1) {
-                            int maxVehicles = -1;
-                            for (int i = 0; i < 4; ++i) {
-                                if (i != greenIdx && lanes[i].numVehicles > maxVehicles) {
-                                    maxVehicles = lanes[i].numVehicles;
-                                    nextGreen = i;
-                                }
-                            }
-                            if (maxVehicles <= 0) nextGreen = -1;
-                        }
-                        // Set green or all red
-                        for (int i = 0; i < 4; ++i) {
-                            if (i == nextGreen && nextGreen != -1) {
-                                lanes[i].trafficLight = "GREEN";
-                                lanes[i].priorityStatus = "Active";
-                            } else {
-                                lanes[i].trafficLight = "RED";
-                                if (lanes[i].priorityStatus != "Active")
-                                    lanes[i].priorityStatus = "Waiting";
-                            }
-                        }
-                        if (nextGreen == -1)
-                            std::cout << "Emergency removed from " << lanes[greenIdx].name << ". No eligible lane for green light. All lights are red.\n";
-                        else
-                            std::cout << "Emergency removed from " << lanes[greenIdx].name << ". Green light reassigned.\n";
-                    }
-                } else {
-                    std::cout << "No green light lane to decrease vehicles.\n";
-                }
-            } else {
+            if (junction.intersection->isPedestrianCrossingActive()) {
                 std::cout << "Cannot decrease vehicles while pedestrian is waiting.\n";
+            } else if (junction.discharge(kDischargePerCommand) == 0) {
+                std::cout << "No green light lane to decrease vehicles.\n";
+            } else {
+                std::cout << "Decreased vehicles in green lane by " << kDischargePerCommand << ".\n";
             }
         } else if (option == 7) {
             break;
@@ -285,3 +259,231 @@ int main() {
     }
     return 0;
 }
+
+// ---------------------------------------------------------------------- batch
+
+// Buffered writer for the state lines emitted by the batch mode
+class OutputBuffer {
+public:
+    explicit OutputBuffer(FILE* out) : out(out), used(0) {}
+    ~OutputBuffer() { flush(); }
+
+    void put(char c) {
+        if (used == sizeof(buffer)) flush();
+        buffer[used++] = c;
+    }
+
+    void put(std::string_view text) {
+        for (char c : text) put(c);
+    }
+
+    void putNumber(uint64_t value) {
+        char digits[24];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) put(digits[--n]);
+    }
+
+    void flush() {
+        if (used > 0) {
+            std::fwrite(buffer, 1, used, out);
+            used = 0;
+        }
+    }
+
+private:
+    FILE* out;
+    size_t used;
+    char buffer[1 << 16];
+};
+
+// One line per state dump: "<ms> North=<count><light><emergency> ... [P]"
+void writeState(const Junction& junction, OutputBuffer& output) {
+    output.putNumber(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(junction.clock->now().time_since_epoch()).count()));
+    for (size_t i = 0; i < junction.lanes.size(); ++i) {
+        output.put(' ');
+        output.put(junction.names[i]);
+        output.put('=');
+        output.putNumber(static_cast<uint64_t>(junction.lanes[i]->getVehicleCount()));
+        output.put(lightCode(junction.lights[i]->getState()));
+        output.put(emergencyCode(junction.lanes[i]->getEmergencyVehicleType()));
+    }
+    if (junction.intersection->isPedestrianCrossingActive()) {
+        output.put(" P");
+    }
+    output.put('\n');
+}
+
+std::string_view nextToken(std::string_view& line) {
+    size_t start = 0;
+    while (start < line.size() && (line[start] == ' ' || line[start] == '\t' || line[start] == '\r')) ++start;
+    size_t end = start;
+    while (end < line.size() && line[end] != ' ' && line[end] != '\t' && line[end] != '\r') ++end;
+    std::string_view token = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return token;
+}
+
+// Counts are passed on as int, so anything above INT_MAX is malformed
+bool parseCount(std::string_view token, uint64_t& value) {
+    if (token.empty()) return false;
+    value = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+        if (value > static_cast<uint64_t>(std::numeric_limits<int>::max())) return false;
+    }
+    return true;
+}
+
+// Executes one command line. Returns false on a malformed command.
+bool executeCommand(Junction& junction, std::string_view line, OutputBuffer& output, bool echoSteps) {
+    std::string_view command = nextToken(line);
+    if (command.empty() || command[0] == '#') {
+        return true;
+    }
+    std::string_view arg1 = nextToken(line);
+    std::string_view arg2 = nextToken(line);
+    uint64_t count = 1;
+
+    if (command == "add" || command == "remove") {
+        int laneIdx = junction.findLane(arg1);
+        if (laneIdx < 0 || (!arg2.empty() && !parseCount(arg2, count))) return false;
+        if (command == "add") junction.addVehicles(laneIdx, static_cast<int>(count));
+        else junction.removeVehicles(laneIdx, static_cast<int>(count));
+    } else if (command == "emergency") {
+        int laneIdx = junction.findLane(arg1);
+        EmergencyVehicleType type;
+        if (laneIdx < 0 || !parseEmergencyType(arg2, type)) return false;
+        if (type == EmergencyVehicleType::NONE) {
+            junction.intersection->clearEmergencyVehicle(junction.names[laneIdx]);
+        } else {
+            junction.intersection->reportEmergencyVehicle(junction.names[laneIdx], type);
+        }
+    } else if (command == "clear") {
+        int laneIdx = junction.findLane(arg1);
+        if (laneIdx < 0) return false;
+        junction.intersection->clearEmergencyVehicle(junction.names[laneIdx]);
+    } else if (command == "pedestrian") {
+        if (arg1 == "on") junction.intersection->requestPedestrianCrossing();
+        else if (arg1 == "off") junction.intersection->clearPedestrianCrossing();
+        else return false;
+    } else if (command == "discharge") {
+        if (!arg1.empty() && !parseCount(arg1, count)) return false;
+        if (arg1.empty()) count = kDischargePerCommand;
+        junction.discharge(static_cast<int>(count));
+    } else if (command == "step") {
+        if (!arg1.empty() && !parseCount(arg1, count)) return false;
+        junction.step(count);
+        if (echoSteps) writeState(junction, output);
+    } else if (command == "show") {
+        writeState(junction, output);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int runBatch(Junction& junction, FILE* input, bool echoSteps) {
+    OutputBuffer output(stdout);
+    std::vector<char> buffer(1 << 20);
+    size_t pending = 0;
+    uint64_t lineNumber = 0;
+
+    while (true) {
+        size_t read = std::fread(buffer.data() + pending, 1, buffer.size() - pending, input);
+        size_t available = pending + read;
+        bool atEnd = read == 0;
+        size_t start = 0;
+        for (size_t i = 0; i < available; ++i) {
+            if (buffer[i] != '\n') continue;
+            ++lineNumber;
+            if (!executeCommand(junction, std::string_view(buffer.data() + start, i - start), output, echoSteps)) {
+                output.flush();
+                std::fprintf(stderr, "lane_input: invalid command on line %llu\n",
+                             static_cast<unsigned long long>(lineNumber));
+                return 1;
+            }
+            start = i + 1;
+        }
+        pending = available - start;
+        if (atEnd) {
+            if (pending > 0) {
+                ++lineNumber;
+                if (!executeCommand(junction, std::string_view(buffer.data() + start, pending), output, echoSteps)) {
+                    output.flush();
+                    std::fprintf(stderr, "lane_input: invalid command on line %llu\n",
+                                 static_cast<unsigned long long>(lineNumber));
+                    return 1;
+                }
+            }
+            break;
+        }
+        if (pending == buffer.size()) {
+            std::fprintf(stderr, "lane_input: line %llu is too long\n",
+                         static_cast<unsigned long long>(lineNumber + 1));
+            return 1;
+        }
+        std::memmove(buffer.data(), buffer.data() + start, pending);
+    }
+    return 0;
+}
+
+void printUsage() {
+    std::cerr << "Usage: lane_input [--batch [FILE|-]] [--quiet] [--capacity N]\n"
+              << "  Without --batch the interactive menu is started.\n"
+              << "  Batch commands: add LANE [N], remove LANE [N], emergency LANE TYPE,\n"
+              << "                  clear LANE, pedestrian on|off, discharge [N], step [N], show\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool batch = false;
+    bool echoSteps = true;
+    const char* inputPath = "-";
+    int capacity = kDefaultCapacity;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--batch") {
+            batch = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') inputPath = argv[++i];
+            else if (i + 1 < argc && std::string_view(argv[i + 1]) == "-") ++i;
+        } else if (arg == "--quiet") {
+            echoSteps = false;
+        } else if (arg == "--capacity" && i + 1 < argc) {
+            capacity = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (capacity <= 0) {
+        printUsage();
+        return 2;
+    }
+
+    Junction junction(capacity);
+    if (!batch) {
+        return runInteractive(junction);
+    }
+
+    FILE* input = stdin;
+    if (std::string_view(inputPath) != "-") {
+        input = std::fopen(inputPath, "rb");
+        if (!input) {
+            std::cerr << "lane_input: cannot open " << inputPath << "\n";
+            return 1;
+        }
+    }
+    int status = runBatch(junction, input, echoSteps);
+    if (input != stdin) {
+        std::fclose(input);
+    }
+    return status;
+}
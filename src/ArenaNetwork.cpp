@@ -0,0 +1,260 @@
+#include "ArenaNetwork.hpp"
+#include "GreedyPolicy.hpp"
+#include "LaneStatistics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+size_t ArenaNetwork::arenaSize(size_t maxIntersections, size_t maxLanes) {
+    return Arena::footprint<uint16_t>(maxLanes) * 2
+         + Arena::footprint<uint8_t>(maxLanes) * 2
+         + Arena::footprint<float>(maxLanes)
+         + Arena::footprint<Clock::time_point>(maxLanes)
+         + Arena::footprint<uint32_t>(maxIntersections)
+         + Arena::footprint<uint16_t>(maxIntersections) * 2
+         + Arena::footprint<uint8_t>(maxIntersections);
+}
+
+ArenaNetwork::ArenaNetwork(size_t maxIntersections, size_t maxLanes, const ControllerParams& params)
+    : params(params)
+    , maxIntersections(maxIntersections)
+    , maxLanes(maxLanes)
+    , arena(arenaSize(maxIntersections, maxLanes))
+{
+    if (maxIntersections == 0 || maxLanes == 0 || maxLanes > std::numeric_limits<uint32_t>::max() ||
+        maxIntersections > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("ArenaNetwork: capacities must be between 1 and 2^32 - 1");
+    }
+    if (params.policy != ControlPolicy::GREEDY || params.demandHorizon.count() > 0) {
+        throw std::invalid_argument("ArenaNetwork: only the greedy policy without a demand horizon is supported");
+    }
+    vehicles = arena.allocate<uint16_t>(maxLanes);
+    capacities = arena.allocate<uint16_t>(maxLanes);
+    lights = arena.allocate<uint8_t>(maxLanes);
+    emergencies = arena.allocate<uint8_t>(maxLanes);
+    smoothedOccupancy = arena.allocate<float>(maxLanes);
+    lastGreen = arena.allocate<Clock::time_point>(maxLanes);
+    firstLane = arena.allocate<uint32_t>(maxIntersections);
+    laneCounts = arena.allocate<uint16_t>(maxIntersections);
+    greenSeconds = arena.allocate<uint16_t>(maxIntersections);
+    pedestrians = arena.allocate<uint8_t>(maxIntersections);
+}
+
+ArenaIntersection ArenaNetwork::addIntersection() {
+    if (intersectionCount == maxIntersections) {
+        throw std::runtime_error("ArenaNetwork: intersection capacity exhausted");
+    }
+    auto handle = static_cast<ArenaIntersection>(intersectionCount++);
+    firstLane[handle] = static_cast<uint32_t>(laneCount);
+    return handle;
+}
+
+ArenaLane ArenaNetwork::addLane(ArenaIntersection intersection, int capacity) {
+    if (intersectionCount == 0 || intersection != intersectionCount - 1) {
+        throw std::invalid_argument("ArenaNetwork: lanes are added to the most recently added intersection");
+    }
+    if (capacity <= 0 || capacity > std::numeric_limits<uint16_t>::max()) {
+        throw std::invalid_argument("ArenaNetwork: lane capacity must be between 1 and 65535");
+    }
+    if (laneCounts[intersection] == kMaxLanesPerIntersection) {
+        throw std::invalid_argument("ArenaNetwork: too many lanes on one intersection");
+    }
+    if (laneCount == maxLanes) {
+        throw std::runtime_error("ArenaNetwork: lane capacity exhausted");
+    }
+    auto handle = static_cast<ArenaLane>(laneCount++);
+    capacities[handle] = static_cast<uint16_t>(capacity);
+    lights[handle] = static_cast<uint8_t>(LightState::RED);
+    emergencies[handle] = static_cast<uint8_t>(EmergencyVehicleType::NONE);
+    smoothedOccupancy[handle] = -1.0f;   // not sampled yet
+    lastGreen[handle] = Clock::time_point::min();
+    laneCounts[intersection]++;
+    return handle;
+}
+
+size_t ArenaNetwork::getIntersectionCount() const {
+    return intersectionCount;
+}
+
+size_t ArenaNetwork::getLaneCount() const {
+    return laneCount;
+}
+
+void ArenaNetwork::checkLane(ArenaLane lane) const {
+    if (lane >= laneCount) {
+        throw std::out_of_range("ArenaNetwork: unknown lane handle");
+    }
+}
+
+void ArenaNetwork::checkIntersection(ArenaIntersection intersection) const {
+    if (intersection >= intersectionCount) {
+        throw std::out_of_range("ArenaNetwork: unknown intersection handle");
+    }
+}
+
+int ArenaNetwork::addVehicles(ArenaLane lane, int count) {
+    checkLane(lane);
+    int added = std::max(0, std::min(count, capacities[lane] - vehicles[lane]));
+    vehicles[lane] = static_cast<uint16_t>(vehicles[lane] + added);
+    return added;
+}
+
+int ArenaNetwork::removeVehicles(ArenaLane lane, int count) {
+    checkLane(lane);
+    int removed = std::max(0, std::min<int>(count, vehicles[lane]));
+    vehicles[lane] = static_cast<uint16_t>(vehicles[lane] - removed);
+    return removed;
+}
+
+void ArenaNetwork::reportEmergencyVehicle(ArenaLane lane, EmergencyVehicleType type) {
+    checkLane(lane);
+    emergencies[lane] = static_cast<uint8_t>(type);
+}
+
+void ArenaNetwork::clearEmergencyVehicle(ArenaLane lane) {
+    checkLane(lane);
+    emergencies[lane] = static_cast<uint8_t>(EmergencyVehicleType::NONE);
+}
+
+void ArenaNetwork::requestPedestrianCrossing(ArenaIntersection intersection) {
+    checkIntersection(intersection);
+    pedestrians[intersection] = 1;
+}
+
+void ArenaNetwork::clearPedestrianCrossing(ArenaIntersection intersection) {
+    checkIntersection(intersection);
+    pedestrians[intersection] = 0;
+}
+
+void ArenaNetwork::step(Clock::time_point now) {
+    // One smoothing factor for the whole network, since every lane is sampled together
+    float alpha = 1.0f;
+    if (sampled) {
+        double dt = std::chrono::duration<double>(now - lastStep).count();
+        alpha = dt > 0.0 ? static_cast<float>(1.0 - std::exp(-dt / LaneStatistics::kOccupancyTimeConstant)) : 0.0f;
+    }
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+        float occupancy = static_cast<float>(vehicles[lane]) / capacities[lane];
+        float& smoothed = smoothedOccupancy[lane];
+        smoothed = smoothed < 0.0f ? occupancy : smoothed + alpha * (occupancy - smoothed);
+    }
+    lastStep = now;
+    sampled = true;
+
+    for (size_t intersection = 0; intersection < intersectionCount; ++intersection) {
+        stepIntersection(static_cast<ArenaIntersection>(intersection), now);
+    }
+}
+
+void ArenaNetwork::stepIntersection(ArenaIntersection intersection, Clock::time_point now) {
+    const size_t first = firstLane[intersection];
+    const size_t count = laneCounts[intersection];
+    if (count == 0) {
+        return;
+    }
+    uint8_t* light = lights + first;
+    const uint8_t* emergency = emergencies + first;
+    constexpr auto red = static_cast<uint8_t>(LightState::RED);
+    constexpr auto green = static_cast<uint8_t>(LightState::GREEN);
+    constexpr auto none = static_cast<uint8_t>(EmergencyVehicleType::NONE);
+
+    // Emergency vehicles first: the highest priority lane gets green, the
+    // first among equals
+    size_t priorityLane = count;
+    int bestPriority = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int priority = emergencyPriority(static_cast<EmergencyVehicleType>(emergency[i]));
+        if (priority > bestPriority) {
+            bestPriority = priority;
+            priorityLane = i;
+        }
+    }
+    if (priorityLane < count) {
+        for (size_t i = 0; i < count; ++i) {
+            light[i] = i == priorityLane ? green : red;
+        }
+        greenSeconds[intersection] = static_cast<uint16_t>(
+            std::max<int64_t>(4, std::chrono::duration_cast<std::chrono::seconds>(params.emergencyGreen).count()));
+        return;
+    }
+    if (pedestrians[intersection]) {
+        std::fill(light, light + count, red);
+        return;
+    }
+
+    Clock::time_point* served = lastGreen + first;
+    for (size_t i = 0; i < count; ++i) {
+        if (served[i] == Clock::time_point::min()) {
+            served[i] = now;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (light[i] == green && now - served[i] < params.minGreen) {
+            return;
+        }
+    }
+
+    double occupancy[kMaxLanesPerIntersection];
+    for (size_t i = 0; i < count; ++i) {
+        occupancy[i] = params.smoothOccupancy ? smoothedOccupancy[first + i]
+                                              : static_cast<double>(vehicles[first + i]) / capacities[first + i];
+    }
+    GreedyChoice choice = chooseGreedyLane(occupancy, served, count, params.saturationThreshold);
+    auto chosen = static_cast<size_t>(choice.lane);
+    if (!choice.rotation && light[chosen] == green) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (i != chosen && emergency[i] == none) {
+            light[i] = red;
+        }
+    }
+    if (emergency[chosen] == none) {
+        light[chosen] = green;
+        served[chosen] = now;
+        double ratio = static_cast<double>(vehicles[first + chosen]) / capacities[first + chosen];
+        greenSeconds[intersection] = static_cast<uint16_t>(std::min<int64_t>(
+            std::numeric_limits<uint16_t>::max(), greedyGreenDuration(params, ratio).count()));
+    }
+}
+
+int ArenaNetwork::getVehicleCount(ArenaLane lane) const {
+    checkLane(lane);
+    return vehicles[lane];
+}
+
+int ArenaNetwork::getCapacity(ArenaLane lane) const {
+    checkLane(lane);
+    return capacities[lane];
+}
+
+LightState ArenaNetwork::getLightState(ArenaLane lane) const {
+    checkLane(lane);
+    return static_cast<LightState>(lights[lane]);
+}
+
+double ArenaNetwork::getSmoothedOccupancy(ArenaLane lane) const {
+    checkLane(lane);
+    return std::max(0.0f, smoothedOccupancy[lane]);
+}
+
+ArenaIntersection ArenaNetwork::getIntersection(ArenaLane lane) const {
+    checkLane(lane);
+    const uint32_t* begin = firstLane;
+    const uint32_t* end = firstLane + intersectionCount;
+    return static_cast<ArenaIntersection>(std::upper_bound(begin, end, lane) - begin - 1);
+}
+
+std::chrono::seconds ArenaNetwork::getGreenDuration(ArenaIntersection intersection) const {
+    checkIntersection(intersection);
+    return std::chrono::seconds(greenSeconds[intersection]);
+}
+
+size_t ArenaNetwork::getArenaBytes() const {
+    return arena.capacity();
+}
+
+double ArenaNetwork::getBytesPerLane() const {
+    return static_cast<double>(arena.capacity()) / maxLanes;
+}
@@ -0,0 +1,248 @@
+#include "smart_traffic_c.h"
+#include "Intersection.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct stl_network {
+    struct Node {
+        std::shared_ptr<Intersection> intersection;
+        std::shared_ptr<ManualClock> clock;
+        std::vector<stl_lane> lanes;   // handles, in the intersection's lane order
+    };
+    struct LaneRef {
+        stl_intersection intersection;
+        size_t index;
+        std::shared_ptr<Lane> lane;
+        std::shared_ptr<TrafficLight> light;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<LaneRef> lanes;
+    // The state arrays handed out by stl_network_state
+    std::vector<int32_t> vehicleCounts;
+    std::vector<uint8_t> lightStates;
+    Clock::time_point now{};
+    uint64_t steps = 0;
+
+    void refreshLane(stl_lane handle) {
+        const LaneRef& ref = lanes[handle];
+        vehicleCounts[handle] = ref.lane->getVehicleCount();
+        lightStates[handle] = static_cast<uint8_t>(ref.light->getState());
+    }
+
+    void refreshIntersection(stl_intersection index) {
+        for (stl_lane handle : nodes[index].lanes) {
+            refreshLane(handle);
+        }
+    }
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+int fail(int status, const std::string& message) {
+    lastError = message;
+    return status;
+}
+
+// Runs `body`, turning exceptions into a status for the caller
+template <typename Body>
+int guarded(Body&& body) {
+    try {
+        return body();
+    } catch (const std::invalid_argument& error) {
+        return fail(STL_INVALID_ARGUMENT, error.what());
+    } catch (const std::exception& error) {
+        return fail(STL_ERROR, error.what());
+    } catch (...) {
+        return fail(STL_ERROR, "unknown error");
+    }
+}
+
+bool validLane(const stl_network* network, stl_lane lane) {
+    return network && lane < network->lanes.size();
+}
+
+bool validIntersection(const stl_network* network, stl_intersection intersection) {
+    return network && intersection < network->nodes.size();
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t stl_abi_version(void) {
+    return STL_ABI_VERSION;
+}
+
+const char* stl_last_error(void) {
+    return lastError.c_str();
+}
+
+stl_network* stl_network_create(void) {
+    try {
+        return new stl_network();
+    } catch (const std::exception& error) {
+        lastError = error.what();
+        return nullptr;
+    }
+}
+
+void stl_network_destroy(stl_network* network) {
+    delete network;
+}
+
+int stl_network_add_intersection(stl_network* network, const char* id, stl_intersection* out) {
+    if (!network || !id || !out) {
+        return fail(STL_INVALID_ARGUMENT, "stl_network_add_intersection: null argument");
+    }
+    return guarded([&]() {
+        stl_network::Node node;
+        node.intersection = std::make_shared<Intersection>(id);
+        node.clock = std::make_shared<ManualClock>(network->now);
+        node.intersection->setClock(node.clock);
+        network->nodes.push_back(std::move(node));
+        *out = static_cast<stl_intersection>(network->nodes.size() - 1);
+        return STL_OK;
+    });
+}
+
+int stl_network_add_lane(stl_network* network, stl_intersection intersection, const char* id, int32_t capacity,
+                         stl_lane* out) {
+    if (!validIntersection(network, intersection) || !id || !out) {
+        return fail(STL_INVALID_ARGUMENT, "stl_network_add_lane: null argument or unknown intersection");
+    }
+    if (capacity <= 0) {
+        return fail(STL_INVALID_ARGUMENT, "stl_network_add_lane: capacity must be positive");
+    }
+    return guarded([&]() {
+        auto& node = network->nodes[intersection];
+        auto lane = std::make_shared<Lane>(id, capacity);
+        auto light = std::make_shared<TrafficLight>(std::string(id) + " Light");
+        size_t index = node.intersection->getLaneCount();
+        node.intersection->addLane(lane, light);
+        auto handle = static_cast<stl_lane>(network->lanes.size());
+        network->lanes.push_back({intersection, index, lane, light});
+        network->vehicleCounts.push_back(0);
+        network->lightStates.push_back(0);
+        node.lanes.push_back(handle);
+        network->refreshLane(handle);
+        *out = handle;
+        return STL_OK;
+    });
+}
+
+int stl_lane_arrive(stl_network* network, stl_lane lane, int32_t vehicles, int32_t* applied) {
+    if (!validLane(network, lane) || vehicles < 0) {
+        return fail(STL_INVALID_ARGUMENT, "stl_lane_arrive: unknown lane or negative count");
+    }
+    int32_t added = network->lanes[lane].lane->addVehicles(vehicles);
+    network->vehicleCounts[lane] = network->lanes[lane].lane->getVehicleCount();
+    if (applied) {
+        *applied = added;
+    }
+    return STL_OK;
+}
+
+int stl_lane_depart(stl_network* network, stl_lane lane, int32_t vehicles, int32_t* applied) {
+    if (!validLane(network, lane) || vehicles < 0) {
+        return fail(STL_INVALID_ARGUMENT, "stl_lane_depart: unknown lane or negative count");
+    }
+    int32_t removed = network->lanes[lane].lane->removeVehicles(vehicles);
+    network->vehicleCounts[lane] = network->lanes[lane].lane->getVehicleCount();
+    if (applied) {
+        *applied = removed;
+    }
+    return STL_OK;
+}
+
+int stl_lane_report_emergency(stl_network* network, stl_lane lane, int type) {
+    if (!validLane(network, lane) || type <= STL_EMERGENCY_NONE || type > STL_EMERGENCY_FIRE_TRUCK) {
+        return fail(STL_INVALID_ARGUMENT, "stl_lane_report_emergency: unknown lane or vehicle type");
+    }
+    return guarded([&]() {
+        const auto& ref = network->lanes[lane];
+        network->nodes[ref.intersection].intersection->reportEmergencyVehicle(
+            ref.index, static_cast<EmergencyVehicleType>(type));
+        network->refreshIntersection(ref.intersection);
+        return STL_OK;
+    });
+}
+
+int stl_lane_clear_emergency(stl_network* network, stl_lane lane) {
+    if (!validLane(network, lane)) {
+        return fail(STL_INVALID_ARGUMENT, "stl_lane_clear_emergency: unknown lane");
+    }
+    return guarded([&]() {
+        const auto& ref = network->lanes[lane];
+        network->nodes[ref.intersection].intersection->clearEmergencyVehicle(ref.index);
+        network->refreshIntersection(ref.intersection);
+        return STL_OK;
+    });
+}
+
+int stl_intersection_request_crossing(stl_network* network, stl_intersection intersection) {
+    if (!validIntersection(network, intersection)) {
+        return fail(STL_INVALID_ARGUMENT, "stl_intersection_request_crossing: unknown intersection");
+    }
+    return guarded([&]() {
+        network->nodes[intersection].intersection->requestPedestrianCrossing();
+        network->refreshIntersection(intersection);
+        return STL_OK;
+    });
+}
+
+int stl_intersection_clear_crossing(stl_network* network, stl_intersection intersection) {
+    if (!validIntersection(network, intersection)) {
+        return fail(STL_INVALID_ARGUMENT, "stl_intersection_clear_crossing: unknown intersection");
+    }
+    return guarded([&]() {
+        network->nodes[intersection].intersection->clearPedestrianCrossing();
+        network->refreshIntersection(intersection);
+        return STL_OK;
+    });
+}
+
+int stl_network_step(stl_network* network, uint32_t milliseconds) {
+    if (!network) {
+        return fail(STL_INVALID_ARGUMENT, "stl_network_step: null network");
+    }
+    return guarded([&]() {
+        network->now += std::chrono::milliseconds(milliseconds);
+        // A yellow sleeps on the intersection's own clock, so one may run
+        // ahead of the network; advanceTo never moves it back
+        for (auto& node : network->nodes) {
+            node.clock->advanceTo(network->now);
+            node.intersection->step();
+        }
+        for (size_t handle = 0; handle < network->lanes.size(); ++handle) {
+            network->refreshLane(static_cast<stl_lane>(handle));
+        }
+        network->steps++;
+        return STL_OK;
+    });
+}
+
+int stl_network_state(const stl_network* network, stl_state_view* out) {
+    if (!network || !out) {
+        return fail(STL_INVALID_ARGUMENT, "stl_network_state: null argument");
+    }
+    if (out->struct_size < sizeof(out->struct_size)) {
+        return fail(STL_INVALID_ARGUMENT, "stl_network_state: struct_size not set");
+    }
+    stl_state_view view{};
+    view.struct_size = out->struct_size;
+    view.lane_count = network->lanes.size();
+    view.vehicle_counts = network->vehicleCounts.data();
+    view.light_states = network->lightStates.data();
+    view.step_count = network->steps;
+    // A caller built against an older header has a shorter struct
+    std::memcpy(out, &view, std::min(out->struct_size, sizeof(view)));
+    return STL_OK;
+}
+
+} // extern "C"
@@ -0,0 +1,42 @@
+#include "Clock.hpp"
+#include <thread>
+
+std::shared_ptr<Clock> Clock::steady() {
+    static std::shared_ptr<Clock> instance = std::make_shared<SteadyClock>();
+    return instance;
+}
+
+Clock::time_point SteadyClock::now() const {
+    return std::chrono::steady_clock::now();
+}
+
+void SteadyClock::sleepFor(duration d) {
+    std::this_thread::sleep_for(d);
+}
+
+ManualClock::ManualClock()
+    : ticks(0)
+{}
+
+ManualClock::ManualClock(time_point start)
+    : ticks(start.time_since_epoch().count())
+{}
+
+Clock::time_point ManualClock::now() const {
+    return time_point(duration(ticks.load()));
+}
+
+void ManualClock::sleepFor(duration d) {
+    advance(d);
+}
+
+void ManualClock::advance(duration d) {
+    ticks.fetch_add(d.count());
+}
+
+void ManualClock::advanceTo(time_point t) {
+    auto target = t.time_since_epoch().count();
+    auto current = ticks.load();
+    while (current < target && !ticks.compare_exchange_weak(current, target)) {
+    }
+}
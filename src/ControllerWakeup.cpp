@@ -0,0 +1,42 @@
+#include "ControllerWakeup.hpp"
+
+ControllerWakeup::ControllerWakeup()
+    : urgent(false)
+    , activity(false)
+    , activityWakes(false)
+{}
+
+void ControllerWakeup::notifyUrgent() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        urgent = true;
+    }
+    condition.notify_one();
+}
+
+void ControllerWakeup::markActivity() {
+    activity.store(true);
+    if (activityWakes.load() && activityWakes.exchange(false)) {
+        notifyUrgent();
+    }
+}
+
+bool ControllerWakeup::waitFor(std::chrono::steady_clock::duration timeout, bool wakeOnActivity) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (wakeOnActivity) {
+        activityWakes.store(true);
+        // Activity that arrived after the controller last looked counts too
+        if (activity.load()) {
+            activityWakes.store(false);
+            return true;
+        }
+    }
+    bool woken = condition.wait_for(lock, timeout, [this]() { return urgent; });
+    urgent = false;
+    activityWakes.store(false);
+    return woken;
+}
+
+bool ControllerWakeup::consumeActivity() {
+    return activity.exchange(false, std::memory_order_relaxed);
+}
@@ -0,0 +1,226 @@
+#include "CorridorPreemption.hpp"
+#include "GreedyPolicy.hpp"
+#include <algorithm>
+
+namespace {
+
+Clock::duration toClock(std::chrono::duration<double> d) {
+    return std::chrono::duration_cast<Clock::duration>(d);
+}
+
+std::shared_ptr<Lane> findLane(const Intersection& intersection, const std::string& laneId) {
+    for (size_t i = 0; i < intersection.getLaneCount(); ++i) {
+        auto lane = intersection.getLane(i);
+        if (lane && lane->getId() == laneId) {
+            return lane;
+        }
+    }
+    return nullptr;
+}
+
+EmergencyVehicleType emergencyOn(const Intersection& intersection, const std::string& laneId) {
+    auto lane = findLane(intersection, laneId);
+    return lane ? lane->getEmergencyVehicleType() : EmergencyVehicleType::NONE;
+}
+
+} // namespace
+
+CorridorPreemption::CorridorPreemption(std::shared_ptr<Clock> clock, const CorridorParams& params)
+    : clock(std::move(clock))
+    , params(params)
+    , nextRunId(1)
+    , running(false)
+{}
+
+CorridorPreemption::~CorridorPreemption() {
+    stop();
+}
+
+CorridorPreemption::RunId CorridorPreemption::dispatch(EmergencyVehicleType type,
+                                                       const std::vector<RouteLeg>& route) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Run run;
+    run.id = nextRunId++;
+    run.type = type;
+    Clock::time_point eta = clock->now();
+    for (const auto& routeLeg : route) {
+        Leg leg;
+        leg.route = routeLeg;
+        eta += toClock(routeLeg.travelTime);
+        leg.eta = eta;
+        run.legs.push_back(leg);
+    }
+    runs.push_back(std::move(run));
+    stats.runsDispatched++;
+
+    // Legs that are already due are cleared immediately
+    RunId id = runs.back().id;
+    updateLocked(clock->now());
+    return id;
+}
+
+void CorridorPreemption::reportPassed(RunId id, size_t legIndex) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = clock->now();
+    for (auto& run : runs) {
+        if (run.id != id || legIndex >= run.legs.size()) {
+            continue;
+        }
+        for (size_t i = 0; i <= legIndex; ++i) {
+            release(run.legs[i], now, true);
+        }
+        // Downstream ETAs follow the observed progress
+        Clock::time_point eta = now;
+        for (size_t i = legIndex + 1; i < run.legs.size(); ++i) {
+            eta += toClock(run.legs[i].route.travelTime);
+            run.legs[i].eta = eta;
+        }
+    }
+    removeFinishedRuns();
+}
+
+void CorridorPreemption::cancel(RunId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = clock->now();
+    for (auto& run : runs) {
+        if (run.id == id) {
+            for (auto& leg : run.legs) {
+                release(leg, now, false);
+            }
+        }
+    }
+    removeFinishedRuns();
+}
+
+void CorridorPreemption::update() {
+    std::lock_guard<std::mutex> lock(mutex);
+    updateLocked(clock->now());
+}
+
+void CorridorPreemption::updateLocked(Clock::time_point now) {
+    for (auto& run : runs) {
+        for (auto& leg : run.legs) {
+            if (leg.phase == LegPhase::PENDING && now >= leg.eta - clearanceLead(leg)) {
+                preempt(leg, run.type, now);
+            } else if (leg.phase == LegPhase::PREEMPTED && now >= leg.eta + toClock(params.releaseTimeout)) {
+                leg.timedOut = true;
+                stats.legsTimedOut++;
+                release(leg, now, false);
+            }
+        }
+    }
+    removeFinishedRuns();
+}
+
+void CorridorPreemption::start() {
+    if (!running.exchange(true)) {
+        updateThread = std::make_unique<std::thread>(&CorridorPreemption::updateLoop, this);
+    }
+}
+
+void CorridorPreemption::stop() {
+    if (running.exchange(false)) {
+        if (updateThread && updateThread->joinable()) {
+            updateThread->join();
+        }
+    }
+}
+
+void CorridorPreemption::updateLoop() {
+    using namespace std::chrono_literals;
+
+    while (running) {
+        update();
+        std::this_thread::sleep_for(200ms);
+    }
+}
+
+std::vector<CorridorLegStatus> CorridorPreemption::status(RunId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<CorridorLegStatus> result;
+    for (const auto& run : runs) {
+        if (run.id != id) {
+            continue;
+        }
+        for (const auto& leg : run.legs) {
+            result.push_back({leg.route.intersection->getId(), leg.route.laneId, leg.phase,
+                              leg.eta, leg.eta - clearanceLead(leg), leg.timedOut});
+        }
+    }
+    return result;
+}
+
+size_t CorridorPreemption::activeRuns() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return runs.size();
+}
+
+CorridorStats CorridorPreemption::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+Clock::duration CorridorPreemption::clearanceLead(const Leg& leg) const {
+    const Intersection& intersection = *leg.route.intersection;
+    double queue = 0.0;
+    double dischargeRate = params.fallbackDischargeRate;
+    if (auto lane = findLane(intersection, leg.route.laneId)) {
+        queue = lane->getVehicleCount();
+        // A lane that has barely been green measures a near-zero rate,
+        // which would start preemption minutes early
+        dischargeRate = std::max(lane->getStatistics().snapshot().dischargeRate, params.fallbackDischargeRate);
+    }
+    auto clearance = params.startupLostTime
+                   + std::chrono::duration<double>(queue / dischargeRate)
+                   + std::chrono::duration<double>(intersection.getParams().yellow);
+    return toClock(std::max(clearance, params.minimumLead));
+}
+
+void CorridorPreemption::preempt(Leg& leg, EmergencyVehicleType type, Clock::time_point now) {
+    Intersection& intersection = *leg.route.intersection;
+    Hold& hold = holds[{&intersection, leg.route.laneId}];
+    EmergencyVehicleType current = emergencyOn(intersection, leg.route.laneId);
+    if (hold.holders == 0) {
+        // Someone else's emergency already holds the approach
+        hold.ours = current == EmergencyVehicleType::NONE;
+        if (hold.ours) {
+            intersection.reportEmergencyVehicle(leg.route.laneId, type);
+            hold.type = type;
+        }
+    } else if (hold.ours && current == hold.type && emergencyPriority(type) > emergencyPriority(hold.type)) {
+        intersection.reportEmergencyVehicle(leg.route.laneId, type);
+        hold.type = type;
+    }
+    hold.holders++;
+    leg.phase = LegPhase::PREEMPTED;
+    leg.preemptedAt = now;
+    stats.legsPreempted++;
+}
+
+void CorridorPreemption::release(Leg& leg, Clock::time_point now, bool passed) {
+    if (leg.phase == LegPhase::PREEMPTED) {
+        Intersection& intersection = *leg.route.intersection;
+        auto hold = holds.find({&intersection, leg.route.laneId});
+        if (hold != holds.end() && --hold->second.holders == 0) {
+            // Unless a detector or feed has since replaced our report
+            if (hold->second.ours && emergencyOn(intersection, leg.route.laneId) == hold->second.type) {
+                intersection.clearEmergencyVehicle(leg.route.laneId);
+            }
+            holds.erase(hold);
+        }
+        double held = std::chrono::duration<double>(now - leg.preemptedAt).count();
+        stats.totalHoldSeconds += held;
+        stats.maxHoldSeconds = std::max(stats.maxHoldSeconds, held);
+        if (passed) {
+            stats.legsReleasedOnPass++;
+        }
+    }
+    leg.phase = LegPhase::RELEASED;
+}
+
+void CorridorPreemption::removeFinishedRuns() {
+    runs.erase(std::remove_if(runs.begin(), runs.end(), [](const Run& run) {
+        return std::all_of(run.legs.begin(), run.legs.end(),
+                           [](const Leg& leg) { return leg.phase == LegPhase::RELEASED; });
+    }), runs.end());
+}
@@ -0,0 +1,33 @@
+#include "Geo.hpp"
+
+namespace {
+
+constexpr double kEarthRadius = 6371008.8;
+constexpr double kPi = 3.14159265358979323846;
+
+double toRadians(double degrees) {
+    return degrees * kPi / 180.0;
+}
+
+} // namespace
+
+Position Position::fromLatLon(double latitude, double longitude, double originLatitude, double originLongitude) {
+    Position position;
+    position.x = toRadians(longitude - originLongitude) * std::cos(toRadians(originLatitude)) * kEarthRadius;
+    position.y = toRadians(latitude - originLatitude) * kEarthRadius;
+    return position;
+}
+
+double distanceBetween(const Position& a, const Position& b) {
+    return std::hypot(b.x - a.x, b.y - a.y);
+}
+
+double bearingBetween(const Position& from, const Position& to) {
+    double bearing = std::atan2(to.x - from.x, to.y - from.y) * 180.0 / kPi;
+    return bearing < 0.0 ? bearing + 360.0 : bearing;
+}
+
+double headingDifference(double a, double b) {
+    double difference = std::fmod(std::fabs(a - b), 360.0);
+    return difference > 180.0 ? 360.0 - difference : difference;
+}
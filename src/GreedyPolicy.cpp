@@ -0,0 +1,41 @@
+#include "GreedyPolicy.hpp"
+#include <algorithm>
+
+GreedyChoice chooseGreedyLane(const double* occupancy, const Clock::time_point* lastGreen, size_t count,
+                              double saturationThreshold) {
+    GreedyChoice choice;
+    if (count == 0) {
+        return choice;
+    }
+    choice.rotation = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (occupancy[i] < saturationThreshold) {
+            choice.rotation = false;
+            break;
+        }
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i < count; ++i) {
+        if (choice.rotation ? lastGreen[i] < lastGreen[best] : occupancy[i] > occupancy[best]) {
+            best = i;
+        }
+    }
+    choice.lane = static_cast<int>(best);
+    return choice;
+}
+
+std::chrono::seconds greedyGreenDuration(const ControllerParams& params, double occupancy) {
+    auto duration = params.baseGreen + std::chrono::seconds(
+        static_cast<int>(occupancy * params.greenRange.count())); // 30-60 seconds by default
+    return std::max(duration, std::chrono::seconds(4));
+}
+
+int emergencyPriority(EmergencyVehicleType type) {
+    switch (type) {
+        case EmergencyVehicleType::FIRE_TRUCK: return 3;
+        case EmergencyVehicleType::AMBULANCE: return 2;
+        case EmergencyVehicleType::POLICE: return 1;
+        default: return 0;
+    }
+}
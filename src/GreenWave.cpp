@@ -0,0 +1,368 @@
+#include "GreenWave.hpp"
+#include "CoordinationPlan.hpp"
+#include "Intersection.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr int kWords = GreenWaveOptimizer::kMaxCycle / 64;
+// Bit t: a vehicle leaving the first signal of its direction at second t of
+// the cycle gets through
+using Mask = std::array<uint64_t, kWords>;
+
+int wrap(int value, int cycle) {
+    int r = value % cycle;
+    return r < 0 ? r + cycle : r;
+}
+
+bool test(const Mask& mask, int t) {
+    return (mask[t >> 6] >> (t & 63)) & 1u;
+}
+
+Mask fullMask(int cycle) {
+    Mask mask{};
+    for (int t = 0; t < cycle; ++t) {
+        mask[t >> 6] |= uint64_t(1) << (t & 63);
+    }
+    return mask;
+}
+
+// Departures that meet green at a signal reached `arrival` seconds after leaving
+Mask passMask(int cycle, int arrival, int offset, int green) {
+    Mask mask{};
+    int start = wrap(offset - arrival, cycle);
+    for (int k = 0; k < green; ++k) {
+        int t = (start + k) % cycle;
+        mask[t >> 6] |= uint64_t(1) << (t & 63);
+    }
+    return mask;
+}
+
+int countOpen(const Mask& mask) {
+    int count = 0;
+    for (uint64_t word : mask) {
+        count += static_cast<int>(std::bitset<64>(word).count());
+    }
+    return count;
+}
+
+// sums[s] += open departures among the `green` seconds starting at s
+void addWindowSums(const Mask& open, int cycle, int green, int* sums) {
+    int sum = 0;
+    for (int k = 0; k < green; ++k) {
+        sum += test(open, k % cycle);
+    }
+    for (int s = 0; s < cycle; ++s) {
+        sums[s] += sum;
+        sum += test(open, (s + green) % cycle) - test(open, s);
+    }
+}
+
+// First signal of each run of `span` signals; one run when the chain is shorter
+int runCount(size_t signals, int span) {
+    return signals <= static_cast<size_t>(span) ? 1 : static_cast<int>(signals) - span + 1;
+}
+
+// How far the bands fall short of the balance constraint; 0 when they meet it
+double shortfall(double forward, double reverse, double balance) {
+    return std::max(0.0, balance * forward - reverse) + std::max(0.0, balance * reverse - forward);
+}
+
+// Open departures of a run, once its last signal's mask is applied
+int countWith(const Mask& open, const Mask& last) {
+    Mask both;
+    for (int w = 0; w < kWords; ++w) {
+        both[w] = open[w] & last[w];
+    }
+    return countOpen(both);
+}
+
+} // namespace
+
+GreenWaveOptimizer::GreenWaveOptimizer(std::vector<double> fractions, std::vector<double> forwardTravel,
+                                       std::vector<double> reverseTravel)
+    : greenFractions(std::move(fractions))
+{
+    size_t count = greenFractions.size();
+    if (count == 0 || forwardTravel.size() + 1 != count || reverseTravel.size() + 1 != count) {
+        throw std::invalid_argument("GreenWaveOptimizer: need one green fraction per signal and one travel time per link");
+    }
+    for (double fraction : greenFractions) {
+        if (!(fraction > 0.0 && fraction < 1.0)) {
+            throw std::invalid_argument("GreenWaveOptimizer: green fractions must be between 0 and 1");
+        }
+    }
+    for (const auto* travel : {&forwardTravel, &reverseTravel}) {
+        for (double seconds : *travel) {
+            if (!(seconds >= 0.0 && std::isfinite(seconds))) {
+                throw std::invalid_argument("GreenWaveOptimizer: travel times must be finite and not negative");
+            }
+        }
+    }
+    forwardArrival.assign(count, 0);
+    reverseArrival.assign(count, 0);
+    double forward = 0.0;
+    for (size_t i = 1; i < count; ++i) {
+        forward += forwardTravel[i - 1];
+        forwardArrival[i] = static_cast<int>(std::lround(forward));
+    }
+    double reverse = 0.0;
+    for (size_t i = count - 1; i-- > 0;) {
+        reverse += reverseTravel[i];
+        reverseArrival[i] = static_cast<int>(std::lround(reverse));
+    }
+}
+
+std::vector<int> GreenWaveOptimizer::greensFor(int cycle) const {
+    std::vector<int> greens(greenFractions.size());
+    for (size_t i = 0; i < greens.size(); ++i) {
+        greens[i] = std::max(1, std::min(cycle - 1, static_cast<int>(std::lround(greenFractions[i] * cycle))));
+    }
+    return greens;
+}
+
+std::pair<double, double> GreenWaveOptimizer::bandwidth(int cycle, const std::vector<int>& offsets, int span) const {
+    if (cycle < 2 || cycle > kMaxCycle || span < 1 || offsets.size() != greenFractions.size()) {
+        throw std::invalid_argument("GreenWaveOptimizer: need a cycle of 2-256 s, a positive span and one offset per signal");
+    }
+    const size_t count = greenFractions.size();
+    const size_t width = std::min(count, static_cast<size_t>(span));
+    auto greens = greensFor(cycle);
+    std::vector<Mask> forward(count), reverse(count);
+    for (size_t i = 0; i < count; ++i) {
+        forward[i] = passMask(cycle, forwardArrival[i], offsets[i], greens[i]);
+        reverse[i] = passMask(cycle, reverseArrival[i], offsets[i], greens[i]);
+    }
+    int runs = runCount(count, span);
+    double forwardTotal = 0.0;
+    double reverseTotal = 0.0;
+    for (int first = 0; first < runs; ++first) {
+        Mask openForward = fullMask(cycle);
+        Mask openReverse = openForward;
+        for (size_t j = first; j < first + width; ++j) {
+            for (int w = 0; w < kWords; ++w) {
+                openForward[w] &= forward[j][w];
+                openReverse[w] &= reverse[j][w];
+            }
+        }
+        forwardTotal += countOpen(openForward);
+        reverseTotal += countOpen(openReverse);
+    }
+    return {forwardTotal / runs, reverseTotal / runs};
+}
+
+GreenWavePlan GreenWaveOptimizer::search(int cycle, int restart, const GreenWaveSettings& settings) const {
+    const size_t count = greenFractions.size();
+    const size_t width = std::min(count, static_cast<size_t>(settings.span));
+    const int runs = runCount(count, settings.span);
+    GreenWavePlan plan;
+    plan.cycle = cycle;
+    plan.greens = greensFor(cycle);
+    plan.offsets.resize(count);
+
+    std::mt19937_64 rng(settings.seed ^ (static_cast<uint64_t>(cycle) * 1000003u + static_cast<uint64_t>(restart)));
+    for (size_t i = 0; i < count; ++i) {
+        if (restart == 0) {
+            plan.offsets[i] = wrap(forwardArrival[i], cycle);
+        } else if (restart == 1) {
+            plan.offsets[i] = wrap(reverseArrival[i], cycle);
+        } else {
+            plan.offsets[i] = static_cast<int>(rng() % static_cast<uint64_t>(cycle));
+        }
+    }
+
+    std::vector<Mask> forward(count), reverse(count);
+    for (size_t i = 0; i < count; ++i) {
+        forward[i] = passMask(cycle, forwardArrival[i], plan.offsets[i], plan.greens[i]);
+        reverse[i] = passMask(cycle, reverseArrival[i], plan.offsets[i], plan.greens[i]);
+    }
+    const Mask full = fullMask(cycle);
+    std::vector<int> sumsForward(cycle), sumsReverse(cycle);
+
+    // Open departures per run, so the bands of a candidate offset are the
+    // other runs' totals plus its window sums
+    std::vector<int> runForward(runs), runReverse(runs);
+    int totalForward = 0;
+    int totalReverse = 0;
+    for (int first = 0; first < runs; ++first) {
+        Mask openForward = full;
+        Mask openReverse = full;
+        for (size_t j = first; j < first + width; ++j) {
+            for (int w = 0; w < kWords; ++w) {
+                openForward[w] &= forward[j][w];
+                openReverse[w] &= reverse[j][w];
+            }
+        }
+        runForward[first] = countOpen(openForward);
+        runReverse[first] = countOpen(openReverse);
+        totalForward += runForward[first];
+        totalReverse += runReverse[first];
+    }
+    std::vector<Mask> othersForward(width), othersReverse(width);
+
+    for (int sweep = 0; sweep < settings.maxSweeps; ++sweep) {
+        bool changed = false;
+        for (size_t i = 0; i < count; ++i) {
+            // Departures each run through signal i lets pass at the other signals
+            std::fill(sumsForward.begin(), sumsForward.end(), 0);
+            std::fill(sumsReverse.begin(), sumsReverse.end(), 0);
+            int firstRun = std::max(0, static_cast<int>(i) - static_cast<int>(width) + 1);
+            int lastRun = std::min(static_cast<int>(i), runs - 1);
+            int restForward = totalForward;
+            int restReverse = totalReverse;
+            for (int first = firstRun; first <= lastRun; ++first) {
+                restForward -= runForward[first];
+                restReverse -= runReverse[first];
+                Mask openForward = full;
+                Mask openReverse = full;
+                for (size_t j = first; j < first + width; ++j) {
+                    if (j == i) {
+                        continue;
+                    }
+                    for (int w = 0; w < kWords; ++w) {
+                        openForward[w] &= forward[j][w];
+                        openReverse[w] &= reverse[j][w];
+                    }
+                }
+                addWindowSums(openForward, cycle, plan.greens[i], sumsForward.data());
+                addWindowSums(openReverse, cycle, plan.greens[i], sumsReverse.data());
+                othersForward[first - firstRun] = openForward;
+                othersReverse[first - firstRun] = openReverse;
+            }
+
+            // Least shortfall first, then the weighted sum of the bands
+            auto evaluate = [&](int offset) {
+                double bandForward = restForward + sumsForward[wrap(offset - forwardArrival[i], cycle)];
+                double bandReverse = restReverse + sumsReverse[wrap(offset - reverseArrival[i], cycle)];
+                return std::make_pair(-shortfall(bandForward, bandReverse, settings.balance),
+                                      bandForward + settings.reverseWeight * bandReverse);
+            };
+            int best = plan.offsets[i];
+            auto bestScore = evaluate(best);
+            for (int offset = 0; offset < cycle; ++offset) {
+                auto candidate = evaluate(offset);
+                if (candidate > bestScore) {
+                    best = offset;
+                    bestScore = candidate;
+                }
+            }
+            if (best != plan.offsets[i]) {
+                plan.offsets[i] = best;
+                forward[i] = passMask(cycle, forwardArrival[i], best, plan.greens[i]);
+                reverse[i] = passMask(cycle, reverseArrival[i], best, plan.greens[i]);
+                totalForward = restForward;
+                totalReverse = restReverse;
+                for (int first = firstRun; first <= lastRun; ++first) {
+                    runForward[first] = countWith(othersForward[first - firstRun], forward[i]);
+                    runReverse[first] = countWith(othersReverse[first - firstRun], reverse[i]);
+                    totalForward += runForward[first];
+                    totalReverse += runReverse[first];
+                }
+                changed = true;
+            }
+        }
+        plan.sweeps++;
+        if (!changed) {
+            break;
+        }
+    }
+
+    auto bands = bandwidth(cycle, plan.offsets, settings.span);
+    plan.forwardBandwidth = bands.first;
+    plan.reverseBandwidth = bands.second;
+    plan.efficiency = (plan.forwardBandwidth + settings.reverseWeight * plan.reverseBandwidth)
+                    / ((1.0 + settings.reverseWeight) * cycle);
+    return plan;
+}
+
+GreenWavePlan GreenWaveOptimizer::optimize(const GreenWaveSettings& settings) const {
+    if (settings.minCycle < 2 || settings.maxCycle < settings.minCycle || settings.maxCycle > kMaxCycle ||
+        settings.cycleStep < 1 || settings.span < 1 || settings.restarts < 1 || settings.maxSweeps < 1 ||
+        settings.reverseWeight < 0.0 || !(settings.balance >= 0.0 && settings.balance <= 1.0)) {
+        throw std::invalid_argument("GreenWaveOptimizer: invalid search settings");
+    }
+    const size_t cycles = static_cast<size_t>((settings.maxCycle - settings.minCycle) / settings.cycleStep + 1);
+    const size_t tasks = cycles * static_cast<size_t>(settings.restarts);
+    std::atomic<size_t> next{0};
+    std::mutex bestMutex;
+    GreenWavePlan best;
+    size_t bestTask = tasks;
+    uint64_t sweeps = 0;
+
+    // Plans short of the balance rank by the shortfall as a fraction of
+    // their cycle. Ties go to the earliest task (shortest cycle, then restart
+    // order), so the result does not depend on scheduling
+    auto unbalanced = [&](const GreenWavePlan& plan) {
+        return shortfall(plan.forwardBandwidth, plan.reverseBandwidth, settings.balance) / plan.cycle;
+    };
+    auto better = [&](const GreenWavePlan& a, size_t aTask, const GreenWavePlan& b, size_t bTask) {
+        double aShort = unbalanced(a);
+        double bShort = unbalanced(b);
+        if (aShort != bShort) {
+            return aShort < bShort;
+        }
+        return a.efficiency > b.efficiency || (a.efficiency == b.efficiency && aTask < bTask);
+    };
+    auto worker = [&]() {
+        GreenWavePlan localBest;
+        size_t localTask = tasks;
+        uint64_t localSweeps = 0;
+        for (size_t task = next++; task < tasks; task = next++) {
+            int cycle = settings.minCycle + static_cast<int>(task / settings.restarts) * settings.cycleStep;
+            GreenWavePlan plan = search(cycle, static_cast<int>(task % settings.restarts), settings);
+            localSweeps += plan.sweeps;
+            if (localTask == tasks || better(plan, task, localBest, localTask)) {
+                localBest = std::move(plan);
+                localTask = task;
+            }
+        }
+        std::lock_guard<std::mutex> lock(bestMutex);
+        sweeps += localSweeps;
+        if (localTask != tasks && (bestTask == tasks || better(localBest, localTask, best, bestTask))) {
+            best = std::move(localBest);
+            bestTask = localTask;
+        }
+    };
+
+    unsigned threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    unsigned count = static_cast<unsigned>(std::min<size_t>(threads, tasks));
+    for (unsigned i = 1; i < count; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    best.sweeps = sweeps;
+    return best;
+}
+
+void applyGreenWave(const std::vector<WaveSignal>& signals, const GreenWavePlan& plan, Clock::time_point epoch,
+                    double overrideOccupancy) {
+    if (signals.size() != plan.offsets.size() || signals.size() != plan.greens.size()) {
+        throw std::invalid_argument("applyGreenWave: plan does not match the signals");
+    }
+    for (size_t i = 0; i < signals.size(); ++i) {
+        CoordinationPlan coordination;
+        coordination.epoch = epoch;
+        coordination.cycle = std::chrono::seconds(plan.cycle);
+        coordination.offset = std::chrono::seconds(plan.offsets[i]);
+        coordination.green = std::chrono::seconds(plan.greens[i]);
+        for (const auto* lane : {&signals[i].forwardLane, &signals[i].reverseLane}) {
+            if (!lane->empty()) {
+                coordination.arterialLanes.push_back(*lane);
+            }
+        }
+        coordination.overrideOccupancy = overrideOccupancy;
+        signals[i].intersection->setCoordinationPlan(coordination);
+    }
+}
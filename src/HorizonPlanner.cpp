@@ -0,0 +1,213 @@
+#include "HorizonPlanner.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+// Nodes expanded between two looks at the clock
+constexpr uint64_t kClockInterval = 32;
+
+// Advances every queue by one step while `phase` is green and returns the
+// queueing delay accrued over the step (trapezoid rule)
+double advance(const std::vector<PlannerLane>& lanes, const HorizonSettings& settings,
+               const double* in, double* out, int phase, bool switched) {
+    double dt = settings.stepSeconds;
+    double green = switched ? std::max(0.0, dt - settings.lostSeconds) : dt;
+    double cost = 0.0;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        double queue = in[i] + lanes[i].arrivalRate * dt;
+        if (static_cast<int>(i) == phase) {
+            queue -= std::min(queue, lanes[i].dischargeRate * green);
+        }
+        out[i] = queue;
+        cost += lanes[i].weight * 0.5 * (in[i] + queue) * dt;
+    }
+    return cost;
+}
+
+// Green seconds the phase has run after this step
+double nextRun(const HorizonSettings& settings, double run, bool switched) {
+    return switched ? std::max(0.0, settings.stepSeconds - settings.lostSeconds) : run + settings.stepSeconds;
+}
+
+bool mustHold(const HorizonSettings& settings, int phase, double run) {
+    return phase >= 0 && run < settings.minGreenSeconds;
+}
+
+double terminalCost(const std::vector<PlannerLane>& lanes, const HorizonSettings& settings, const double* queues) {
+    double total = 0.0;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        total += lanes[i].weight * queues[i];
+    }
+    return total * settings.stepSeconds;
+}
+
+} // namespace
+
+int HorizonPlan::firstRun() const {
+    int run = 0;
+    while (run < steps && phases[run] == phases[0]) {
+        ++run;
+    }
+    return run;
+}
+
+double HorizonPlanner::sequenceCost(const std::vector<PlannerLane>& lanes, int currentGreen, double greenElapsed,
+                                    const HorizonSettings& settings, const int* phases, int steps) {
+    std::vector<double> state(lanes.size());
+    std::vector<double> next(lanes.size());
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        state[i] = lanes[i].queue;
+    }
+    int phase = currentGreen;
+    double run = greenElapsed;
+    double cost = 0.0;
+    for (int step = 0; step < steps; ++step) {
+        if (mustHold(settings, phase, run) && phases[step] != phase) {
+            return kInfinity;
+        }
+        bool switched = phases[step] != phase;
+        cost += advance(lanes, settings, state.data(), next.data(), phases[step], switched);
+        run = nextRun(settings, run, switched);
+        phase = phases[step];
+        state.swap(next);
+    }
+    return cost + terminalCost(lanes, settings, state.data());
+}
+
+HorizonPlan HorizonPlanner::plan(const std::vector<PlannerLane>& laneInputs, int currentGreen, double greenElapsed,
+                                 const HorizonSettings& config) {
+    deadline = std::chrono::steady_clock::now() + config.budget;
+    best = HorizonPlan();
+    size_t count = laneInputs.size();
+    if (count == 0) {
+        best.complete = true;
+        return best;
+    }
+
+    lanes = &laneInputs;
+    settings = &config;
+    steps = std::max(1, std::min(config.steps, HorizonPlan::kMaxSteps));
+    outOfTime = false;
+    totalArrivals = 0.0;
+    maxDischarge = 0.0;
+    minWeight = laneInputs.front().weight;
+    for (const auto& lane : laneInputs) {
+        totalArrivals += lane.arrivalRate;
+        maxDischarge = std::max(maxDischarge, lane.dischargeRate);
+        minWeight = std::min(minWeight, lane.weight);
+    }
+    if (queues.size() < (steps + 1) * count) {
+        queues.resize((HorizonPlan::kMaxSteps + 1) * count);
+        order.resize(HorizonPlan::kMaxSteps * count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        queues[i] = laneInputs[i].queue;
+    }
+    if (currentGreen >= static_cast<int>(count)) {
+        currentGreen = -1;
+    }
+
+    // Greedy rollout: serve the longest queue, keeping the current green on ties
+    {
+        int phase = currentGreen;
+        double run = greenElapsed;
+        double cost = 0.0;
+        for (int depth = 0; depth < steps; ++depth) {
+            const double* row = &queues[depth * count];
+            int choice = phase;
+            if (!mustHold(config, phase, run)) {
+                for (size_t i = 0; i < count; ++i) {
+                    if (choice < 0 || row[i] > row[choice]) {
+                        choice = static_cast<int>(i);
+                    }
+                }
+            }
+            bool switched = choice != phase;
+            cost += advance(laneInputs, config, row, &queues[(depth + 1) * count], choice, switched);
+            run = nextRun(config, run, switched);
+            phase = choice;
+            best.phases[depth] = choice;
+        }
+        best.steps = steps;
+        best.cost = cost + terminalCost(laneInputs, config, &queues[steps * count]);
+    }
+
+    search(0, currentGreen, greenElapsed, 0.0);
+    best.complete = !outOfTime;
+    return best;
+}
+
+double HorizonPlanner::lowerBound(int depth, double total) const {
+    // However the remaining steps are assigned, the total queue falls by at
+    // most the fastest discharge rate per second, and no vehicle weighs less
+    // than the lightest lane
+    double dt = settings->stepSeconds;
+    double bound = 0.0;
+    for (int step = depth; step < steps; ++step) {
+        double next = std::max(0.0, total + (totalArrivals - maxDischarge) * dt);
+        bound += 0.5 * (total + next) * dt;
+        total = next;
+    }
+    return minWeight * (bound + total * dt);
+}
+
+void HorizonPlanner::search(int depth, int phase, double run, double cost) {
+    size_t count = lanes->size();
+    const double* row = &queues[depth * count];
+    if (depth == steps) {
+        double total = cost + terminalCost(*lanes, *settings, row);
+        if (total < best.cost) {
+            best.cost = total;
+            std::copy(path, path + steps, best.phases);
+        }
+        return;
+    }
+
+    best.nodes++;
+    if (best.nodes % kClockInterval == 0 && std::chrono::steady_clock::now() >= deadline) {
+        outOfTime = true;
+    }
+    if (outOfTime) {
+        return;
+    }
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total += row[i];
+    }
+    if (cost + lowerBound(depth, total) >= best.cost) {
+        return;
+    }
+
+    // Children: the current phase first, then the longest queues, so good
+    // plans are found early and prune the rest
+    int* children = &order[depth * count];
+    size_t childCount = 0;
+    if (phase >= 0) {
+        children[childCount++] = phase;
+    }
+    if (!mustHold(*settings, phase, run)) {
+        for (size_t i = 0; i < count; ++i) {
+            int lane = static_cast<int>(i);
+            if (lane == phase) {
+                continue;
+            }
+            size_t slot = childCount++;
+            while (slot > (phase >= 0 ? 1u : 0u) && row[children[slot - 1]] < row[lane]) {
+                children[slot] = children[slot - 1];
+                --slot;
+            }
+            children[slot] = lane;
+        }
+    }
+
+    double* next = &queues[(depth + 1) * count];
+    for (size_t c = 0; c < childCount && !outOfTime; ++c) {
+        int child = children[c];
+        bool switched = child != phase;
+        double stepCost = advance(*lanes, *settings, row, next, child, switched);
+        path[depth] = child;
+        search(depth + 1, child, nextRun(*settings, run, switched), cost + stepCost);
+    }
+}
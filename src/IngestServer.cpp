@@ -0,0 +1,369 @@
+#include "IngestServer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Room for one maximal frame plus a partial one behind it
+constexpr size_t kReceiveBufferBytes = 2 * ingest::kMaxFrameBytes;
+constexpr int kMaxEvents = 64;
+
+void setNonBlocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+std::runtime_error socketError(const std::string& what) {
+    return std::runtime_error("IngestServer: " + what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+struct IngestServer::Connection {
+    int fd;
+    std::unique_ptr<uint8_t[]> buffer;
+    size_t used = 0;
+
+    explicit Connection(int fd) : fd(fd), buffer(new uint8_t[kReceiveBufferBytes]) {}
+};
+
+IngestServer::IngestServer(const std::vector<std::shared_ptr<Intersection>>& intersections)
+    : intersections(intersections)
+    , epollFd(-1)
+    , wakeFd(-1)
+    , running(false)
+    , connectionsAccepted(0)
+    , frames(0)
+    , records(0)
+    , recordsRejected(0)
+    , protocolErrors(0)
+{
+    laneTables.resize(intersections.size());
+    for (uint32_t i = 0; i < intersections.size(); ++i) {
+        lanesOf(i);
+    }
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        throw socketError("cannot create epoll instance");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0) {
+        auto error = socketError("cannot watch wakeup event");
+        ::close(wakeFd);
+        ::close(epollFd);
+        throw error;
+    }
+}
+
+IngestServer::~IngestServer() {
+    stop();
+    for (auto& connection : connections) {
+        if (connection) {
+            ::close(connection->fd);
+        }
+    }
+    for (int listener : listeners) {
+        ::close(listener);
+    }
+    if (!unixPath.empty()) {
+        ::unlink(unixPath.c_str());
+    }
+    ::close(wakeFd);
+    ::close(epollFd);
+}
+
+void IngestServer::listenUnix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("IngestServer: socket path too long: " + path);
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw socketError("cannot create socket");
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 64) < 0) {
+        ::close(fd);
+        throw socketError("cannot listen on " + path);
+    }
+    setNonBlocking(fd);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        auto error = socketError("cannot watch " + path);
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw error;
+    }
+    listeners.push_back(fd);
+    unixPath = path;
+}
+
+uint16_t IngestServer::listenTcp(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw socketError("cannot create socket");
+    }
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 64) < 0) {
+        ::close(fd);
+        throw socketError("cannot listen on port " + std::to_string(port));
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    setNonBlocking(fd);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        auto error = socketError("cannot watch port " + std::to_string(port));
+        ::close(fd);
+        throw error;
+    }
+    listeners.push_back(fd);
+    return ntohs(address.sin_port);
+}
+
+void IngestServer::start() {
+    if (!running.exchange(true)) {
+        ioThread = std::make_unique<std::thread>(&IngestServer::ioLoop, this);
+    }
+}
+
+void IngestServer::stop() {
+    if (running.exchange(false)) {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+        if (ioThread && ioThread->joinable()) {
+            ioThread->join();
+        }
+    }
+}
+
+bool IngestServer::isRunning() const {
+    return running.load();
+}
+
+IngestStats IngestServer::getStats() const {
+    IngestStats stats;
+    stats.connectionsAccepted = connectionsAccepted.load();
+    stats.frames = frames.load();
+    stats.records = records.load();
+    stats.recordsRejected = recordsRejected.load();
+    stats.protocolErrors = protocolErrors.load();
+    return stats;
+}
+
+void IngestServer::ioLoop() {
+    epoll_event events[kMaxEvents];
+    while (running) {
+        int ready = ::epoll_wait(epollFd, events, kMaxEvents, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                // Level-triggered: drain it, or a later start() spins on it
+                uint64_t value;
+                ssize_t ignored = ::read(wakeFd, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+            bool isListener = false;
+            for (int listener : listeners) {
+                if (fd == listener) {
+                    acceptConnections(listener);
+                    isListener = true;
+                }
+            }
+            if (isListener) {
+                continue;
+            }
+            auto index = static_cast<size_t>(fd);
+            if (index < connections.size() && connections[index] && !readConnection(*connections[index])) {
+                closeConnection(fd);
+            }
+        }
+    }
+}
+
+void IngestServer::acceptConnections(int listener) {
+    while (true) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        auto index = static_cast<size_t>(fd);
+        if (index >= connections.size()) {
+            connections.resize(index + 1);
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        // A connection epoll cannot report would never be read; drop it
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ::close(fd);
+            continue;
+        }
+        connections[index] = std::make_unique<Connection>(fd);
+        connectionsAccepted++;
+    }
+}
+
+bool IngestServer::readConnection(Connection& connection) {
+    // Bounded so one busy feed cannot starve the others; epoll reports it again
+    for (int reads = 0; reads < 16; ++reads) {
+        ssize_t received = ::recv(connection.fd, connection.buffer.get() + connection.used,
+                                  kReceiveBufferBytes - connection.used, 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        connection.used += static_cast<size_t>(received);
+
+        // Apply every complete frame, then move the partial tail to the front
+        size_t offset = 0;
+        while (connection.used - offset >= ingest::kLengthBytes) {
+            const uint8_t* frame = connection.buffer.get() + offset;
+            uint32_t length = ingest::loadU32(frame);
+            if (length < ingest::kBatchHeaderBytes || length + ingest::kLengthBytes > ingest::kMaxFrameBytes) {
+                protocolErrors++;
+                return false;
+            }
+            if (connection.used - offset < ingest::kLengthBytes + length) {
+                break;
+            }
+            const uint8_t* batch = frame + ingest::kLengthBytes;
+            uint32_t count = ingest::loadU32(batch + 4);
+            if (ingest::loadU16(batch) != ingest::kMagic || ingest::loadU16(batch + 2) != ingest::kVersion ||
+                static_cast<size_t>(count) * ingest::kRecordBytes != length - ingest::kBatchHeaderBytes) {
+                protocolErrors++;
+                return false;
+            }
+            applyBatch(batch + ingest::kBatchHeaderBytes, count);
+            offset += ingest::kLengthBytes + length;
+        }
+        if (offset > 0) {
+            std::memmove(connection.buffer.get(), connection.buffer.get() + offset, connection.used - offset);
+            connection.used -= offset;
+        }
+    }
+    return true;
+}
+
+const IngestServer::LaneTable& IngestServer::lanesOf(uint32_t index) {
+    LaneTable& table = laneTables[index];
+    if (table.loaded && table.checkedBatch == batchNumber) {
+        return table;
+    }
+    table.checkedBatch = batchNumber;
+    const Intersection& intersection = *intersections[index];
+    uint64_t version = intersection.getConfigVersion();
+    if (table.loaded && version == table.version) {
+        return table;
+    }
+    table.loaded = true;
+    // Lanes may change while the table is read; read again until it is consistent
+    do {
+        table.version = version;
+        table.lanes.clear();
+        for (size_t lane = 0; auto entry = intersection.getLane(lane); ++lane) {
+            table.lanes.push_back(std::move(entry));
+        }
+        version = intersection.getConfigVersion();
+    } while (version != table.version);
+    return table;
+}
+
+void IngestServer::applyBatch(const uint8_t* batch, uint32_t count) {
+    uint64_t rejected = 0;
+    batchNumber++;
+    for (uint32_t i = 0; i < count; ++i) {
+        ingest::Record record = ingest::decodeRecord(batch + i * ingest::kRecordBytes);
+        if (record.intersection >= intersections.size()) {
+            rejected++;
+            continue;
+        }
+        Intersection& intersection = *intersections[record.intersection];
+        const LaneTable& table = lanesOf(record.intersection);
+        Lane* lane = record.lane < table.lanes.size() ? table.lanes[record.lane].get() : nullptr;
+
+        bool applied = lane != nullptr;
+        switch (record.kind) {
+            case ingest::RecordKind::VEHICLE_ARRIVALS:
+                applied = applied && record.value > 0;
+                if (applied) {
+                    lane->addVehicles(record.value);
+                }
+                break;
+            case ingest::RecordKind::VEHICLE_DEPARTURES:
+                applied = applied && record.value > 0;
+                if (applied) {
+                    lane->removeVehicles(record.value);
+                }
+                break;
+            case ingest::RecordKind::EMERGENCY_REPORT:
+                applied = applied && record.vehicle >= static_cast<uint8_t>(EmergencyVehicleType::AMBULANCE) &&
+                          record.vehicle <= static_cast<uint8_t>(EmergencyVehicleType::FIRE_TRUCK);
+                // Posted, so a tick holding the controller through a yellow
+                // does not stall the I/O thread
+                applied = applied && intersection.postEmergencyVehicle(*lane,
+                                                                       static_cast<EmergencyVehicleType>(record.vehicle));
+                break;
+            case ingest::RecordKind::EMERGENCY_CLEAR:
+                applied = applied && intersection.postEmergencyClear(*lane);
+                break;
+            case ingest::RecordKind::PEDESTRIAN_REQUEST:
+                intersection.requestPedestrianCrossing();
+                applied = true;
+                break;
+            case ingest::RecordKind::PEDESTRIAN_CLEAR:
+                intersection.clearPedestrianCrossing();
+                applied = true;
+                break;
+            default:
+                applied = false;
+                break;
+        }
+        if (!applied) {
+            rejected++;
+        }
+    }
+    frames++;
+    records += count;
+    recordsRejected += rejected;
+}
+
+void IngestServer::closeConnection(int fd) {
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections[static_cast<size_t>(fd)].reset();
+}
@@ -1,22 +1,95 @@
 #include "Intersection.hpp"
+#include "ControllerWakeup.hpp"
+#include "GreedyPolicy.hpp"
+#include "SignalEvents.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iostream>
-#include <unordered_map>
+#include <stdexcept>
 
 Intersection::Intersection(const std::string& id)
     : id(id)
+    , config(std::make_unique<Configuration>())
     , running(false)
     , emergencyActive(false)
+    , pedestrianCrossing(false)
+    , postedEmergencies(kPostedEmergencies)
+    , events(std::make_shared<SignalEventHub>())
+    , wakeup(std::make_shared<ControllerWakeup>())
+    , wakeups(0)
 {}
 
 Intersection::~Intersection() {
     stop();
 }
 
+void Intersection::reconfigure(const std::function<bool(Configuration&)>& modify) {
+    bool changed = false;
+    config.update([&](Configuration& next) {
+        changed = modify(next);
+        if (changed) {
+            next.version++;
+        }
+    });
+    if (changed) {
+        wakeup->notifyUrgent();
+    }
+}
+
 void Intersection::addLane(std::shared_ptr<Lane> lane, std::shared_ptr<TrafficLight> light) {
-    std::lock_guard<std::mutex> lock(mutex);
-    lanes.emplace_back(lane, light);
+    reconfigure([&](Configuration& next) {
+        light->attachEventHub(events, static_cast<uint32_t>(next.lanes.size()));
+        lane->setSignalLevel(next.params.saturationThreshold);
+        lane->attachWakeup(wakeup);
+        next.lanes.push_back({lane, light, std::nan(""), std::make_shared<LaneControl>()});
+        if (next.coordination) {
+            const auto& arterial = next.coordination->arterialLanes;
+            next.lanes.back().arterial = std::find(arterial.begin(), arterial.end(), lane->getId()) != arterial.end();
+        }
+        return true;
+    });
+}
+
+bool Intersection::removeLane(const std::string& laneId) {
+    std::shared_ptr<Lane> removedLane;
+    std::shared_ptr<TrafficLight> removedLight;
+    reconfigure([&](Configuration& next) {
+        auto it = std::find_if(next.lanes.begin(), next.lanes.end(),
+                               [&](const LaneEntry& entry) { return entry.lane->getId() == laneId; });
+        if (it == next.lanes.end()) {
+            return false;
+        }
+        removedLane = it->lane;
+        removedLight = it->light;
+        next.lanes.erase(it);
+        for (size_t i = 0; i < next.lanes.size(); ++i) {
+            next.lanes[i].light->attachEventHub(events, static_cast<uint32_t>(i));
+        }
+        return true;
+    });
+    if (!removedLane) {
+        return false;
+    }
+
+    // No tick can see the lane any more; release it from control
+    removedLane->attachWakeup(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        bool hadEmergency = removedLane->hasEmergencyVehicle();
+        removedLane->clearEmergencyVehicle();
+        // Detach first: the light's old index now belongs to another lane
+        removedLight->attachEventHub(nullptr, 0);
+        removedLight->deactivateEmergencyMode();
+        removedLight->setState(LightState::RED);
+        if (hadEmergency) {
+            auto current = config.read();
+            emergencyActive.store(std::any_of(current->lanes.begin(), current->lanes.end(),
+                [](const LaneEntry& entry) { return entry.lane->hasEmergencyVehicle(); }));
+        }
+    }
+    wakeup->notifyUrgent();
+    return true;
 }
 
 void Intersection::start() {
@@ -27,6 +100,7 @@ void Intersection::start() {
 
 void Intersection::stop() {
     if (running.exchange(false)) {
+        wakeup->notifyUrgent();
         if (controlThread && controlThread->joinable()) {
             controlThread->join();
         }
@@ -37,218 +111,602 @@ bool Intersection::isRunning() const {
     return running.load();
 }
 
-void Intersection::reportEmergencyVehicle(const std::string& laneId, EmergencyVehicleType type) {
-    std::lock_guard<std::mutex> lock(mutex);
-    for (auto& [lane, light] : lanes) {
-        if (lane->getId() == laneId) {
-            lane->setEmergencyVehicle(type);
-            light->activateEmergencyMode(type);
-            emergencyActive.store(true);
-            
-            std::string vehicleTypeStr;
-            switch (type) {
-                case EmergencyVehicleType::AMBULANCE: vehicleTypeStr = "AMBULANCE"; break;
-                case EmergencyVehicleType::POLICE: vehicleTypeStr = "POLICE"; break;
-                case EmergencyVehicleType::FIRE_TRUCK: vehicleTypeStr = "FIRE TRUCK"; break;
-                default: vehicleTypeStr = "UNKNOWN"; break;
+uint64_t Intersection::getWakeupCount() const {
+    return wakeups.load();
+}
+
+void Intersection::step() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    auto current = config.read();
+    applyPostedEmergencies(*current);
+    sampleLaneStatistics(*current);
+    if (emergencyActive.load()) {
+        handleEmergencyVehicles(*current);
+    } else if (pedestrianCrossing.load()) {
+        holdForPedestrians(*current);
+    } else {
+        optimizeTrafficFlow(*current);
+    }
+}
+
+void Intersection::setClock(std::shared_ptr<Clock> newClock) {
+    reconfigure([&](Configuration& next) {
+        events->setClock(newClock);
+        next.clock = newClock;
+        return true;
+    });
+}
+
+void Intersection::setParams(const ControllerParams& newParams) {
+    const auto& p = newParams;
+    if (!(p.saturationThreshold >= 0.0 && p.saturationThreshold <= 1.0)) {
+        throw std::invalid_argument("Intersection " + id + ": saturation threshold must be between 0 and 1");
+    }
+    if (p.minGreen.count() < 0 || p.baseGreen.count() < 0 || p.greenRange.count() < 0 ||
+        p.emergencyGreen.count() < 0 || p.yellow.count() < 0 || p.demandHorizon.count() < 0 ||
+        p.planningBudget.count() < 0 || p.startupLostTime.count() < 0 || p.waitWeightTime.count() < 0) {
+        throw std::invalid_argument("Intersection " + id + ": controller durations must not be negative");
+    }
+    if (p.horizonSteps <= 0 || p.horizonStep.count() <= 0) {
+        throw std::invalid_argument("Intersection " + id + ": horizon steps and step length must be positive");
+    }
+    if (!std::isfinite(p.saturationFlow) || p.saturationFlow < 0.0) {
+        throw std::invalid_argument("Intersection " + id + ": saturation flow must be a finite rate");
+    }
+    reconfigure([&](Configuration& next) {
+        next.params = newParams;
+        for (const auto& entry : next.lanes) {
+            entry.lane->setSignalLevel(newParams.saturationThreshold);
+        }
+        return true;
+    });
+}
+
+ControllerParams Intersection::getParams() const {
+    return config.read()->params;
+}
+
+uint64_t Intersection::getConfigVersion() const {
+    return config.read()->version;
+}
+
+const std::string& Intersection::getId() const {
+    return id;
+}
+
+size_t Intersection::getLaneCount() const {
+    return config.read()->lanes.size();
+}
+
+std::shared_ptr<Lane> Intersection::getLane(size_t index) const {
+    auto current = config.read();
+    return index < current->lanes.size() ? current->lanes[index].lane : nullptr;
+}
+
+std::shared_ptr<TrafficLight> Intersection::getLight(size_t index) const {
+    auto current = config.read();
+    return index < current->lanes.size() ? current->lanes[index].light : nullptr;
+}
+
+void Intersection::setLocation(const Position& position) {
+    reconfigure([&](Configuration& next) {
+        next.location = position;
+        return true;
+    });
+}
+
+Position Intersection::getLocation() const {
+    return config.read()->location;
+}
+
+void Intersection::setApproachHeading(size_t laneIndex, double heading) {
+    reconfigure([&](Configuration& next) {
+        if (laneIndex >= next.lanes.size()) {
+            return false;
+        }
+        next.lanes[laneIndex].approachHeading = std::fmod(std::fmod(heading, 360.0) + 360.0, 360.0);
+        return true;
+    });
+}
+
+double Intersection::getApproachHeading(size_t laneIndex) const {
+    auto current = config.read();
+    return laneIndex < current->lanes.size() ? current->lanes[laneIndex].approachHeading : std::nan("");
+}
+
+void Intersection::setCoordinationPlan(const CoordinationPlan& plan) {
+    if (plan.cycle.count() <= 0 || plan.green.count() <= 0 || plan.green >= plan.cycle) {
+        throw std::invalid_argument("Intersection: coordination green must be shorter than a positive cycle");
+    }
+    auto shared = std::make_shared<const CoordinationPlan>(plan);
+    reconfigure([&](Configuration& next) {
+        for (const auto& id : plan.arterialLanes) {
+            if (std::none_of(next.lanes.begin(), next.lanes.end(),
+                             [&](const LaneEntry& entry) { return entry.lane->getId() == id; })) {
+                throw std::invalid_argument("Intersection " + this->id + ": no lane " + id);
             }
-            
-            // Emergency detection logged (visual display handles this)
+        }
+        for (auto& entry : next.lanes) {
+            entry.arterial = std::find(plan.arterialLanes.begin(), plan.arterialLanes.end(),
+                                       entry.lane->getId()) != plan.arterialLanes.end();
+        }
+        next.coordination = shared;
+        return true;
+    });
+}
+
+void Intersection::clearCoordinationPlan() {
+    reconfigure([](Configuration& next) {
+        if (!next.coordination) {
+            return false;
+        }
+        for (auto& entry : next.lanes) {
+            entry.arterial = false;
+        }
+        next.coordination.reset();
+        return true;
+    });
+}
+
+bool Intersection::isCoordinated() const {
+    return config.read()->coordination != nullptr;
+}
+
+HorizonPlan Intersection::getLastPlan() const {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return lastPlan;
+}
+
+void Intersection::collectStatistics(std::vector<LaneStatisticsSnapshot>& out) const {
+    auto current = config.read();
+    out.resize(current->lanes.size());
+    for (size_t i = 0; i < current->lanes.size(); ++i) {
+        out[i] = current->lanes[i].lane->getStatistics().snapshot();
+    }
+}
+
+void Intersection::reportEmergencyVehicle(const std::string& laneId, EmergencyVehicleType type) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    auto current = config.read();
+    for (const auto& entry : current->lanes) {
+        if (entry.lane->getId() == laneId) {
+            reportEmergencyLocked(entry, type);
             break;
         }
     }
 }
 
+void Intersection::reportEmergencyVehicle(size_t laneIndex, EmergencyVehicleType type) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    auto current = config.read();
+    if (laneIndex < current->lanes.size()) {
+        reportEmergencyLocked(current->lanes[laneIndex], type);
+    }
+}
+
 void Intersection::clearEmergencyVehicle(const std::string& laneId) {
-    std::lock_guard<std::mutex> lock(mutex);
-    for (auto& [lane, light] : lanes) {
-        if (lane->getId() == laneId) {
-            lane->clearEmergencyVehicle();
-            light->deactivateEmergencyMode();
-            
-            // Check if any other lanes have emergency vehicles
-            bool anyEmergencyActive = false;
-            for (const auto& [otherLane, otherLight] : lanes) {
-                if (otherLane->hasEmergencyVehicle()) {
-                    anyEmergencyActive = true;
-                    break;
-                }
+    std::lock_guard<std::mutex> lock(controlMutex);
+    auto current = config.read();
+    for (const auto& entry : current->lanes) {
+        if (entry.lane->getId() == laneId) {
+            clearEmergencyLocked(*current, entry);
+            break;
+        }
+    }
+}
+
+void Intersection::clearEmergencyVehicle(size_t laneIndex) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    auto current = config.read();
+    if (laneIndex < current->lanes.size()) {
+        clearEmergencyLocked(*current, current->lanes[laneIndex]);
+    }
+}
+
+bool Intersection::postEmergencyVehicle(const Lane& lane, EmergencyVehicleType type) {
+    return type != EmergencyVehicleType::NONE && postEmergency(lane, type);
+}
+
+bool Intersection::postEmergencyClear(const Lane& lane) {
+    return postEmergency(lane, EmergencyVehicleType::NONE);
+}
+
+bool Intersection::postEmergency(const Lane& lane, EmergencyVehicleType type) {
+    std::unique_lock<std::mutex> lock(controlMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        if (!postedEmergencies.tryPush({&lane, type})) {
+            return false;
+        }
+        wakeup->notifyUrgent();
+        return true;
+    }
+    // Earlier posts go first, so one feed's report and clear stay in order
+    auto current = config.read();
+    applyPostedEmergencies(*current);
+    applyPostedEmergency(*current, {&lane, type});
+    return true;
+}
+
+void Intersection::applyPostedEmergencies(const Configuration& current) {
+    PostedEmergency posted;
+    while (postedEmergencies.tryPop(posted)) {
+        applyPostedEmergency(current, posted);
+    }
+}
+
+void Intersection::applyPostedEmergency(const Configuration& current, const PostedEmergency& posted) {
+    for (const auto& entry : current.lanes) {
+        if (entry.lane.get() == posted.lane) {
+            if (posted.type == EmergencyVehicleType::NONE) {
+                clearEmergencyLocked(current, entry);
+            } else {
+                reportEmergencyLocked(entry, posted.type);
             }
-            emergencyActive.store(anyEmergencyActive);
-            
-            // Emergency cleared (visual display handles this)
+            return;
+        }
+    }
+}
+
+void Intersection::reportEmergencyLocked(const LaneEntry& entry, EmergencyVehicleType type) {
+    entry.lane->setEmergencyVehicle(type);
+    entry.light->activateEmergencyMode(type);
+    emergencyActive.store(true);
+    wakeup->notifyUrgent();
+}
+
+void Intersection::clearEmergencyLocked(const Configuration& current, const LaneEntry& entry) {
+    entry.lane->clearEmergencyVehicle();
+    entry.light->deactivateEmergencyMode();
+
+    // Check if any other lanes have emergency vehicles
+    bool anyEmergencyActive = false;
+    for (const auto& other : current.lanes) {
+        if (other.lane->hasEmergencyVehicle()) {
+            anyEmergencyActive = true;
             break;
         }
     }
+    emergencyActive.store(anyEmergencyActive);
+    wakeup->notifyUrgent();
+}
+
+void Intersection::requestPedestrianCrossing() {
+    if (!pedestrianCrossing.exchange(true)) {
+        events->publish(SignalEvent::Kind::PEDESTRIAN_ON, SignalEvent::kIntersectionWide);
+        wakeup->notifyUrgent();
+    }
+}
+
+void Intersection::clearPedestrianCrossing() {
+    if (pedestrianCrossing.exchange(false)) {
+        events->publish(SignalEvent::Kind::PEDESTRIAN_OFF, SignalEvent::kIntersectionWide);
+        wakeup->notifyUrgent();
+    }
+}
+
+std::shared_ptr<Subscription> Intersection::subscribe() {
+    return events->subscribe();
+}
+
+std::shared_ptr<Subscription> Intersection::subscribe(const SubscriptionOptions& options) {
+    return events->subscribe(options);
+}
+
+void Intersection::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    events->unsubscribe(subscription);
+}
+
+bool Intersection::isPedestrianCrossingActive() const {
+    return pedestrianCrossing.load();
 }
 
 void Intersection::controlLoop() {
-    using namespace std::chrono_literals;
-    
     while (running) {
-        if (emergencyActive.load()) {
-            handleEmergencyVehicles();
-        } else {
-            optimizeTrafficFlow();
+        wakeups++;
+        // Taken before the tick so changes made during it trigger another look
+        bool activity = wakeup->consumeActivity();
+        step();
+        bool wakeOnActivity = false;
+        auto sleep = planSleep(activity, wakeOnActivity);
+        if (running) {
+            wakeup->waitFor(sleep, wakeOnActivity);
         }
-        std::this_thread::sleep_for(500ms); // Faster response time for emergencies
     }
 }
 
-void Intersection::handleEmergencyVehicles() {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    // Find all lanes with emergency vehicles
-    std::vector<std::pair<std::shared_ptr<Lane>, std::shared_ptr<TrafficLight>>> emergencyLanes;
-    
-    for (auto& [lane, light] : lanes) {
-        if (lane->hasEmergencyVehicle()) {
-            emergencyLanes.emplace_back(lane, light);
+Clock::duration Intersection::planSleep(bool activity, bool& wakeOnActivity) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    auto current = config.read();
+    const ControllerParams& params = current->params;
+    auto now = current->clock->now();
+    wakeOnActivity = false;
+
+    // Emergency and pedestrian holds end only on an explicit clear
+    if (emergencyActive.load() || pedestrianCrossing.load()) {
+        return kMaxIdleSleep;
+    }
+
+    // Nothing can change until the current minimum green has run
+    Clock::time_point holdUntil = now;
+    Clock::time_point greenExpiry = now + kMaxIdleSleep;
+    for (const auto& entry : current->lanes) {
+        if (entry.light->getState() != LightState::GREEN || !entry.control->seen) {
+            continue;
         }
+        holdUntil = std::max(holdUntil, entry.control->lastGreen + params.minGreen);
+        auto expiry = entry.control->lastGreen + entry.light->getDuration();
+        if (expiry > now) {
+            greenExpiry = std::min(greenExpiry, expiry);
+        }
+    }
+    if (holdUntil > now) {
+        return holdUntil - now;
+    }
+    // A coordinated intersection also changes phase at the plan's boundaries
+    if (current->coordination) {
+        const CoordinationPlan& plan = *current->coordination;
+        auto position = intoCycle(plan, now);
+        auto boundary = position < plan.green ? Clock::duration(plan.green) : Clock::duration(plan.cycle);
+        greenExpiry = std::min(greenExpiry, now + (boundary - position));
     }
-    
-    if (emergencyLanes.empty()) {
+
+    // Keep re-evaluating while counts change and the smoothed occupancy the
+    // decision uses is still converging
+    if (activity && params.smoothOccupancy) {
+        settleUntil = now + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(5 * LaneStatistics::kOccupancyTimeConstant));
+    }
+    if (activity || now < settleUntil) {
+        return kActivityPeriod;
+    }
+
+    wakeOnActivity = true;
+    return greenExpiry - now;
+}
+
+void Intersection::handleEmergencyVehicles(const Configuration& current) {
+    // Find the highest priority emergency lane in a single pass; the first
+    // lane wins among equal priorities
+    TrafficLight* priorityLight = nullptr;
+    int bestPriority = 0;
+    for (const auto& entry : current.lanes) {
+        int priority = emergencyPriority(entry.lane->getEmergencyVehicleType());
+        if (priority > bestPriority) {
+            bestPriority = priority;
+            priorityLight = entry.light.get();
+        }
+    }
+
+    if (!priorityLight) {
         emergencyActive.store(false);
         return;
     }
-    
-    // Priority order: Fire Truck > Ambulance > Police
-    auto getEmergencyPriority = [](EmergencyVehicleType type) {
-        switch (type) {
-            case EmergencyVehicleType::FIRE_TRUCK: return 3;
-            case EmergencyVehicleType::AMBULANCE: return 2;
-            case EmergencyVehicleType::POLICE: return 1;
-            default: return 0;
-        }
-    };
-    
-    // Sort by priority
-    std::sort(emergencyLanes.begin(), emergencyLanes.end(),
-        [&](const auto& a, const auto& b) {
-            return getEmergencyPriority(a.first->getEmergencyVehicleType()) >
-                   getEmergencyPriority(b.first->getEmergencyVehicleType());
-        });
-    
-    // Give green light to highest priority emergency vehicle
-    auto [priorityLane, priorityLight] = emergencyLanes[0];
-    
+
     // Set all other lights to red
-    for (auto& [lane, light] : lanes) {
-        if (light != priorityLight) {
-            light->setState(LightState::RED);
+    for (const auto& entry : current.lanes) {
+        if (entry.light.get() != priorityLight) {
+            entry.light->setState(LightState::RED);
         }
     }
 
     // Transition priority lane: RED -> YELLOW -> GREEN
     if (priorityLight->getState() != LightState::GREEN) {
         priorityLight->setState(LightState::YELLOW);
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        current.clock->sleepFor(current.params.yellow);
         priorityLight->setState(LightState::GREEN);
     }
     // Ensure minimum green duration of 4 seconds
-    auto emergencyDuration = std::chrono::seconds(90);
+    auto emergencyDuration = current.params.emergencyGreen;
     if (emergencyDuration < std::chrono::seconds(4)) emergencyDuration = std::chrono::seconds(4);
     priorityLight->setDuration(emergencyDuration); // Extended time for emergency
-    
-    std::string vehicleTypeStr;
-    switch (priorityLane->getEmergencyVehicleType()) {
-        case EmergencyVehicleType::FIRE_TRUCK: vehicleTypeStr = "FIRE TRUCK"; break;
-        case EmergencyVehicleType::AMBULANCE: vehicleTypeStr = "AMBULANCE"; break;
-        case EmergencyVehicleType::POLICE: vehicleTypeStr = "POLICE"; break;
-        default: vehicleTypeStr = "EMERGENCY VEHICLE"; break;
-    }
-    
+
     // Priority handled (visual display shows this)
 }
 
-void Intersection::optimizeTrafficFlow() {
-    std::lock_guard<std::mutex> lock(mutex);
-    
-    // Check if all lanes have occupancy above 80%
-    bool allAbove80 = true;
-    for (const auto& [lane, light] : lanes) {
-        if (lane->getOccupancyRatio() < 0.8) {
-            allAbove80 = false;
-            break;
+void Intersection::holdForPedestrians(const Configuration& current) {
+    // Emergency vehicles keep priority over pedestrians
+    for (const auto& entry : current.lanes) {
+        if (!entry.light->isInEmergencyMode()) {
+            entry.light->setState(LightState::RED);
         }
     }
+}
+
+void Intersection::sampleLaneStatistics(const Configuration& current) {
+    auto now = current.clock->now();
+    for (const auto& entry : current.lanes) {
+        entry.lane->sampleStatistics(now);
+    }
+}
 
-    auto now = std::chrono::steady_clock::now();
-    // Initialize missing lanes in lastGreenTime /  tracks when each lane last got a green light.
-    for (const auto& [lane, light] : lanes) {
-        if (lastGreenTime.find(lane.get()) == lastGreenTime.end()) {
-            lastGreenTime[lane.get()] = now;
+double Intersection::decisionOccupancy(const ControllerParams& params, const Lane& lane) {
+    if (params.smoothOccupancy && lane.getStatistics().sampleCount() > 0) {
+        return lane.getStatistics().smoothedOccupancy();
+    }
+    return lane.getOccupancyRatio();
+}
+
+double Intersection::greenOccupancy(const ControllerParams& params, const Lane& lane) {
+    if (params.demandHorizon.count() > 0) {
+        return lane.predictedDemand(params.demandHorizon) / lane.getCapacity();
+    }
+    return lane.getOccupancyRatio();
+}
+
+void Intersection::optimizeTrafficFlow(const Configuration& current) {
+    const auto& lanes = current.lanes;
+    const ControllerParams& params = current.params;
+    if (lanes.empty()) {
+        return;
+    }
+
+    auto now = current.clock->now();
+    // A lane counts as served when the controller first sees it
+    for (const auto& entry : lanes) {
+        if (!entry.control->seen) {
+            entry.control->lastGreen = now;
+            entry.control->seen = true;
         }
     }
 
-    // Enforce minimum green duration of 4 seconds for all lanes
-    for (const auto& [lane, light] : lanes) {
-        if (light->getState() == LightState::GREEN) {
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - lastGreenTime[lane.get()]);
-            if (elapsed.count() < 5) {
-                // Skip changing this lane's light if green duration < 4 sec
+    // Enforce the minimum green duration (5 seconds by default) for all lanes
+    for (const auto& entry : lanes) {
+        if (entry.light->getState() == LightState::GREEN) {
+            if (now - entry.control->lastGreen < params.minGreen) {
+                // Skip changing this lane's light until its minimum green has elapsed
                 return;
             }
         }
     }
 
-    if (allAbove80) {
-        // Find the lane not given green for the longest time
-        auto oldestLaneIt = std::min_element(lanes.begin(), lanes.end(),
-            [&](const auto& a, const auto& b) {
-                return lastGreenTime[a.first.get()] < lastGreenTime[b.first.get()];
-            });
-        auto laneToGreen = oldestLaneIt->first;
-        auto lightToGreen = oldestLaneIt->second;
-        // Set all other lights to red
-        for (auto& [_, otherLight] : lanes) {
-            if (otherLight != lightToGreen && !otherLight->isInEmergencyMode()) {
-                otherLight->setState(LightState::RED);
-            }
+    if (current.coordination && followCoordinationPlan(current, now)) {
+        return;
+    }
+
+    if (params.policy == ControlPolicy::ROLLING_HORIZON) {
+        optimizeWithHorizon(current, now);
+        return;
+    }
+
+    // Serve the fullest lane or, when every lane is saturated (80% by
+    // default), rotate to the lane not given green for the longest time
+    greedyOccupancy.resize(lanes.size());
+    greedyLastGreen.resize(lanes.size());
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        greedyOccupancy[i] = decisionOccupancy(params, *lanes[i].lane);
+        greedyLastGreen[i] = lanes[i].control->lastGreen;
+    }
+    GreedyChoice choice = chooseGreedyLane(greedyOccupancy.data(), greedyLastGreen.data(), lanes.size(),
+                                           params.saturationThreshold);
+    const LaneEntry& chosen = lanes[choice.lane];
+    const auto& light = chosen.light;
+    if (!choice.rotation && light->getState() == LightState::GREEN) {
+        return;
+    }
+    // Set all other lights to red
+    for (const auto& entry : lanes) {
+        if (entry.light != light && !entry.light->isInEmergencyMode()) {
+            entry.light->setState(LightState::RED);
         }
-        // Set selected lane to green, with YELLOW transition
-        if (!lightToGreen->isInEmergencyMode()) {
-            if (lightToGreen->getState() != LightState::GREEN) {
-                lightToGreen->setState(LightState::YELLOW);
-                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-                lightToGreen->setState(LightState::GREEN);
-            }
-            lastGreenTime[laneToGreen.get()] = now;
-            // Adjust duration based on occupancy
-            auto occupancyRatio = laneToGreen->getOccupancyRatio();
-            auto duration = std::chrono::seconds(
-                static_cast<int>(30 + (occupancyRatio * 30))); // 30-60 seconds
-            if (duration < std::chrono::seconds(4)) duration = std::chrono::seconds(4);
-            lightToGreen->setDuration(duration);
+    }
+    // Set selected lane to green, with YELLOW transition
+    if (!light->isInEmergencyMode()) {
+        if (light->getState() != LightState::GREEN) {
+            light->setState(LightState::YELLOW);
+            current.clock->sleepFor(params.yellow);
+            light->setState(LightState::GREEN);
         }
-    } else {
-        // Find the lane with highest occupancy
-        auto maxOccupancyLane = std::max_element(lanes.begin(), lanes.end(),
-            [](const auto& a, const auto& b) {
-                return a.first->getOccupancyRatio() < b.first->getOccupancyRatio();
-            });
-        // Update traffic light states based on occupancy
-        for (auto& [lane, light] : lanes) {
-            if (lane == maxOccupancyLane->first) {
-                if (light->getState() != LightState::GREEN) {
-                    for (auto& [_, otherLight] : lanes) {
-                        if (otherLight != light && !otherLight->isInEmergencyMode()) {
-                            otherLight->setState(LightState::RED);
-                        }
-                    }
-                    if (!light->isInEmergencyMode()) {
-                        light->setState(LightState::YELLOW);
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-                        light->setState(LightState::GREEN);
-                        lastGreenTime[lane.get()] = now;
-                        auto occupancyRatio = lane->getOccupancyRatio();
-                        auto duration = std::chrono::seconds(
-                            static_cast<int>(30 + (occupancyRatio * 30))); // 30-60 seconds
-                        if (duration < std::chrono::seconds(4)) duration = std::chrono::seconds(4);
-                        light->setDuration(duration);
-                    }
-                }
+        chosen.control->lastGreen = now;
+        // Adjust duration based on occupancy
+        light->setDuration(greedyGreenDuration(params, greenOccupancy(params, *chosen.lane)));
+    }
+}
+
+void Intersection::optimizeWithHorizon(const Configuration& current, Clock::time_point now) {
+    const auto& lanes = current.lanes;
+    const ControllerParams& params = current.params;
+
+    // Queues now, with the measured arrival and discharge rates
+    plannerLanes.resize(lanes.size());
+    int currentGreen = -1;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        auto statistics = lanes[i].lane->getStatistics().snapshot();
+        plannerLanes[i].queue = lanes[i].lane->getVehicleCount();
+        plannerLanes[i].arrivalRate = statistics.arrivalRate;
+        plannerLanes[i].dischargeRate = std::max(statistics.dischargeRate, params.saturationFlow);
+        if (lanes[i].light->getState() == LightState::GREEN) {
+            currentGreen = static_cast<int>(i);
+            plannerLanes[i].weight = 1.0;
+        } else {
+            double red = std::chrono::duration<double>(now - lanes[i].control->lastGreen).count();
+            plannerLanes[i].weight = 1.0 + red / std::max(1.0, std::chrono::duration<double>(
+                params.waitWeightTime).count());
+        }
+    }
+    double elapsed = currentGreen >= 0
+        ? std::chrono::duration<double>(now - lanes[currentGreen].control->lastGreen).count() : 0.0;
+
+    HorizonSettings settings;
+    settings.steps = params.horizonSteps;
+    settings.stepSeconds = std::max(1.0, std::chrono::duration<double>(params.horizonStep).count());
+    settings.lostSeconds = std::chrono::duration<double>(params.yellow + params.startupLostTime).count();
+    settings.minGreenSeconds = std::chrono::duration<double>(params.minGreen).count();
+    settings.budget = params.planningBudget;
+    lastPlan = planner.plan(plannerLanes, currentGreen, elapsed, settings);
+
+    int next = lastPlan.firstPhase();
+    if (next < 0) {
+        return;
+    }
+    // The green lasts until the plan would switch; the controller wakes then
+    // and plans again
+    auto run = std::chrono::seconds(static_cast<int>(std::ceil(lastPlan.firstRun() * settings.stepSeconds)));
+    const LaneEntry& chosen = lanes[next];
+    if (next == currentGreen) {
+        chosen.light->setDuration(std::chrono::seconds(static_cast<int>(std::ceil(elapsed))) + run);
+        return;
+    }
+
+    for (const auto& entry : lanes) {
+        if (entry.light != chosen.light && !entry.light->isInEmergencyMode()) {
+            entry.light->setState(LightState::RED);
+        }
+    }
+    if (!chosen.light->isInEmergencyMode()) {
+        chosen.light->setState(LightState::YELLOW);
+        current.clock->sleepFor(params.yellow);
+        chosen.light->setState(LightState::GREEN);
+        chosen.control->lastGreen = now;
+        chosen.light->setDuration(std::max(run, std::chrono::seconds(4)));
+    }
+}
+
+Clock::duration Intersection::intoCycle(const CoordinationPlan& plan, Clock::time_point now) {
+    Clock::duration cycle = plan.cycle;
+    Clock::duration position = (now - plan.epoch - plan.offset) % cycle;
+    return position < Clock::duration::zero() ? position + cycle : position;
+}
+
+bool Intersection::followCoordinationPlan(const Configuration& current, Clock::time_point now) {
+    const CoordinationPlan& plan = *current.coordination;
+    auto position = intoCycle(plan, now);
+    bool arterialPhase = position < plan.green;
+    auto remaining = (arterialPhase ? Clock::duration(plan.green) : Clock::duration(plan.cycle)) - position;
+
+    // A lane the plan holds red that is about to spill back takes over
+    for (const auto& entry : current.lanes) {
+        if (entry.arterial != arterialPhase &&
+            decisionOccupancy(current.params, *entry.lane) >= plan.overrideOccupancy) {
+            return false;
+        }
+    }
+
+    bool transition = false;
+    for (const auto& entry : current.lanes) {
+        if (entry.light->isInEmergencyMode()) {
+            continue;
+        }
+        if (entry.arterial != arterialPhase) {
+            entry.light->setState(LightState::RED);
+        } else if (entry.light->getState() != LightState::GREEN) {
+            entry.light->setState(LightState::YELLOW);
+            transition = true;
+        }
+    }
+    if (transition) {
+        current.clock->sleepFor(current.params.yellow);
+        for (const auto& entry : current.lanes) {
+            if (entry.arterial == arterialPhase && entry.light->getState() == LightState::YELLOW) {
+                entry.light->setState(LightState::GREEN);
+                entry.control->lastGreen = now;
             }
         }
     }
+    // Durations run to the end of the phase, so the controller sleeps until then
+    for (const auto& entry : current.lanes) {
+        if (entry.arterial == arterialPhase && entry.light->getState() == LightState::GREEN) {
+            entry.light->setDuration(std::chrono::ceil<std::chrono::seconds>(now - entry.control->lastGreen + remaining));
+        }
+    }
+    return true;
 }
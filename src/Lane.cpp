@@ -1,31 +1,64 @@
 #include "Lane.hpp"
+#include "ControllerWakeup.hpp"
+#include <algorithm>
+#include <cmath>
 
 Lane::Lane(const std::string& id, int capacity)
     : id(id)
     , vehicleCount(0)
     , capacity(capacity)
     , emergencyVehicle(EmergencyVehicleType::NONE)
+    , totalArrivals(0)
+    , totalDepartures(0)
+    , signalCount(capacity)
+    , wakeup(nullptr)
 {}
 
 void Lane::addVehicle() {
     std::lock_guard<std::mutex> lock(mutex);
-    if (vehicleCount < capacity) {
+    int before = vehicleCount.load();
+    if (before < capacity) {
         vehicleCount++;
+        totalArrivals++;
+        signalChange(before, before + 1);
     }
 }
 
 void Lane::removeVehicle() {
     std::lock_guard<std::mutex> lock(mutex);
-    if (vehicleCount > 0) {
+    int before = vehicleCount.load();
+    if (before > 0) {
         vehicleCount--;
+        totalDepartures++;
+        signalChange(before, before - 1);
     }
 }
 
+int Lane::addVehicles(int count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int before = vehicleCount.load();
+    int added = std::max(0, std::min(count, capacity - before));
+    vehicleCount += added;
+    totalArrivals += static_cast<uint64_t>(added);
+    signalChange(before, before + added);
+    return added;
+}
+
+int Lane::removeVehicles(int count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int before = vehicleCount.load();
+    int removed = std::max(0, std::min(count, before));
+    vehicleCount -= removed;
+    totalDepartures += static_cast<uint64_t>(removed);
+    signalChange(before, before - removed);
+    return removed;
+}
+
 int Lane::getVehicleCount() const {
     return vehicleCount.load();
 }
 
-std::string Lane::getId() const {
+const std::string& Lane::getId() const {
     return id;
 }
 
@@ -52,3 +85,43 @@ EmergencyVehicleType Lane::getEmergencyVehicleType() const {
 bool Lane::hasEmergencyVehicle() const {
     return emergencyVehicle.load() != EmergencyVehicleType::NONE;
 }
+
+void Lane::sampleStatistics(std::chrono::steady_clock::time_point now) {
+    statistics.update(now, getOccupancyRatio(), totalArrivals.load(), totalDepartures.load());
+}
+
+const LaneStatistics& Lane::getStatistics() const {
+    return statistics;
+}
+
+double Lane::predictedDemand(std::chrono::duration<double> horizon) const {
+    double demand = getVehicleCount() + statistics.arrivalRate() * horizon.count();
+    return demand < capacity ? demand : capacity;
+}
+
+void Lane::attachWakeup(std::shared_ptr<ControllerWakeup> newWakeup) {
+    std::lock_guard<std::mutex> lock(mutex);
+    wakeup.store(newWakeup.get(), std::memory_order_release);
+    wakeupOwner = std::move(newWakeup);
+}
+
+void Lane::setSignalLevel(double fraction) {
+    int level = static_cast<int>(std::ceil(fraction * capacity - 1e-9));
+    signalCount.store(std::max(1, std::min(level, capacity)));
+}
+
+void Lane::signalChange(int before, int after) {
+    ControllerWakeup* target = wakeup.load(std::memory_order_acquire);
+    if (!target || before == after) {
+        return;
+    }
+    int level = signalCount.load(std::memory_order_relaxed);
+    bool crossed = (before == 0) != (after == 0)
+                || (before >= capacity) != (after >= capacity)
+                || (before >= level) != (after >= level);
+    if (crossed) {
+        target->notifyUrgent();
+    } else {
+        target->markActivity();
+    }
+}
@@ -0,0 +1,196 @@
+#include "LaneStatistics.hpp"
+#include <algorithm>
+#include <cmath>
+
+P2Quantile::P2Quantile(double quantile)
+    : p(quantile)
+    , samples(0)
+    , heights{}
+    , positions{1, 2, 3, 4, 5}
+    , desired{1, 1 + 2 * quantile, 1 + 4 * quantile, 3 + 2 * quantile, 5}
+    , increments{0, quantile / 2, quantile, (1 + quantile) / 2, 1}
+{}
+
+void P2Quantile::add(double value) {
+    if (samples < 5) {
+        heights[samples++] = value;
+        if (samples == 5) {
+            std::sort(heights.begin(), heights.end());
+        }
+        return;
+    }
+
+    int cell;
+    if (value < heights[0]) {
+        heights[0] = value;
+        cell = 0;
+    } else if (value >= heights[4]) {
+        heights[4] = value;
+        cell = 3;
+    } else {
+        cell = 0;
+        while (cell < 3 && value >= heights[cell + 1]) {
+            ++cell;
+        }
+    }
+    for (int i = cell + 1; i < 5; ++i) {
+        positions[i] += 1;
+    }
+    for (int i = 0; i < 5; ++i) {
+        desired[i] += increments[i];
+    }
+    ++samples;
+
+    // Move the middle markers towards their desired positions
+    for (int i = 1; i <= 3; ++i) {
+        double offset = desired[i] - positions[i];
+        if ((offset >= 1 && positions[i + 1] - positions[i] > 1) ||
+            (offset <= -1 && positions[i - 1] - positions[i] < -1)) {
+            int d = offset > 0 ? 1 : -1;
+            double candidate = parabolic(i, d);
+            if (heights[i - 1] < candidate && candidate < heights[i + 1]) {
+                heights[i] = candidate;
+            } else {
+                heights[i] = linear(i, d);
+            }
+            positions[i] += d;
+        }
+    }
+}
+
+double P2Quantile::parabolic(int i, int d) const {
+    return heights[i] + d / (positions[i + 1] - positions[i - 1]) *
+        ((positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+         (positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+}
+
+double P2Quantile::linear(int i, int d) const {
+    return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+}
+
+double P2Quantile::value() const {
+    if (samples == 0) {
+        return 0.0;
+    }
+    if (samples < 5) {
+        std::array<double, 5> sorted = heights;
+        std::sort(sorted.begin(), sorted.begin() + samples);
+        auto index = static_cast<size_t>(std::lround(p * (samples - 1)));
+        return sorted[index];
+    }
+    return heights[2];
+}
+
+uint64_t P2Quantile::count() const {
+    return samples;
+}
+
+LaneStatistics::LaneStatistics()
+    : initialized(false)
+    , lastArrivals(0)
+    , lastDepartures(0)
+    , arrivalEwma(0.0)
+    , dischargeEwma(0.0)
+    , occupancyEwma(0.0)
+    , bucketMax{}
+    , currentBucket(0)
+    , p50(0.5)
+    , p90(0.9)
+    , p99(0.99)
+    , samples(0)
+    , sequence(0)
+    , publishedArrival(0.0)
+    , publishedDischarge(0.0)
+    , publishedOccupancy(0.0)
+    , publishedWindowMax(0.0)
+    , publishedP50(0.0)
+    , publishedP90(0.0)
+    , publishedP99(0.0)
+    , publishedSamples(0)
+{}
+
+void LaneStatistics::update(time_point now, double occupancy, uint64_t arrivals, uint64_t departures) {
+    constexpr double bucketSeconds = kMaxWindowSeconds / kMaxBuckets;
+    double nowSeconds = std::chrono::duration<double>(now.time_since_epoch()).count();
+    auto bucket = static_cast<int64_t>(std::floor(nowSeconds / bucketSeconds));
+
+    if (!initialized) {
+        initialized = true;
+        occupancyEwma = occupancy;
+        bucketMax.fill(occupancy);
+        currentBucket = bucket;
+    } else {
+        double dt = std::chrono::duration<double>(now - lastSample).count();
+        if (dt > 0.0) {
+            double rateAlpha = 1.0 - std::exp(-dt / kRateTimeConstant);
+            double occupancyAlpha = 1.0 - std::exp(-dt / kOccupancyTimeConstant);
+            arrivalEwma += rateAlpha * ((arrivals - lastArrivals) / dt - arrivalEwma);
+            dischargeEwma += rateAlpha * ((departures - lastDepartures) / dt - dischargeEwma);
+            occupancyEwma += occupancyAlpha * (occupancy - occupancyEwma);
+        }
+
+        // Clear the buckets that have rotated out of the window
+        for (int64_t b = currentBucket + 1; b <= bucket && b <= currentBucket + kMaxBuckets; ++b) {
+            bucketMax[static_cast<size_t>(b % kMaxBuckets)] = occupancy;
+        }
+        currentBucket = std::max(currentBucket, bucket);
+        auto& slot = bucketMax[static_cast<size_t>(currentBucket % kMaxBuckets)];
+        slot = std::max(slot, occupancy);
+    }
+
+    lastSample = now;
+    lastArrivals = arrivals;
+    lastDepartures = departures;
+    p50.add(occupancy);
+    p90.add(occupancy);
+    p99.add(occupancy);
+    ++samples;
+    publish();
+}
+
+void LaneStatistics::publish() {
+    uint64_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    publishedArrival.store(arrivalEwma, std::memory_order_relaxed);
+    publishedDischarge.store(dischargeEwma, std::memory_order_relaxed);
+    publishedOccupancy.store(occupancyEwma, std::memory_order_relaxed);
+    publishedWindowMax.store(*std::max_element(bucketMax.begin(), bucketMax.end()), std::memory_order_relaxed);
+    publishedP50.store(p50.value(), std::memory_order_relaxed);
+    publishedP90.store(p90.value(), std::memory_order_relaxed);
+    publishedP99.store(p99.value(), std::memory_order_relaxed);
+    publishedSamples.store(samples, std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+LaneStatisticsSnapshot LaneStatistics::snapshot() const {
+    LaneStatisticsSnapshot result;
+    uint64_t before;
+    uint64_t after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        result.arrivalRate = publishedArrival.load(std::memory_order_relaxed);
+        result.dischargeRate = publishedDischarge.load(std::memory_order_relaxed);
+        result.smoothedOccupancy = publishedOccupancy.load(std::memory_order_relaxed);
+        result.windowMaxOccupancy = publishedWindowMax.load(std::memory_order_relaxed);
+        result.occupancyP50 = publishedP50.load(std::memory_order_relaxed);
+        result.occupancyP90 = publishedP90.load(std::memory_order_relaxed);
+        result.occupancyP99 = publishedP99.load(std::memory_order_relaxed);
+        result.samples = publishedSamples.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1));
+    return result;
+}
+
+double LaneStatistics::smoothedOccupancy() const {
+    return publishedOccupancy.load(std::memory_order_relaxed);
+}
+
+double LaneStatistics::arrivalRate() const {
+    return publishedArrival.load(std::memory_order_relaxed);
+}
+
+uint64_t LaneStatistics::sampleCount() const {
+    return publishedSamples.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,151 @@
+#include "PolicySweep.hpp"
+#include "ScenarioEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+std::vector<ControllerParams> ParameterGrid::expand() const {
+    std::vector<ControllerParams> points;
+    for (auto policy : policies)
+    for (double threshold : saturationThresholds)
+    for (auto minGreen : minGreens)
+    for (auto baseGreen : baseGreens)
+    for (auto greenRange : greenRanges)
+    for (auto emergencyGreen : emergencyGreens)
+    for (auto yellow : yellows) {
+        ControllerParams params;
+        params.policy = policy;
+        params.saturationThreshold = threshold;
+        params.minGreen = minGreen;
+        params.baseGreen = baseGreen;
+        params.greenRange = greenRange;
+        params.emergencyGreen = emergencyGreen;
+        params.yellow = yellow;
+        points.push_back(params);
+    }
+    return points;
+}
+
+PolicySweep::PolicySweep(const Scenario& scenario, unsigned threads)
+    : scenario(scenario)
+    , threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+void PolicySweep::setWeights(const SweepWeights& newWeights) {
+    weights = newWeights;
+}
+
+namespace {
+
+struct PointAccumulator {
+    size_t runs = 0;
+    double delaySum = 0.0;
+    double starvationSum = 0.0;
+    double maxStarvation = 0.0;
+    double latencySum = 0.0;
+    uint64_t emergenciesServed = 0;
+    uint64_t emergenciesMissed = 0;
+    double maxLatency = 0.0;
+
+    void add(const ScenarioResult& result) {
+        runs++;
+        delaySum += result.meanDelay;
+        starvationSum += result.maxStarvation;
+        maxStarvation = std::max(maxStarvation, result.maxStarvation);
+        latencySum += result.meanPreemptionLatency * result.emergenciesServed;
+        emergenciesServed += result.emergenciesServed;
+        emergenciesMissed += result.emergencies - result.emergenciesServed;
+        maxLatency = std::max(maxLatency, result.maxPreemptionLatency);
+    }
+
+    void merge(const PointAccumulator& other) {
+        runs += other.runs;
+        delaySum += other.delaySum;
+        starvationSum += other.starvationSum;
+        maxStarvation = std::max(maxStarvation, other.maxStarvation);
+        latencySum += other.latencySum;
+        emergenciesServed += other.emergenciesServed;
+        emergenciesMissed += other.emergenciesMissed;
+        maxLatency = std::max(maxLatency, other.maxLatency);
+    }
+};
+
+} // namespace
+
+std::vector<SweepPointResult> PolicySweep::run(const std::vector<ControllerParams>& points,
+                                               size_t runsPerPoint, uint64_t baseSeed) const {
+    std::vector<PointAccumulator> totals(points.size());
+    std::mutex totalsMutex;
+    const size_t tasks = points.size() * runsPerPoint;
+    std::atomic<size_t> next{0};
+    ScenarioEngine engine(1);
+    std::exception_ptr failure;
+
+    // Each worker accumulates locally and merges once, so runs never contend.
+    // The first failure stops handing out tasks and is rethrown once every
+    // thread has been joined.
+    auto worker = [&]() {
+        std::vector<PointAccumulator> local(points.size());
+        try {
+            for (size_t task = next++; task < tasks; task = next++) {
+                size_t point = task / runsPerPoint;
+                uint64_t seed = baseSeed + task % runsPerPoint;
+                local[point].add(engine.run(scenario, seed, points[point]));
+            }
+        } catch (...) {
+            next = tasks;
+            std::lock_guard<std::mutex> lock(totalsMutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        for (size_t i = 0; i < points.size(); ++i) {
+            totals[i].merge(local[i]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    unsigned count = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(tasks, 1)));
+    for (unsigned i = 1; i < count; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    std::vector<SweepPointResult> results;
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto& total = totals[i];
+        SweepPointResult result;
+        result.params = points[i];
+        result.runs = total.runs;
+        if (total.runs > 0) {
+            result.meanDelay = total.delaySum / total.runs;
+            result.meanStarvation = total.starvationSum / total.runs;
+        }
+        result.maxStarvation = total.maxStarvation;
+        if (total.emergenciesServed > 0) {
+            result.meanEmergencyLatency = total.latencySum / total.emergenciesServed;
+        }
+        result.maxEmergencyLatency = total.maxLatency;
+        result.emergenciesMissed = total.emergenciesMissed;
+        result.score = weights.delay * result.meanDelay
+                     + weights.starvation * result.meanStarvation
+                     + weights.emergencyLatency * result.meanEmergencyLatency;
+        if (total.runs > 0) {
+            result.score += weights.missedEmergency * static_cast<double>(total.emergenciesMissed) / total.runs;
+        }
+        results.push_back(result);
+    }
+    std::stable_sort(results.begin(), results.end(),
+        [](const SweepPointResult& a, const SweepPointResult& b) { return a.score < b.score; });
+    return results;
+}
@@ -0,0 +1,233 @@
+#include "Scenario.hpp"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+class ScenarioParser {
+public:
+    ScenarioParser(const std::string& sourceName)
+        : sourceName(sourceName)
+        , lineNumber(0)
+    {}
+
+    std::vector<Scenario> parse(std::istream& input) {
+        std::string line;
+        while (std::getline(input, line)) {
+            ++lineNumber;
+            auto comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            std::istringstream tokens(line);
+            std::vector<std::string> words;
+            for (std::string word; tokens >> word;) {
+                words.push_back(word);
+            }
+            if (!words.empty()) {
+                parseLine(words);
+            }
+        }
+        for (const auto& scenario : scenarios) {
+            if (scenario.lanes.empty()) {
+                fail("scenario '" + scenario.name + "' has no lanes");
+            }
+        }
+        return scenarios;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error(sourceName + ":" + std::to_string(lineNumber) + ": " + message);
+    }
+
+    Scenario& current() {
+        if (scenarios.empty()) {
+            fail("expected 'scenario NAME' first");
+        }
+        return scenarios.back();
+    }
+
+    double number(const std::string& text) const {
+        try {
+            size_t used = 0;
+            double value = std::stod(text, &used);
+            // stod accepts "inf" and "nan"; neither is a time or a rate
+            if (used == text.size() && std::isfinite(value) && value >= 0.0) {
+                return value;
+            }
+        } catch (const std::exception&) {
+        }
+        fail("expected a finite non-negative number, got '" + text + "'");
+    }
+
+    void range(const std::string& text, double& low, double& high) const {
+        auto dash = text.find('-', 1);
+        if (dash == std::string::npos) {
+            low = high = number(text);
+            return;
+        }
+        low = number(text.substr(0, dash));
+        high = number(text.substr(dash + 1));
+        if (high < low) {
+            fail("range '" + text + "' is reversed");
+        }
+    }
+
+    int laneIndex(const std::string& name) {
+        const auto& lanes = current().lanes;
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            if (lanes[i].name == name) {
+                return static_cast<int>(i);
+            }
+        }
+        fail("unknown lane '" + name + "'");
+    }
+
+    EmergencyVehicleType vehicleType(const std::string& text) const {
+        if (text == "police") return EmergencyVehicleType::POLICE;
+        if (text == "ambulance") return EmergencyVehicleType::AMBULANCE;
+        if (text == "fire" || text == "fire_truck") return EmergencyVehicleType::FIRE_TRUCK;
+        if (text == "random") return EmergencyVehicleType::NONE;
+        fail("unknown emergency vehicle type '" + text + "'");
+    }
+
+    const std::string& value(const std::vector<std::string>& words, size_t index) const {
+        if (index >= words.size()) {
+            fail("missing value after '" + words[index - 1] + "'");
+        }
+        return words[index];
+    }
+
+    void parseLine(const std::vector<std::string>& words) {
+        const std::string& keyword = words[0];
+        if (keyword == "scenario") {
+            scenarios.emplace_back();
+            scenarios.back().name = value(words, 1);
+        } else if (keyword == "seed") {
+            current().seed = static_cast<uint64_t>(number(value(words, 1)));
+        } else if (keyword == "duration") {
+            current().duration = number(value(words, 1));
+        } else if (keyword == "lane") {
+            ScenarioLane lane;
+            lane.name = value(words, 1);
+            lane.capacity = static_cast<int>(number(value(words, 2)));
+            if (lane.capacity <= 0) {
+                fail("lane capacity must be positive");
+            }
+            for (size_t i = 3; i < words.size(); i += 2) {
+                if (words[i] == "arrivals") lane.arrivalRate = number(value(words, i + 1));
+                else if (words[i] == "discharge") lane.dischargeRate = number(value(words, i + 1));
+                else fail("unknown lane option '" + words[i] + "'");
+            }
+            current().lanes.push_back(lane);
+        } else if (keyword == "emergency" || keyword == "pedestrian" || keyword == "demand") {
+            parseEvent(words);
+        } else {
+            fail("unknown keyword '" + keyword + "'");
+        }
+    }
+
+    void parseEvent(const std::vector<std::string>& words) {
+        ScenarioEvent event;
+        if (words[0] == "emergency") event.kind = ScenarioEvent::Kind::EMERGENCY;
+        else if (words[0] == "pedestrian") event.kind = ScenarioEvent::Kind::PEDESTRIAN;
+        else event.kind = ScenarioEvent::Kind::DEMAND;
+
+        bool timed = false;
+        bool hasDuration = false;
+        for (size_t i = 1; i < words.size(); i += 2) {
+            const std::string& option = words[i];
+            const std::string& argument = value(words, i + 1);
+            if (option == "at") {
+                event.start = number(argument);
+                timed = true;
+            } else if (option == "every") {
+                range(argument, event.intervalMin, event.intervalMax);
+                event.recurring = true;
+            } else if (option == "after") {
+                event.start = number(argument);
+            } else if (option == "for") {
+                range(argument, event.durationMin, event.durationMax);
+                hasDuration = true;
+            } else if (option == "lane") {
+                event.lane = laneIndex(argument);
+            } else if (option == "type" && event.kind == ScenarioEvent::Kind::EMERGENCY) {
+                event.vehicle = vehicleType(argument);
+            } else if (option == "arrivals" && event.kind == ScenarioEvent::Kind::DEMAND) {
+                event.arrivalRate = number(argument);
+            } else {
+                fail("unexpected '" + option + "' in " + words[0] + " event");
+            }
+        }
+
+        if (timed == event.recurring) {
+            fail(words[0] + " event needs exactly one of 'at' or 'every'");
+        }
+        if (event.kind == ScenarioEvent::Kind::DEMAND) {
+            if (event.recurring || event.lane < 0) {
+                fail("demand events need 'at' and 'lane'");
+            }
+        } else if (!hasDuration) {
+            fail(words[0] + " event needs 'for'");
+        }
+        current().events.push_back(event);
+    }
+
+    std::string sourceName;
+    size_t lineNumber;
+    std::vector<Scenario> scenarios;
+};
+
+} // namespace
+
+std::vector<Scenario> Scenario::parse(std::istream& input, const std::string& sourceName) {
+    ScenarioParser parser(sourceName);
+    return parser.parse(input);
+}
+
+std::vector<Scenario> Scenario::loadFile(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("cannot open scenario file " + path);
+    }
+    return parse(input, path);
+}
+
+Scenario Scenario::demo() {
+    Scenario scenario;
+    scenario.name = "demo";
+    scenario.seed = 0;
+    scenario.duration = 0.0; // runs until stopped
+    for (const char* name : {"North", "South", "East", "West"}) {
+        ScenarioLane lane;
+        lane.name = name;
+        lane.capacity = 15;
+        lane.arrivalRate = 2.8;
+        lane.dischargeRate = 1.2;
+        scenario.lanes.push_back(lane);
+    }
+
+    // Emergency vehicles every 15-45 s for 8-15 s on a random lane
+    ScenarioEvent emergency;
+    emergency.kind = ScenarioEvent::Kind::EMERGENCY;
+    emergency.recurring = true;
+    emergency.intervalMin = 15.0;
+    emergency.intervalMax = 45.0;
+    emergency.durationMin = 8.0;
+    emergency.durationMax = 15.0;
+    scenario.events.push_back(emergency);
+
+    // Pedestrians every 20-40 s, crossing for 5-10 s
+    ScenarioEvent pedestrian;
+    pedestrian.kind = ScenarioEvent::Kind::PEDESTRIAN;
+    pedestrian.recurring = true;
+    pedestrian.intervalMin = 20.0;
+    pedestrian.intervalMax = 40.0;
+    pedestrian.durationMin = 5.0;
+    pedestrian.durationMax = 10.0;
+    scenario.events.push_back(pedestrian);
+    return scenario;
+}
@@ -0,0 +1,306 @@
+#include "ScenarioEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+ScenarioSimulation::ScenarioSimulation(const Scenario& scenario, Intersection& intersection, uint64_t seed)
+    : scenario(scenario)
+    , intersection(intersection)
+    , rng(seed)
+{
+    for (size_t i = 0; i < intersection.getLaneCount(); ++i) {
+        lanes.push_back(intersection.getLane(i));
+        lights.push_back(intersection.getLight(i));
+    }
+    for (const auto& lane : scenario.lanes) {
+        arrivalRates.push_back(lane.arrivalRate);
+    }
+    arrivalRates.resize(lanes.size(), 0.0);
+    activeEmergencies.assign(lanes.size(), 0);
+    lastServed.assign(lanes.size(), 0.0);
+
+    stats.name = scenario.name;
+    stats.seed = seed;
+
+    for (size_t i = 0; i < scenario.events.size(); ++i) {
+        const auto& event = scenario.events[i];
+        if (event.recurring) {
+            scheduleOccurrence(i, event.start);
+        } else if (event.kind == ScenarioEvent::Kind::DEMAND) {
+            schedule(event.start, ActionType::DEMAND, i, event.lane);
+        } else {
+            schedule(event.start, event.kind == ScenarioEvent::Kind::EMERGENCY
+                         ? ActionType::EMERGENCY_ON : ActionType::PEDESTRIAN_ON, i);
+        }
+    }
+}
+
+std::shared_ptr<Intersection> ScenarioSimulation::buildIntersection(const Scenario& scenario) {
+    auto intersection = std::make_shared<Intersection>(scenario.name);
+    for (const auto& lane : scenario.lanes) {
+        intersection->addLane(std::make_shared<Lane>(lane.name, lane.capacity),
+                              std::make_shared<TrafficLight>(lane.name + " Light"));
+    }
+    return intersection;
+}
+
+void ScenarioSimulation::schedule(double time, ActionType type, size_t event, int lane,
+                                  EmergencyVehicleType vehicle) {
+    actions.push(Action{time, nextSequence++, type, event, lane, vehicle});
+}
+
+void ScenarioSimulation::scheduleOccurrence(size_t event, double after) {
+    const auto& spec = scenario.events[event];
+    schedule(after + uniform(spec.intervalMin, spec.intervalMax),
+             spec.kind == ScenarioEvent::Kind::EMERGENCY ? ActionType::EMERGENCY_ON : ActionType::PEDESTRIAN_ON,
+             event);
+}
+
+double ScenarioSimulation::uniform(double low, double high) {
+    if (high <= low) {
+        return low;
+    }
+    return std::uniform_real_distribution<double>(low, high)(rng);
+}
+
+int ScenarioSimulation::sampleCount(double rate, double dt) {
+    double expected = rate * dt;
+    int count = static_cast<int>(expected);
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < expected - count) {
+        ++count;
+    }
+    return count;
+}
+
+void ScenarioSimulation::apply(const Action& action) {
+    const auto& event = scenario.events[action.event];
+    switch (action.type) {
+        case ActionType::EMERGENCY_ON: {
+            int lane = event.lane >= 0 ? event.lane
+                : std::uniform_int_distribution<int>(0, static_cast<int>(lanes.size()) - 1)(rng);
+            EmergencyVehicleType vehicle = event.vehicle;
+            if (vehicle == EmergencyVehicleType::NONE) {
+                static const EmergencyVehicleType kTypes[] = {
+                    EmergencyVehicleType::POLICE, EmergencyVehicleType::AMBULANCE, EmergencyVehicleType::FIRE_TRUCK};
+                vehicle = kTypes[std::uniform_int_distribution<int>(0, 2)(rng)];
+            }
+            double duration = uniform(event.durationMin, event.durationMax);
+            activeEmergencies[lane]++;
+            intersection.reportEmergencyVehicle(static_cast<size_t>(lane), vehicle);
+            pendingPreemptions.push_back({lane, action.time});
+            stats.emergencies++;
+            schedule(action.time + duration, ActionType::EMERGENCY_OFF, action.event, lane, vehicle);
+            if (event.recurring) {
+                scheduleOccurrence(action.event, action.time + duration);
+            }
+            break;
+        }
+        case ActionType::EMERGENCY_OFF: {
+            int lane = action.lane;
+            if (--activeEmergencies[lane] == 0) {
+                intersection.clearEmergencyVehicle(static_cast<size_t>(lane));
+            }
+            // A vehicle that leaves before getting green counts with its full wait
+            for (auto it = pendingPreemptions.begin(); it != pendingPreemptions.end(); ++it) {
+                if (it->lane == lane) {
+                    stats.maxPreemptionLatency = std::max(stats.maxPreemptionLatency, action.time - it->reportedAt);
+                    pendingPreemptions.erase(it);
+                    break;
+                }
+            }
+            break;
+        }
+        case ActionType::PEDESTRIAN_ON: {
+            double duration = uniform(event.durationMin, event.durationMax);
+            if (activeCrossings++ == 0) {
+                intersection.requestPedestrianCrossing();
+            }
+            stats.pedestrianCrossings++;
+            schedule(action.time + duration, ActionType::PEDESTRIAN_OFF, action.event);
+            if (event.recurring) {
+                scheduleOccurrence(action.event, action.time + duration);
+            }
+            break;
+        }
+        case ActionType::PEDESTRIAN_OFF:
+            if (--activeCrossings == 0) {
+                intersection.clearPedestrianCrossing();
+            }
+            break;
+        case ActionType::DEMAND:
+            arrivalRates[action.lane] = event.arrivalRate;
+            break;
+    }
+}
+
+void ScenarioSimulation::tick(double now) {
+    while (!actions.empty() && actions.top().time <= now) {
+        Action action = actions.top();
+        actions.pop();
+        apply(action);
+    }
+
+    double dt = now - lastTick;
+    lastTick = now;
+    bool crossing = intersection.isPedestrianCrossingActive();
+    int total = 0;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        auto& lane = lanes[i];
+        for (int n = sampleCount(arrivalRates[i], dt); n > 0; --n) {
+            int before = lane->getVehicleCount();
+            lane->addVehicle();
+            stats.vehiclesArrived++;
+            if (lane->getVehicleCount() == before) {
+                stats.arrivalsBlocked++;
+            }
+        }
+        LightState state = lights[i]->getState();
+        if (state != LightState::RED && !crossing) {
+            double dischargeRate = i < scenario.lanes.size() ? scenario.lanes[i].dischargeRate : 1.0;
+            for (int n = sampleCount(dischargeRate, dt); n > 0 && lane->getVehicleCount() > 0; --n) {
+                lane->removeVehicle();
+                stats.vehiclesServed++;
+            }
+        }
+
+        int queue = lane->getVehicleCount();
+        total += queue;
+        stats.maxQueue = std::max(stats.maxQueue, queue);
+        if (queue == 0 || state == LightState::GREEN) {
+            lastServed[i] = now;
+        }
+        stats.maxStarvation = std::max(stats.maxStarvation, now - lastServed[i]);
+    }
+    queueIntegral += total * dt;
+    stats.simulatedSeconds = now;
+
+    for (auto it = pendingPreemptions.begin(); it != pendingPreemptions.end();) {
+        if (lights[it->lane]->getState() == LightState::GREEN) {
+            double latency = now - it->reportedAt;
+            latencySum += latency;
+            stats.emergenciesServed++;
+            stats.maxPreemptionLatency = std::max(stats.maxPreemptionLatency, latency);
+            it = pendingPreemptions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+ScenarioResult ScenarioSimulation::result() const {
+    ScenarioResult result = stats;
+    if (result.simulatedSeconds > 0.0) {
+        result.meanQueue = queueIntegral / result.simulatedSeconds;
+    }
+    if (result.vehiclesServed > 0) {
+        result.meanDelay = queueIntegral / static_cast<double>(result.vehiclesServed);
+    }
+    if (result.emergenciesServed > 0) {
+        result.meanPreemptionLatency = latencySum / result.emergenciesServed;
+    }
+    return result;
+}
+
+ScenarioEngine::ScenarioEngine(unsigned threads)
+    : threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+ScenarioResult ScenarioEngine::run(const Scenario& scenario) const {
+    return run(scenario, scenario.seed);
+}
+
+ScenarioResult ScenarioEngine::run(const Scenario& scenario, uint64_t seed) const {
+    return run(scenario, seed, ControllerParams());
+}
+
+ScenarioResult ScenarioEngine::run(const Scenario& scenario, uint64_t seed, const ControllerParams& params) const {
+    // Scenarios built in code skip the parser's checks
+    if (!std::isfinite(scenario.duration)) {
+        throw std::invalid_argument("scenario " + scenario.name + ": duration must be finite");
+    }
+    for (const auto& event : scenario.events) {
+        bool needsLane = event.kind != ScenarioEvent::Kind::PEDESTRIAN;
+        if (needsLane && (event.lane >= static_cast<int>(scenario.lanes.size()) ||
+                          (event.lane < 0 && scenario.lanes.empty()))) {
+            throw std::invalid_argument("scenario " + scenario.name + ": event refers to a lane it does not have");
+        }
+    }
+    auto intersection = ScenarioSimulation::buildIntersection(scenario);
+    auto clock = std::make_shared<ManualClock>();
+    intersection->setClock(clock);
+    intersection->setParams(params);
+
+    ScenarioSimulation simulation(scenario, *intersection, seed);
+    double duration = scenario.duration > 0.0 ? scenario.duration : kDefaultDuration;
+    auto ticks = static_cast<uint64_t>(std::ceil(duration / ScenarioSimulation::kTickSeconds));
+
+    // Two traffic ticks per 500 ms control tick, as in the live simulator
+    for (uint64_t tick = 1; tick <= ticks; ++tick) {
+        double now = tick * ScenarioSimulation::kTickSeconds;
+        clock->advanceTo(Clock::time_point(
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(now))));
+        simulation.tick(now);
+        if (tick % 2 == 0) {
+            intersection->step();
+        }
+    }
+    return simulation.result();
+}
+
+std::vector<ScenarioResult> ScenarioEngine::runAll(const std::vector<Scenario>& scenarios) const {
+    std::vector<ScenarioResult> results(scenarios.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < scenarios.size(); i = next++) {
+            // An exception escaping a worker thread would terminate the process
+            try {
+                results[i] = run(scenarios[i]);
+            } catch (const std::exception& failure) {
+                results[i] = ScenarioResult();
+                results[i].name = scenarios[i].name;
+                results[i].seed = scenarios[i].seed;
+                results[i].error = failure.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    unsigned count = std::min<unsigned>(threads, static_cast<unsigned>(scenarios.size()));
+    for (unsigned i = 1; i < count; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return results;
+}
+
+ScenarioSummary ScenarioEngine::summarize(const std::vector<ScenarioResult>& results) {
+    ScenarioSummary summary;
+    double latencySum = 0.0;
+    double delaySum = 0.0;
+    for (const auto& result : results) {
+        summary.scenarios++;
+        if (!result.error.empty()) {
+            summary.failed++;
+            continue;
+        }
+        summary.emergencies += result.emergencies;
+        summary.emergenciesServed += result.emergenciesServed;
+        latencySum += result.meanPreemptionLatency * result.emergenciesServed;
+        summary.maxPreemptionLatency = std::max(summary.maxPreemptionLatency, result.maxPreemptionLatency);
+        summary.maxQueue = std::max(summary.maxQueue, result.maxQueue);
+        delaySum += result.meanDelay;
+        summary.maxStarvation = std::max(summary.maxStarvation, result.maxStarvation);
+    }
+    if (summary.emergenciesServed > 0) {
+        summary.meanPreemptionLatency = latencySum / summary.emergenciesServed;
+    }
+    if (summary.scenarios > summary.failed) {
+        summary.meanDelay = delaySum / (summary.scenarios - summary.failed);
+    }
+    return summary;
+}
@@ -0,0 +1,296 @@
+#include "ShardedSimulation.hpp"
+#include "ShmRing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kChannelCapacity = 4096;
+using Channel = ShmRing<ShardMessage, kChannelCapacity>;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shard barrier needs lock-free atomics");
+
+// Generation-counting barrier shared by all worker processes
+struct SharedBarrier {
+    std::atomic<uint32_t> arrived{0};
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint32_t> aborted{0};
+    uint32_t parties = 0;
+
+    // Returns false if the run was aborted while waiting
+    bool arriveAndWait() {
+        uint32_t gen = generation.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+            arrived.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+        int spins = 0;
+        while (generation.load(std::memory_order_acquire) == gen) {
+            if (aborted.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            if (++spins > 64) {
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+};
+
+constexpr size_t alignUp(size_t value) {
+    return (value + 63) & ~static_cast<size_t>(63);
+}
+
+// Segment layout: barrier | stats[shards] | channels[shards * shards]
+struct SegmentLayout {
+    size_t statsOffset;
+    size_t channelsOffset;
+    size_t totalSize;
+
+    explicit SegmentLayout(uint32_t shards)
+        : statsOffset(alignUp(sizeof(SharedBarrier)))
+        , channelsOffset(alignUp(statsOffset + sizeof(ShardStats) * shards))
+        , totalSize(channelsOffset + sizeof(Channel) * shards * shards)
+    {}
+};
+
+SharedBarrier* barrierAt(void* segment) {
+    return static_cast<SharedBarrier*>(segment);
+}
+
+ShardStats* statsAt(void* segment, const SegmentLayout& layout, uint32_t shard) {
+    return reinterpret_cast<ShardStats*>(static_cast<char*>(segment) + layout.statsOffset) + shard;
+}
+
+// Channel carrying messages from shard `src` to shard `dst`
+Channel* channelAt(void* segment, const SegmentLayout& layout, uint32_t shards, uint32_t src, uint32_t dst) {
+    return reinterpret_cast<Channel*>(static_cast<char*>(segment) + layout.channelsOffset) + (src * shards + dst);
+}
+
+} // namespace
+
+ShardedSimulation::ShardedSimulation(uint32_t shardCount, ShardBuilder builder)
+    : shardCount(shardCount)
+    , builder(std::move(builder))
+    , stepPeriod(500)
+{
+    if (shardCount == 0) {
+        throw std::invalid_argument("ShardedSimulation needs at least one shard");
+    }
+}
+
+void ShardedSimulation::addLink(const ShardLink& link) {
+    if (link.from.shard >= shardCount || link.to.shard >= shardCount) {
+        throw std::out_of_range("ShardLink refers to an unknown shard");
+    }
+    links.push_back(link);
+}
+
+void ShardedSimulation::setStepPeriod(std::chrono::milliseconds period) {
+    stepPeriod = period;
+}
+
+uint32_t ShardedSimulation::getShardCount() const {
+    return shardCount;
+}
+
+std::vector<ShardStats> ShardedSimulation::run(uint64_t steps) {
+    SegmentLayout layout(shardCount);
+    void* segment = mmap(nullptr, layout.totalSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (segment == MAP_FAILED) {
+        throw std::runtime_error("ShardedSimulation: failed to map shared segment");
+    }
+
+    auto* barrier = new (segment) SharedBarrier();
+    barrier->parties = shardCount;
+    for (uint32_t shard = 0; shard < shardCount; ++shard) {
+        new (statsAt(segment, layout, shard)) ShardStats{};
+        for (uint32_t dst = 0; dst < shardCount; ++dst) {
+            new (channelAt(segment, layout, shardCount, shard, dst)) Channel();
+        }
+    }
+
+    std::vector<pid_t> workers;
+    for (uint32_t shard = 0; shard < shardCount; ++shard) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = 0;
+            try {
+                runShard(shard, steps, segment);
+            } catch (...) {
+                barrier->aborted.store(1);
+                status = 1;
+            }
+            _exit(status);
+        }
+        if (pid < 0) {
+            barrier->aborted.store(1);
+            break;
+        }
+        workers.push_back(pid);
+    }
+
+    // Reap workers in the order they exit, so the first one to die releases
+    // the others from the barrier rather than waiting behind a blocked shard
+    bool failed = workers.size() != shardCount;
+    size_t running = workers.size();
+    while (running > 0) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            barrier->aborted.store(1);
+            failed = true;
+            break;
+        }
+        if (std::find(workers.begin(), workers.end(), pid) == workers.end()) {
+            continue;
+        }
+        --running;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            barrier->aborted.store(1);
+            failed = true;
+        }
+    }
+
+    std::vector<ShardStats> result;
+    for (uint32_t shard = 0; shard < shardCount; ++shard) {
+        result.push_back(*statsAt(segment, layout, shard));
+    }
+    munmap(segment, layout.totalSize);
+
+    if (failed) {
+        throw std::runtime_error("ShardedSimulation: a shard worker failed");
+    }
+    return result;
+}
+
+void ShardedSimulation::runShard(uint32_t shard, uint64_t steps, void* segment) {
+    SegmentLayout layout(shardCount);
+    SharedBarrier* barrier = barrierAt(segment);
+    ShardStats& stats = *statsAt(segment, layout, shard);
+
+    std::vector<std::shared_ptr<Intersection>> intersections = builder(shard);
+    std::vector<std::shared_ptr<ManualClock>> clocks;
+    for (auto& intersection : intersections) {
+        clocks.push_back(std::make_shared<ManualClock>());
+        intersection->setClock(clocks.back());
+    }
+
+    auto hasLane = [&](const LaneAddress& address) {
+        return address.intersection < intersections.size() &&
+               address.lane < intersections[address.intersection]->getLaneCount();
+    };
+    // Each shard checks the endpoints it owns, so a bad link fails the run
+    // instead of losing vehicles on the receiving side
+    std::vector<ShardLink> outbound;
+    for (const auto& link : links) {
+        if (link.to.shard == shard && !hasLane(link.to)) {
+            throw std::out_of_range("ShardLink destination lane does not exist");
+        }
+        if (link.from.shard == shard) {
+            if (!hasLane(link.from)) {
+                throw std::out_of_range("ShardLink source lane does not exist");
+            }
+            outbound.push_back(link);
+        }
+    }
+
+    auto stepTime = Clock::time_point();
+    for (uint64_t stepIndex = 0; stepIndex < steps; ++stepIndex) {
+        // Apply everything the other shards sent during the previous step
+        for (uint32_t src = 0; src < shardCount; ++src) {
+            Channel* channel = channelAt(segment, layout, shardCount, src, shard);
+            ShardMessage message;
+            while (channel->tryPop(message)) {
+                if (message.intersection >= intersections.size() ||
+                    !intersections[message.intersection]->getLane(message.lane)) {
+                    stats.messagesUndeliverable++;
+                    continue;
+                }
+                auto& intersection = intersections[message.intersection];
+                auto lane = intersection->getLane(message.lane);
+                if (message.kind == ShardMessage::Kind::VEHICLE_HANDOFF) {
+                    int before = lane->getVehicleCount();
+                    lane->addVehicle();
+                    if (lane->getVehicleCount() == before) {
+                        stats.handoffsRejected++;
+                    }
+                    stats.handoffsReceived++;
+                } else {
+                    intersection->reportEmergencyVehicle(static_cast<size_t>(message.lane), message.type);
+                }
+            }
+        }
+
+        stepTime += stepPeriod;
+        for (size_t i = 0; i < intersections.size(); ++i) {
+            clocks[i]->advanceTo(stepTime);
+            intersections[i]->step();
+        }
+
+        // Discharge linked approaches that currently have right of way
+        for (const auto& link : outbound) {
+            auto& intersection = intersections[link.from.intersection];
+            auto lane = intersection->getLane(link.from.lane);
+            auto light = intersection->getLight(link.from.lane);
+            if (light->getState() == LightState::RED) {
+                continue;
+            }
+            Channel* channel = channelAt(segment, layout, shardCount, shard, link.to.shard);
+            if (lane->hasEmergencyVehicle() && light->getState() == LightState::GREEN) {
+                ShardMessage notice{ShardMessage::Kind::EMERGENCY_REPORT, lane->getEmergencyVehicleType(),
+                                    link.to.intersection, link.to.lane};
+                if (channel->tryPush(notice)) {
+                    intersection->clearEmergencyVehicle(static_cast<size_t>(link.from.lane));
+                    stats.emergenciesForwarded++;
+                }
+            }
+            if (lane->getVehicleCount() > 0) {
+                ShardMessage handoff{ShardMessage::Kind::VEHICLE_HANDOFF, EmergencyVehicleType::NONE,
+                                     link.to.intersection, link.to.lane};
+                if (channel->tryPush(handoff)) {
+                    lane->removeVehicle();
+                    stats.handoffsSent++;
+                } else {
+                    stats.handoffsDeferred++;
+                }
+            }
+        }
+
+        stats.stepsCompleted = stepIndex + 1;
+        if (!barrier->arriveAndWait()) {
+            throw std::runtime_error("ShardedSimulation aborted");
+        }
+    }
+
+    // Messages sent during the final step are still counted as in flight
+    int64_t vehicles = 0;
+    for (auto& intersection : intersections) {
+        for (size_t i = 0; i < intersection->getLaneCount(); ++i) {
+            vehicles += intersection->getLane(i)->getVehicleCount();
+        }
+    }
+    for (uint32_t src = 0; src < shardCount; ++src) {
+        Channel* channel = channelAt(segment, layout, shardCount, src, shard);
+        ShardMessage message;
+        while (channel->tryPop(message)) {
+            if (message.kind == ShardMessage::Kind::VEHICLE_HANDOFF) {
+                stats.handoffsReceived++;
+                vehicles++;
+            }
+        }
+    }
+    stats.vehiclesInShard = vehicles;
+}
@@ -0,0 +1,168 @@
+#include "SignalEvents.hpp"
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+Subscription::Subscription(const SubscriptionOptions& options)
+    : options(options)
+    , queue(std::max<size_t>(options.capacity, 2))
+    , droppedCount(0)
+    , deliveredCount(0)
+    , active(true)
+    , waiters(0)
+{}
+
+bool Subscription::tryPop(SignalEvent& event) {
+    return queue.tryPop(event);
+}
+
+bool Subscription::waitPop(SignalEvent& event, std::chrono::milliseconds timeout) {
+    if (queue.tryPop(event)) {
+        return true;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(waitMutex);
+    waiters.fetch_add(1);
+    // Pairs with the fence in wake(): either the publisher sees this waiter or
+    // the pop below sees its event
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    ready.wait_until(lock, deadline, [&] {
+        popped = queue.tryPop(event);
+        return popped || !active.load(std::memory_order_relaxed);
+    });
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    return popped;
+}
+
+uint64_t Subscription::dropped() const {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+uint64_t Subscription::delivered() const {
+    return deliveredCount.load(std::memory_order_relaxed);
+}
+
+bool Subscription::isActive() const {
+    return active.load(std::memory_order_relaxed);
+}
+
+bool Subscription::wants(const SignalEvent& event) const {
+    return (options.light == SignalEvent::kIntersectionWide || options.light == event.light) &&
+           (options.source == SignalEvent::kIntersectionWide || options.source == event.source);
+}
+
+void Subscription::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) != 0) {
+        // Taking the mutex orders the notify after the waiter's predicate check
+        std::lock_guard<std::mutex> lock(waitMutex);
+        ready.notify_all();
+    }
+}
+
+void Subscription::offer(const SignalEvent& event) {
+    if (queue.tryPush(event)) {
+        deliveredCount.fetch_add(1, std::memory_order_relaxed);
+        wake();
+        return;
+    }
+
+    switch (options.overflow) {
+        case OverflowPolicy::DROP_NEWEST:
+            break;
+        case OverflowPolicy::DROP_OLDEST: {
+            // The consumer may race us for the freed slot, so retry a few times
+            SignalEvent discarded;
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                if (queue.tryPop(discarded)) {
+                    droppedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (queue.tryPush(event)) {
+                    deliveredCount.fetch_add(1, std::memory_order_relaxed);
+                    wake();
+                    return;
+                }
+            }
+            break;
+        }
+        case OverflowPolicy::BLOCK: {
+            auto deadline = std::chrono::steady_clock::now() + options.blockTimeout;
+            while (std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+                if (queue.tryPush(event)) {
+                    deliveredCount.fetch_add(1, std::memory_order_relaxed);
+                    wake();
+                    return;
+                }
+            }
+            break;
+        }
+    }
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+SignalEventHub::SignalEventHub()
+    : sequence(0)
+    , table(std::make_unique<Table>())
+{
+    setClock(Clock::steady());
+}
+
+void SignalEventHub::setClock(std::shared_ptr<Clock> newClock) {
+    // Returns once no publisher can still read the previous clock
+    table.update([&](Table& next) { next.clock = std::move(newClock); });
+}
+
+std::shared_ptr<Subscription> SignalEventHub::subscribe(const SubscriptionOptions& options) {
+    std::shared_ptr<Subscription> subscription;
+    table.update([&](Table& next) {
+        for (auto& slot : next.slots) {
+            if (!slot) {
+                subscription = std::make_shared<Subscription>(options);
+                slot = subscription;
+                return;
+            }
+        }
+    });
+    return subscription;
+}
+
+void SignalEventHub::unsubscribe(const std::shared_ptr<Subscription>& subscription) {
+    if (!subscription) {
+        return;
+    }
+    // Publishers that started on the old table finish with their own
+    // reference to it; later ones never see the subscription
+    table.update([&](Table& next) {
+        for (auto& slot : next.slots) {
+            if (slot == subscription) {
+                slot.reset();
+            }
+        }
+    });
+    subscription->active.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(subscription->waitMutex);
+    subscription->ready.notify_all();
+}
+
+void SignalEventHub::publish(SignalEvent::Kind kind, uint32_t light, LightState state,
+                             EmergencyVehicleType vehicle, std::chrono::seconds duration, uint32_t source) {
+    auto current = table.read();
+
+    SignalEvent event;
+    event.kind = kind;
+    event.light = light;
+    event.source = source;
+    event.state = state;
+    event.vehicle = vehicle;
+    event.duration = duration;
+    event.time = current->clock->now();
+    event.sequence = sequence.fetch_add(1, std::memory_order_relaxed);
+
+    for (const auto& subscription : current->slots) {
+        if (subscription && subscription->wants(event)) {
+            subscription->offer(event);
+        }
+    }
+}
@@ -0,0 +1,149 @@
+#include "SpatialIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+std::shared_ptr<const SpatialIndex> SpatialIndex::build(
+        const std::vector<std::shared_ptr<Intersection>>& source, double radius) {
+    if (!(radius > 0.0)) {
+        throw std::invalid_argument("SpatialIndex: radius must be positive");
+    }
+
+    std::shared_ptr<SpatialIndex> index(new SpatialIndex());
+    index->radius = radius;
+    index->cellSize = radius;
+    index->intersections = source;
+
+    index->approachStart.push_back(0);
+    for (const auto& intersection : source) {
+        Position location = intersection->getLocation();
+        index->locationX.push_back(location.x);
+        index->locationY.push_back(location.y);
+        for (size_t lane = 0; lane < intersection->getLaneCount(); ++lane) {
+            double heading = intersection->getApproachHeading(lane);
+            if (!std::isnan(heading)) {
+                index->approachHeading.push_back(heading);
+                index->approachLane.push_back(static_cast<uint32_t>(lane));
+            }
+        }
+        index->approachStart.push_back(static_cast<uint32_t>(index->approachHeading.size()));
+    }
+
+    if (source.empty()) {
+        index->columns = index->rows = 1;
+        index->cellStart.push_back(0);
+        return index;
+    }
+
+    auto [minX, maxX] = std::minmax_element(index->locationX.begin(), index->locationX.end());
+    auto [minY, maxY] = std::minmax_element(index->locationY.begin(), index->locationY.end());
+    index->minX = *minX - radius;
+    index->minY = *minY - radius;
+    double width = *maxX + radius - index->minX;
+    double height = *maxY + radius - index->minY;
+    if (!std::isfinite(width) || !std::isfinite(height)) {
+        throw std::invalid_argument("SpatialIndex: intersection locations must be finite");
+    }
+    // Cell keys pack the row and column into 32 bits each
+    if (width / radius >= 4294967295.0 || height / radius >= 4294967295.0) {
+        throw std::invalid_argument("SpatialIndex: network extent too large for the radius");
+    }
+    index->columns = static_cast<size_t>(width / radius) + 1;
+    index->rows = static_cast<size_t>(height / radius) + 1;
+
+    // Every (cell, intersection) pair the search radii cover, sorted by cell
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    for (size_t i = 0; i < source.size(); ++i) {
+        uint64_t first = index->cellOf(index->locationX[i] - radius, index->locationY[i] - radius);
+        uint64_t last = index->cellOf(index->locationX[i] + radius, index->locationY[i] + radius);
+        for (uint64_t row = first >> 32; row <= last >> 32; ++row) {
+            for (uint64_t column = first & 0xffffffffu; column <= (last & 0xffffffffu); ++column) {
+                entries.emplace_back(row << 32 | column, static_cast<uint32_t>(i));
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    index->candidates.reserve(entries.size());
+    for (const auto& [cell, i] : entries) {
+        if (index->cellKeys.empty() || index->cellKeys.back() != cell) {
+            index->cellKeys.push_back(cell);
+            index->cellStart.push_back(static_cast<uint32_t>(index->candidates.size()));
+        }
+        index->candidates.push_back(i);
+    }
+    index->cellStart.push_back(static_cast<uint32_t>(index->candidates.size()));
+    return index;
+}
+
+uint64_t SpatialIndex::cellOf(double x, double y) const {
+    double column = std::floor((x - minX) / cellSize);
+    double row = std::floor((y - minY) / cellSize);
+    column = std::min(std::max(column, 0.0), static_cast<double>(columns - 1));
+    row = std::min(std::max(row, 0.0), static_cast<double>(rows - 1));
+    return static_cast<uint64_t>(row) << 32 | static_cast<uint64_t>(column);
+}
+
+LaneMatch SpatialIndex::locate(const Position& position, double heading) const {
+    LaneMatch match;
+    if (position.x < minX || position.y < minY ||
+        position.x >= minX + columns * cellSize || position.y >= minY + rows * cellSize) {
+        return match;
+    }
+
+    bool hasHeading = !std::isnan(heading);
+    uint64_t key = cellOf(position.x, position.y);
+    auto occupied = std::lower_bound(cellKeys.begin(), cellKeys.end(), key);
+    if (occupied == cellKeys.end() || *occupied != key) {
+        return match;
+    }
+    size_t cell = static_cast<size_t>(occupied - cellKeys.begin());
+    double bestDistance = radius;
+    uint32_t best = UINT32_MAX;
+    for (uint32_t c = cellStart[cell]; c < cellStart[cell + 1]; ++c) {
+        uint32_t i = candidates[c];
+        double dx = locationX[i] - position.x;
+        double dy = locationY[i] - position.y;
+        double distance = std::sqrt(dx * dx + dy * dy);
+        if (distance > bestDistance) {
+            continue;
+        }
+        // A moving reporter is heading towards the intersection it will reach
+        if (hasHeading && distance > kStopLineDistance &&
+            headingDifference(heading, bearingBetween(position, {locationX[i], locationY[i]})) > 90.0) {
+            continue;
+        }
+        bestDistance = distance;
+        best = i;
+    }
+    if (best == UINT32_MAX) {
+        return match;
+    }
+
+    double travel = hasHeading ? heading : bearingBetween(position, {locationX[best], locationY[best]});
+    double bestError = kMaxHeadingError;
+    bool found = false;
+    for (uint32_t a = approachStart[best]; a < approachStart[best + 1]; ++a) {
+        double error = headingDifference(travel, approachHeading[a]);
+        if (error <= bestError) {
+            bestError = error;
+            match.lane = approachLane[a];
+            found = true;
+        }
+    }
+    if (!found) {
+        return match;
+    }
+    match.intersection = intersections[best].get();
+    match.intersectionIndex = best;
+    match.distance = bestDistance;
+    return match;
+}
+
+size_t SpatialIndex::intersectionCount() const {
+    return intersections.size();
+}
+
+size_t SpatialIndex::cellCount() const {
+    return cellKeys.size();
+}
@@ -0,0 +1,660 @@
+#include "TimeSeriesStore.hpp"
+#include "Intersection.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x31425354;  // "TSB1"
+constexpr size_t kRollupLevels = 3;
+constexpr RollupResolution kLevels[kRollupLevels] = {
+    RollupResolution::MINUTE, RollupResolution::QUARTER_HOUR, RollupResolution::HOUR};
+const char* const kRollupExtensions[kRollupLevels] = {".r1m", ".r15m", ".r1h"};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t count;
+    int64_t firstTime;
+    int64_t lastTime;
+    double minValue;
+    double maxValue;
+    double sum;
+    uint32_t timeBytes;
+    uint32_t valueBytes;
+};
+
+struct RollupRecord {
+    int64_t start;
+    uint32_t count;
+    uint32_t reserved;
+    double min;
+    double max;
+    double sum;
+};
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t getVarint(const uint8_t*& p) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= static_cast<uint64_t>(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint64_t>(*p++) << shift;
+    return value;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out), used(8) {}
+
+    void write(uint64_t bits, int count) {
+        while (count > 0) {
+            if (used == 8) {
+                out.push_back(0);
+                used = 0;
+            }
+            int take = std::min(count, 8 - used);
+            uint64_t chunk = (bits >> (count - take)) & ((1u << take) - 1);
+            out.back() |= static_cast<uint8_t>(chunk << (8 - used - take));
+            used += take;
+            count -= take;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    int used;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const uint8_t* data) : data(data), position(0) {}
+
+    uint64_t read(int count) {
+        uint64_t bits = 0;
+        while (count > 0) {
+            int offset = static_cast<int>(position & 7);
+            int take = std::min(count, 8 - offset);
+            uint64_t byte = data[position >> 3];
+            bits = (bits << take) | ((byte >> (8 - offset - take)) & ((1u << take) - 1));
+            position += static_cast<uint64_t>(take);
+            count -= take;
+        }
+        return bits;
+    }
+
+private:
+    const uint8_t* data;
+    uint64_t position;
+};
+
+uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bitsDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int leadingZeros(uint64_t value) {
+    return value ? __builtin_clzll(value) : 64;
+}
+
+int trailingZeros(uint64_t value) {
+    return value ? __builtin_ctzll(value) : 64;
+}
+
+// Timestamps: first value, first delta, then deltas of deltas, all zigzag varints
+void encodeTimes(const std::vector<TimeSeriesSample>& samples, std::vector<uint8_t>& out) {
+    int64_t previous = 0;
+    int64_t previousDelta = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        int64_t time = samples[i].time;
+        if (i == 0) {
+            putVarint(out, zigzag(time));
+        } else {
+            int64_t delta = time - previous;
+            putVarint(out, zigzag(i == 1 ? delta : delta - previousDelta));
+            previousDelta = delta;
+        }
+        previous = time;
+    }
+}
+
+// Values: Gorilla XOR encoding. A zero XOR costs one bit; otherwise the
+// meaningful bits are stored, reusing the previous leading/trailing window
+// when they fit in it.
+void encodeValues(const std::vector<TimeSeriesSample>& samples, std::vector<uint8_t>& out) {
+    BitWriter writer(out);
+    uint64_t previous = 0;
+    int previousLeading = -1;
+    int previousTrailing = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        uint64_t bits = doubleBits(samples[i].value);
+        if (i == 0) {
+            writer.write(bits, 64);
+            previous = bits;
+            continue;
+        }
+        uint64_t x = bits ^ previous;
+        previous = bits;
+        if (x == 0) {
+            writer.write(0, 1);
+            continue;
+        }
+        int leading = std::min(leadingZeros(x), 31);
+        int trailing = trailingZeros(x);
+        if (previousLeading >= 0 && leading >= previousLeading && trailing >= previousTrailing) {
+            writer.write(0b10, 2);
+            writer.write(x >> previousTrailing, 64 - previousLeading - previousTrailing);
+        } else {
+            int meaningful = 64 - leading - trailing;
+            writer.write(0b11, 2);
+            writer.write(static_cast<uint64_t>(leading), 5);
+            writer.write(static_cast<uint64_t>(meaningful - 1), 6);
+            writer.write(x >> trailing, meaningful);
+            previousLeading = leading;
+            previousTrailing = trailing;
+        }
+    }
+}
+
+// Decodes one block and appends the samples with t0 <= time < t1
+void decodeBlock(const uint8_t* block, int64_t t0, int64_t t1, std::vector<TimeSeriesSample>& out) {
+    BlockHeader header;
+    std::memcpy(&header, block, sizeof(header));
+    const uint8_t* times = block + sizeof(header);
+    BitReader values(times + header.timeBytes);
+
+    int64_t time = 0;
+    int64_t delta = 0;
+    uint64_t bits = 0;
+    int leading = 0;
+    int trailing = 0;
+    for (uint32_t i = 0; i < header.count; ++i) {
+        if (i == 0) {
+            time = unzigzag(getVarint(times));
+            bits = values.read(64);
+        } else {
+            int64_t encoded = unzigzag(getVarint(times));
+            delta = i == 1 ? encoded : delta + encoded;
+            time += delta;
+            if (values.read(1)) {
+                if (values.read(1)) {
+                    leading = static_cast<int>(values.read(5));
+                    int meaningful = static_cast<int>(values.read(6)) + 1;
+                    trailing = 64 - leading - meaningful;
+                }
+                bits ^= values.read(64 - leading - trailing) << trailing;
+            }
+        }
+        if (time >= t1) {
+            break;
+        }
+        if (time >= t0) {
+            out.push_back({time, bitsDouble(bits)});
+        }
+    }
+}
+
+int64_t floorToResolution(int64_t time, int64_t resolution) {
+    int64_t bucket = time / resolution;
+    if (time % resolution < 0) {
+        --bucket;
+    }
+    return bucket * resolution;
+}
+
+void appendToFile(const std::string& path, const void* data, size_t size) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("TimeSeriesStore: cannot open " + path + ": " + std::strerror(errno));
+    }
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("TimeSeriesStore: cannot write " + path + ": " + std::strerror(error));
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    ::close(fd);
+}
+
+// Read-only view of a file that only ever grows; remapped when it has
+class MappedFile {
+public:
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() { unmap(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* view(const std::string& path, size_t expectedSize) {
+        if (expectedSize == size) {
+            return data;
+        }
+        unmap();
+        if (expectedSize == 0) {
+            return nullptr;
+        }
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("TimeSeriesStore: cannot open " + path + ": " + std::strerror(errno));
+        }
+        void* mapped = ::mmap(nullptr, expectedSize, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("TimeSeriesStore: cannot map " + path);
+        }
+        data = static_cast<const uint8_t*>(mapped);
+        size = expectedSize;
+        return data;
+    }
+
+private:
+    void unmap() {
+        if (data) {
+            ::munmap(const_cast<uint8_t*>(data), size);
+        }
+        data = nullptr;
+        size = 0;
+    }
+
+    const uint8_t* data;
+    size_t size;
+};
+
+struct BlockEntry {
+    uint64_t offset;
+    int64_t firstTime;
+    int64_t lastTime;
+};
+
+struct OpenBucket {
+    bool active = false;
+    RollupBucket bucket{};
+};
+
+RollupBucket fromRecord(const uint8_t* data, uint64_t index) {
+    RollupRecord record;
+    std::memcpy(&record, data + index * sizeof(RollupRecord), sizeof(record));
+    return {record.start, record.count, record.min, record.max, record.sum};
+}
+
+} // namespace
+
+struct TimeSeriesStore::Series {
+    uint32_t id = 0;
+    std::string name;
+    std::string blockPath;
+    std::array<std::string, kRollupLevels> rollupPaths;
+
+    std::vector<BlockEntry> blocks;
+    uint64_t blockBytes = 0;
+    uint64_t storedSamples = 0;
+    std::vector<TimeSeriesSample> pending;
+    bool hasSamples = false;
+    int64_t lastTime = 0;
+
+    std::array<OpenBucket, kRollupLevels> open;
+    std::array<uint64_t, kRollupLevels> rollupRecords{};
+
+    // Remapped lazily by queries as the files grow
+    mutable MappedFile blockMap;
+    mutable std::array<MappedFile, kRollupLevels> rollupMaps;
+};
+
+TimeSeriesStore::TimeSeriesStore(const std::string& directory)
+    : directory(directory)
+{
+    std::filesystem::create_directories(directory);
+    loadCatalog();
+}
+
+TimeSeriesStore::~TimeSeriesStore() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nothing sensible to do with a write error during destruction
+    }
+}
+
+int64_t TimeSeriesStore::resolutionMillis(RollupResolution resolution) {
+    switch (resolution) {
+        case RollupResolution::MINUTE: return 60 * 1000;
+        case RollupResolution::QUARTER_HOUR: return 15 * 60 * 1000;
+        case RollupResolution::HOUR: return 60 * 60 * 1000;
+    }
+    return 60 * 1000;
+}
+
+void TimeSeriesStore::loadCatalog() {
+    std::ifstream catalog(directory + "/catalog");
+    uint32_t id;
+    while (catalog >> id) {
+        catalog.get();
+        std::string name;
+        std::getline(catalog, name);
+        openSeries(id, name);
+    }
+}
+
+void TimeSeriesStore::openSeries(uint32_t id, const std::string& name) {
+    auto created = std::make_unique<Series>();
+    Series& s = *created;
+    s.id = id;
+    s.name = name;
+    s.blockPath = directory + "/" + std::to_string(id) + ".blk";
+    for (size_t level = 0; level < kRollupLevels; ++level) {
+        s.rollupPaths[level] = directory + "/" + std::to_string(id) + kRollupExtensions[level];
+    }
+    s.pending.reserve(kBlockSamples);
+    series.emplace(name, std::move(created));
+
+    // Index the complete blocks; a torn tail from an interrupted write is cut off
+    struct stat info;
+    if (::stat(s.blockPath.c_str(), &info) == 0 && info.st_size > 0) {
+        auto fileSize = static_cast<uint64_t>(info.st_size);
+        const uint8_t* data = s.blockMap.view(s.blockPath, fileSize);
+        uint64_t offset = 0;
+        while (offset + sizeof(BlockHeader) <= fileSize) {
+            BlockHeader header;
+            std::memcpy(&header, data + offset, sizeof(header));
+            uint64_t end = offset + sizeof(header) + header.timeBytes + header.valueBytes;
+            if (header.magic != kBlockMagic || header.count == 0 || end > fileSize) {
+                break;
+            }
+            s.blocks.push_back({offset, header.firstTime, header.lastTime});
+            s.storedSamples += header.count;
+            s.hasSamples = true;
+            s.lastTime = header.lastTime;
+            offset = end;
+        }
+        s.blockBytes = offset;
+        if (offset != fileSize) {
+            s.blockMap.view(s.blockPath, 0);
+            if (::truncate(s.blockPath.c_str(), static_cast<off_t>(offset)) != 0) {
+                throw std::runtime_error("TimeSeriesStore: cannot repair " + s.blockPath);
+            }
+        }
+    }
+
+    for (size_t level = 0; level < kRollupLevels; ++level) {
+        if (::stat(s.rollupPaths[level].c_str(), &info) == 0) {
+            s.rollupRecords[level] = static_cast<uint64_t>(info.st_size) / sizeof(RollupRecord);
+            if (s.rollupRecords[level] * sizeof(RollupRecord) != static_cast<uint64_t>(info.st_size) &&
+                ::truncate(s.rollupPaths[level].c_str(),
+                           static_cast<off_t>(s.rollupRecords[level] * sizeof(RollupRecord))) != 0) {
+                throw std::runtime_error("TimeSeriesStore: cannot repair " + s.rollupPaths[level]);
+            }
+        }
+    }
+
+    // Open buckets are not persisted; rebuild them from the raw samples after
+    // the last closed bucket of each level
+    for (size_t level = 0; level < kRollupLevels; ++level) {
+        int64_t resolution = resolutionMillis(kLevels[level]);
+        int64_t from = std::numeric_limits<int64_t>::min();
+        if (s.rollupRecords[level] > 0) {
+            const uint8_t* data = s.rollupMaps[level].view(
+                s.rollupPaths[level], s.rollupRecords[level] * sizeof(RollupRecord));
+            from = fromRecord(data, s.rollupRecords[level] - 1).start + resolution;
+        }
+        std::vector<TimeSeriesSample> tail;
+        auto first = std::lower_bound(s.blocks.begin(), s.blocks.end(), from,
+            [](const BlockEntry& block, int64_t t) { return block.lastTime < t; });
+        const uint8_t* data = s.blockMap.view(s.blockPath, s.blockBytes);
+        for (auto it = first; it != s.blocks.end(); ++it) {
+            decodeBlock(data + it->offset, from, std::numeric_limits<int64_t>::max(), tail);
+        }
+        for (const auto& sample : tail) {
+            accumulate(s, level, sample.time, sample.value);
+        }
+    }
+}
+
+TimeSeriesStore::Series& TimeSeriesStore::seriesFor(const std::string& name) {
+    auto it = series.find(name);
+    if (it != series.end()) {
+        return *it->second;
+    }
+    if (name.empty() || name.find('\n') != std::string::npos) {
+        throw std::invalid_argument("TimeSeriesStore: invalid series name");
+    }
+    auto id = static_cast<uint32_t>(series.size());
+    std::string line = std::to_string(id) + " " + name + "\n";
+    appendToFile(directory + "/catalog", line.data(), line.size());
+    openSeries(id, name);
+    return *series.at(name);
+}
+
+const TimeSeriesStore::Series* TimeSeriesStore::findSeries(const std::string& name) const {
+    auto it = series.find(name);
+    return it == series.end() ? nullptr : it->second.get();
+}
+
+void TimeSeriesStore::append(const std::string& name, int64_t time, double value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Series& s = seriesFor(name);
+    if (s.hasSamples && time < s.lastTime) {
+        throw std::invalid_argument("TimeSeriesStore: samples for " + name + " must be in time order");
+    }
+
+    for (size_t level = 0; level < kRollupLevels; ++level) {
+        accumulate(s, level, time, value);
+    }
+
+    s.pending.push_back({time, value});
+    s.hasSamples = true;
+    s.lastTime = time;
+    if (s.pending.size() >= kBlockSamples) {
+        flushSeries(s);
+    }
+}
+
+void TimeSeriesStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : series) {
+        flushSeries(*entry.second);
+    }
+}
+
+void TimeSeriesStore::flushSeries(Series& s) {
+    if (s.pending.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> times;
+    std::vector<uint8_t> values;
+    encodeTimes(s.pending, times);
+    encodeValues(s.pending, values);
+
+    BlockHeader header{};
+    header.magic = kBlockMagic;
+    header.count = static_cast<uint32_t>(s.pending.size());
+    header.firstTime = s.pending.front().time;
+    header.lastTime = s.pending.back().time;
+    header.minValue = s.pending.front().value;
+    header.maxValue = s.pending.front().value;
+    for (const auto& sample : s.pending) {
+        header.minValue = std::min(header.minValue, sample.value);
+        header.maxValue = std::max(header.maxValue, sample.value);
+        header.sum += sample.value;
+    }
+    header.timeBytes = static_cast<uint32_t>(times.size());
+    header.valueBytes = static_cast<uint32_t>(values.size());
+
+    std::vector<uint8_t> block(sizeof(header));
+    std::memcpy(block.data(), &header, sizeof(header));
+    block.insert(block.end(), times.begin(), times.end());
+    block.insert(block.end(), values.begin(), values.end());
+    appendToFile(s.blockPath, block.data(), block.size());
+
+    s.blocks.push_back({s.blockBytes, header.firstTime, header.lastTime});
+    s.blockBytes += block.size();
+    s.storedSamples += header.count;
+    s.pending.clear();
+}
+
+// Adds a sample to the open bucket of one level, closing the previous bucket
+// when the sample starts a new one
+void TimeSeriesStore::accumulate(Series& s, size_t level, int64_t time, double value) {
+    int64_t start = floorToResolution(time, resolutionMillis(kLevels[level]));
+    OpenBucket& open = s.open[level];
+    if (open.active && open.bucket.start != start) {
+        writeRollup(s, level, open.bucket);
+        open.active = false;
+    }
+    if (!open.active) {
+        open.active = true;
+        open.bucket = {start, 0, value, value, 0.0};
+    }
+    open.bucket.count++;
+    open.bucket.min = std::min(open.bucket.min, value);
+    open.bucket.max = std::max(open.bucket.max, value);
+    open.bucket.sum += value;
+}
+
+void TimeSeriesStore::writeRollup(Series& s, size_t level, const RollupBucket& bucket) {
+    RollupRecord record{bucket.start, bucket.count, 0, bucket.min, bucket.max, bucket.sum};
+    appendToFile(s.rollupPaths[level], &record, sizeof(record));
+    s.rollupRecords[level]++;
+}
+
+std::vector<TimeSeriesSample> TimeSeriesStore::range(const std::string& name, int64_t t0, int64_t t1) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<TimeSeriesSample> out;
+    const Series* s = findSeries(name);
+    if (!s || t0 >= t1) {
+        return out;
+    }
+
+    auto first = std::lower_bound(s->blocks.begin(), s->blocks.end(), t0,
+        [](const BlockEntry& block, int64_t t) { return block.lastTime < t; });
+    if (first != s->blocks.end() && first->firstTime < t1) {
+        const uint8_t* data = s->blockMap.view(s->blockPath, s->blockBytes);
+        for (auto it = first; it != s->blocks.end() && it->firstTime < t1; ++it) {
+            decodeBlock(data + it->offset, t0, t1, out);
+        }
+    }
+    for (const auto& sample : s->pending) {
+        if (sample.time >= t1) {
+            break;
+        }
+        if (sample.time >= t0) {
+            out.push_back(sample);
+        }
+    }
+    return out;
+}
+
+std::vector<RollupBucket> TimeSeriesStore::rollup(const std::string& name, RollupResolution resolution,
+                                                  int64_t t0, int64_t t1) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<RollupBucket> out;
+    const Series* s = findSeries(name);
+    if (!s || t0 >= t1) {
+        return out;
+    }
+
+    size_t level = static_cast<size_t>(resolution);
+    uint64_t records = s->rollupRecords[level];
+    if (records > 0) {
+        const uint8_t* data = s->rollupMaps[level].view(s->rollupPaths[level], records * sizeof(RollupRecord));
+        uint64_t lo = 0;
+        uint64_t hi = records;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (fromRecord(data, mid).start < t0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (uint64_t i = lo; i < records; ++i) {
+            RollupBucket bucket = fromRecord(data, i);
+            if (bucket.start >= t1) {
+                break;
+            }
+            out.push_back(bucket);
+        }
+    }
+    const OpenBucket& open = s->open[level];
+    if (open.active && open.bucket.start >= t0 && open.bucket.start < t1) {
+        out.push_back(open.bucket);
+    }
+    return out;
+}
+
+std::vector<std::string> TimeSeriesStore::seriesNames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> names;
+    for (const auto& entry : series) {
+        names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+uint64_t TimeSeriesStore::sampleCount(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Series* s = findSeries(name);
+    return s ? s->storedSamples + s->pending.size() : 0;
+}
+
+uint64_t TimeSeriesStore::compressedBytes(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Series* s = findSeries(name);
+    return s ? s->blockBytes : 0;
+}
+
+void recordIntersectionHistory(TimeSeriesStore& store, const Intersection& intersection, int64_t time) {
+    const std::string& prefix = intersection.getId();
+    for (size_t i = 0; i < intersection.getLaneCount(); ++i) {
+        auto lane = intersection.getLane(i);
+        auto light = intersection.getLight(i);
+        if (lane) {
+            store.append(prefix + "/" + lane->getId() + "/occupancy", time, lane->getOccupancyRatio());
+        }
+        if (light) {
+            store.append(prefix + "/" + light->getId() + "/state", time,
+                         static_cast<double>(static_cast<int>(light->getState())));
+        }
+    }
+}
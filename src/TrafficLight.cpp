@@ -1,28 +1,53 @@
 #include "TrafficLight.hpp"
+#include "SignalEvents.hpp"
+
+namespace {
+std::atomic<uint32_t> nextKey{0};
+}
 
 TrafficLight::TrafficLight(const std::string& id)
     : id(id)
+    , key(nextKey.fetch_add(1, std::memory_order_relaxed))
     , currentState(LightState::RED)
     , stateDuration(std::chrono::seconds(30))
     , emergencyMode(false)
     , emergencyVehicleType(EmergencyVehicleType::NONE)
+    , events(std::make_unique<EventBinding>())
 {}
 
 void TrafficLight::setState(LightState newState) {
-    currentState.store(newState);
+    LightState previous = currentState.exchange(newState);
+    auto binding = events.read();
+    if (binding->hub && previous != newState) {
+        binding->hub->publish(SignalEvent::Kind::STATE_CHANGED, binding->index, newState,
+                              EmergencyVehicleType::NONE, std::chrono::seconds(0), key);
+    }
 }
 
 LightState TrafficLight::getState() const {
     return currentState.load();
 }
 
-std::string TrafficLight::getId() const {
+const std::string& TrafficLight::getId() const {
     return id;
 }
 
+uint32_t TrafficLight::getKey() const {
+    return key;
+}
+
 void TrafficLight::setDuration(std::chrono::seconds duration) {
-    std::lock_guard<std::mutex> lock(mutex);
-    stateDuration = duration;
+    std::chrono::seconds previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        previous = stateDuration;
+        stateDuration = duration;
+    }
+    auto binding = events.read();
+    if (binding->hub && previous != duration) {
+        binding->hub->publish(SignalEvent::Kind::DURATION_CHANGED, binding->index, currentState.load(),
+                              EmergencyVehicleType::NONE, duration, key);
+    }
 }
 
 std::chrono::seconds TrafficLight::getDuration() const {
@@ -31,13 +56,23 @@ std::chrono::seconds TrafficLight::getDuration() const {
 }
 
 void TrafficLight::activateEmergencyMode(EmergencyVehicleType type) {
-    emergencyMode.store(true);
     emergencyVehicleType.store(type);
+    bool wasActive = emergencyMode.exchange(true);
+    auto binding = events.read();
+    if (binding->hub && !wasActive) {
+        binding->hub->publish(SignalEvent::Kind::EMERGENCY_ON, binding->index, currentState.load(), type,
+                              std::chrono::seconds(0), key);
+    }
 }
 
 void TrafficLight::deactivateEmergencyMode() {
-    emergencyMode.store(false);
+    bool wasActive = emergencyMode.exchange(false);
     emergencyVehicleType.store(EmergencyVehicleType::NONE);
+    auto binding = events.read();
+    if (binding->hub && wasActive) {
+        binding->hub->publish(SignalEvent::Kind::EMERGENCY_OFF, binding->index, currentState.load(),
+                              EmergencyVehicleType::NONE, std::chrono::seconds(0), key);
+    }
 }
 
 bool TrafficLight::isInEmergencyMode() const {
@@ -47,3 +82,33 @@ bool TrafficLight::isInEmergencyMode() const {
 EmergencyVehicleType TrafficLight::getEmergencyVehicleType() const {
     return emergencyVehicleType.load();
 }
+
+void TrafficLight::attachEventHub(std::shared_ptr<SignalEventHub> hub, uint32_t index) {
+    // Publishers hold a read guard, so the previous binding (and with it
+    // possibly the last reference to the old hub) outlives them
+    events.update([&](EventBinding& binding) {
+        binding.hub = std::move(hub);
+        binding.index = index;
+    });
+}
+
+std::shared_ptr<Subscription> TrafficLight::subscribe() {
+    return subscribe(SubscriptionOptions());
+}
+
+std::shared_ptr<Subscription> TrafficLight::subscribe(const SubscriptionOptions& options) {
+    std::shared_ptr<SignalEventHub> hub = events.read()->hub;
+    if (!hub) {
+        // Writers are serialised, so two first subscribers share one hub
+        events.update([&](EventBinding& binding) {
+            if (!binding.hub) {
+                binding.hub = std::make_shared<SignalEventHub>();
+            }
+            hub = binding.hub;
+        });
+    }
+    // Filter on the key, which survives renumbering when other lanes close
+    SubscriptionOptions filtered = options;
+    filtered.source = key;
+    return hub->subscribe(filtered);
+}
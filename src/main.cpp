@@ -1,8 +1,3 @@
-#include <atomic>
-#include <mutex>
-std::atomic<bool> pedestrianCrossingActive{false};
-std::mutex pedestrianMutex;
-
 #include <iostream>
 #include <random>
 #include <chrono>
@@ -11,6 +6,8 @@ std::mutex pedestrianMutex;
 #include <iomanip>
 #include <sstream>
 #include "Intersection.hpp"
+#include "ScenarioEngine.hpp"
+#include "SignalEvents.hpp"
 
 // ANSI color codes for better visualization
 #define COLOR_RESET   "\033[0m"
@@ -29,14 +26,15 @@ public:
         std::cout << "\033[2J\033[H";
     }
 
-    static void displayIntersection(const std::vector<std::shared_ptr<Lane>>& lanes,
+    static void displayIntersection(const Intersection& intersection,
+                                    const std::vector<std::shared_ptr<Lane>>& lanes,
                                     const std::vector<std::shared_ptr<TrafficLight>>& lights) {
         clearScreen();
 
         std::cout << COLOR_BOLD COLOR_CYAN "🚦 Smart Traffic Light System - Live View 🚦" COLOR_RESET << std::endl;
         std::cout << "=============================================" << std::endl << std::endl;
 
-        bool crossing = pedestrianCrossingActive.load();
+        bool crossing = intersection.isPedestrianCrossingActive();
 
         for (size_t i = 0; i < lanes.size(); ++i) {
             auto lane = lanes[i];
@@ -128,113 +126,59 @@ public:
     }
 };
 
-void simulateTraffic(std::shared_ptr<Lane> lane, std::shared_ptr<TrafficLight> light) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-
+// Plays the scenario's traffic, emergency and pedestrian events in real time
+void runScenario(std::shared_ptr<Intersection> intersection, Scenario scenario, uint64_t seed) {
+    ScenarioSimulation simulation(scenario, *intersection, seed);
+    auto start = std::chrono::steady_clock::now();
     while (true) {
-        if (dis(gen) < 0.7) {
-            lane->addVehicle();
-        } else {
-            if (light && light->getState() != LightState::RED && !pedestrianCrossingActive.load()) {
-                lane->removeVehicle();
-            }
-        }
         std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        simulation.tick(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
     }
 }
 
-void simulateEmergencyVehicles(std::shared_ptr<Intersection> intersection,
-                              const std::vector<std::shared_ptr<Lane>>& lanes) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> laneSelector(0, lanes.size() - 1);
-    std::uniform_int_distribution<> vehicleTypeSelector(1, 3);
-    std::uniform_int_distribution<> timingSelector(15, 45);
-
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(timingSelector(gen)));
-
-        auto selectedLane = lanes[laneSelector(gen)];
-        EmergencyVehicleType vehicleType;
-
-        switch (vehicleTypeSelector(gen)) {
-            case 1: vehicleType = EmergencyVehicleType::POLICE; break;
-            case 2: vehicleType = EmergencyVehicleType::AMBULANCE; break;
-            case 3: vehicleType = EmergencyVehicleType::FIRE_TRUCK; break;
-            default: vehicleType = EmergencyVehicleType::AMBULANCE; break;
-        }
-
-        intersection->reportEmergencyVehicle(selectedLane->getId(), vehicleType);
-
-        std::uniform_int_distribution<> durationSelector(8, 15);
-        std::this_thread::sleep_for(std::chrono::seconds(durationSelector(gen)));
-
-        intersection->clearEmergencyVehicle(selectedLane->getId());
-    }
-}
-
-void displayLoop(const std::vector<std::shared_ptr<Lane>>& lanes,
+void displayLoop(std::shared_ptr<Intersection> intersection,
+                 const std::vector<std::shared_ptr<Lane>>& lanes,
                  const std::vector<std::shared_ptr<TrafficLight>>& lights) {
+    // Redraw as soon as a light changes; the timeout keeps vehicle counts fresh
+    auto changes = intersection->subscribe();
+    SignalEvent event;
     while (true) {
-        TrafficDisplay::displayIntersection(lanes, lights);
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        TrafficDisplay::displayIntersection(*intersection, lanes, lights);
+        if (changes->waitPop(event, std::chrono::milliseconds(1000))) {
+            while (changes->tryPop(event)) {}
+        }
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
     std::cout << "🚦 Smart Traffic Light System with Emergency Priority 🚦" << std::endl;
     std::cout << "==========================================================" << std::endl;
 
-    auto intersection = std::make_shared<Intersection>("Main Street & First Ave");
-
-    auto northLane = std::make_shared<Lane>("North", 15);
-    auto southLane = std::make_shared<Lane>("South", 15);
-    auto eastLane = std::make_shared<Lane>("East", 15);
-    auto westLane = std::make_shared<Lane>("West", 15);
+    // Optional scenario file; the first scenario in it replaces the random demo
+    Scenario scenario = Scenario::demo();
+    if (argc > 1) {
+        try {
+            scenario = Scenario::loadFile(argv[1]).front();
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+    }
 
-    auto northLight = std::make_shared<TrafficLight>("North Light");
-    auto southLight = std::make_shared<TrafficLight>("South Light");
-    auto eastLight = std::make_shared<TrafficLight>("East Light");
-    auto westLight = std::make_shared<TrafficLight>("West Light");
+    auto intersection = ScenarioSimulation::buildIntersection(scenario);
 
-    intersection->addLane(northLane, northLight);
-    intersection->addLane(southLane, southLight);
-    intersection->addLane(eastLane, eastLight);
-    intersection->addLane(westLane, westLight);
+    std::vector<std::shared_ptr<Lane>> allLanes;
+    std::vector<std::shared_ptr<TrafficLight>> allLights;
+    for (size_t i = 0; i < intersection->getLaneCount(); ++i) {
+        allLanes.push_back(intersection->getLane(i));
+        allLights.push_back(intersection->getLight(i));
+    }
 
-    std::vector<std::shared_ptr<Lane>> allLanes = {northLane, southLane, eastLane, westLane};
-    std::vector<std::shared_ptr<TrafficLight>> allLights = {northLight, southLight, eastLight, westLight};
+    uint64_t seed = scenario.seed ? scenario.seed : std::random_device{}();
 
     std::vector<std::thread> simulationThreads;
-    simulationThreads.emplace_back(simulateTraffic, northLane, northLight);
-    simulationThreads.emplace_back(simulateTraffic, southLane, southLight);
-    simulationThreads.emplace_back(simulateTraffic, eastLane, eastLight);
-    simulationThreads.emplace_back(simulateTraffic, westLane, westLight);
-
-    simulationThreads.emplace_back(simulateEmergencyVehicles, intersection, allLanes);
-
-    simulationThreads.emplace_back([]() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> waitTime(20, 40);
-        std::uniform_int_distribution<> crossDuration(5, 10);
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::seconds(waitTime(gen)));
-            {
-                std::lock_guard<std::mutex> lock(pedestrianMutex);
-                pedestrianCrossingActive = true;
-            }
-            std::this_thread::sleep_for(std::chrono::seconds(crossDuration(gen)));
-            {
-                std::lock_guard<std::mutex> lock(pedestrianMutex);
-                pedestrianCrossingActive = false;
-            }
-        }
-    });
-
-    simulationThreads.emplace_back(displayLoop, allLanes, allLights);
+    simulationThreads.emplace_back(runScenario, intersection, scenario, seed);
+    simulationThreads.emplace_back(displayLoop, intersection, allLanes, allLights);
 
     intersection->start();
 
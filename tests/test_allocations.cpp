@@ -0,0 +1,269 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include "ArenaNetwork.hpp"
+#include "Intersection.hpp"
+#include "SignalEvents.hpp"
+
+// Replaces the global allocation functions so tests can assert that the
+// steady-state control paths never touch the heap. Counting is only enabled
+// inside an AllocationWindow, after warm-up.
+
+namespace {
+
+std::atomic<bool> countingEnabled{false};
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> allocationBytes{0};
+
+void* countedAllocate(std::size_t size) {
+    if (countingEnabled.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    if (countingEnabled.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    auto align = static_cast<std::size_t>(alignment);
+    void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+class AllocationWindow {
+public:
+    AllocationWindow() {
+        allocationCount.store(0);
+        allocationBytes.store(0);
+        countingEnabled.store(true);
+    }
+    ~AllocationWindow() { close(); }
+
+    size_t close() {
+        countingEnabled.store(false);
+        return allocationCount.load();
+    }
+    // Bytes requested inside the window (not counting allocator overhead)
+    size_t bytes() const { return allocationBytes.load(); }
+};
+
+struct TestJunction {
+    Intersection intersection{"Allocation Test Intersection"};
+    std::shared_ptr<ManualClock> clock = std::make_shared<ManualClock>();
+    std::vector<std::string> names{"North", "South", "East", "West"};
+    std::vector<std::shared_ptr<Lane>> lanes;
+
+    TestJunction() {
+        intersection.setClock(clock);
+        for (const auto& name : names) {
+            lanes.push_back(std::make_shared<Lane>(name, 10));
+            intersection.addLane(lanes.back(), std::make_shared<TrafficLight>(name + " Light"));
+        }
+    }
+
+    // Drives every control path: occupancy changes, saturation, emergency
+    // preemption and pedestrian crossings
+    void exercise(int iteration) {
+        size_t laneIdx = static_cast<size_t>(iteration) % lanes.size();
+        if (iteration % 3 == 0) {
+            lanes[laneIdx]->removeVehicle();
+        } else {
+            lanes[laneIdx]->addVehicle();
+        }
+        if (iteration % 17 == 0) {
+            intersection.reportEmergencyVehicle(names[laneIdx], EmergencyVehicleType::AMBULANCE);
+        }
+        if (iteration % 17 == 5) {
+            intersection.clearEmergencyVehicle(names[(laneIdx + lanes.size() - 1) % lanes.size()]);
+        }
+        if (iteration % 29 == 0) {
+            intersection.requestPedestrianCrossing();
+        }
+        if (iteration % 29 == 3) {
+            intersection.clearPedestrianCrossing();
+        }
+        clock->advance(std::chrono::milliseconds(500));
+        intersection.step();
+    }
+};
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, alignment); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+TEST(AllocationTest, TestHarnessDetectsAllocations) {
+    static int* volatile sink = nullptr;
+    AllocationWindow window;
+    sink = new int(42);
+    delete sink;
+    EXPECT_EQ(window.close(), 1u);
+}
+
+TEST(AllocationTest, TestSteppedControlTickDoesNotAllocate) {
+    TestJunction junction;
+    for (int i = 0; i < 200; ++i) {
+        junction.exercise(i);
+    }
+
+    AllocationWindow window;
+    for (int i = 200; i < 5000; ++i) {
+        junction.exercise(i);
+    }
+    EXPECT_EQ(window.close(), 0u);
+}
+
+TEST(AllocationTest, TestRollingHorizonTickDoesNotAllocate) {
+    TestJunction junction;
+    ControllerParams params;
+    params.policy = ControlPolicy::ROLLING_HORIZON;
+    junction.intersection.setParams(params);
+    for (int i = 0; i < 200; ++i) {
+        junction.exercise(i);
+    }
+
+    AllocationWindow window;
+    for (int i = 200; i < 5000; ++i) {
+        junction.exercise(i);
+    }
+    EXPECT_EQ(window.close(), 0u);
+}
+
+TEST(AllocationTest, TestEventFanOutDoesNotAllocate) {
+    TestJunction junction;
+    SubscriptionOptions small;
+    small.capacity = 8;
+    auto everything = junction.intersection.subscribe();
+    auto lossy = junction.intersection.subscribe(small);
+    for (int i = 0; i < 200; ++i) {
+        junction.exercise(i);
+    }
+
+    AllocationWindow window;
+    SignalEvent event;
+    for (int i = 200; i < 5000; ++i) {
+        junction.exercise(i);
+        while (everything->tryPop(event)) {}
+    }
+    EXPECT_EQ(window.close(), 0u);
+    EXPECT_GT(everything->delivered(), 0u);
+    EXPECT_GT(lossy->dropped(), 0u);
+}
+
+TEST(AllocationTest, TestControlLoopDoesNotAllocate) {
+    TestJunction junction;
+    junction.intersection.start();
+    for (int i = 0; i < 50; ++i) {
+        junction.exercise(i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+
+    // The control thread keeps ticking while events arrive from this thread
+    AllocationWindow window;
+    for (int i = 50; i < 2000; ++i) {
+        junction.exercise(i);
+        if (i % 500 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    size_t allocations = window.close();
+
+    junction.intersection.stop();
+    EXPECT_EQ(allocations, 0u);
+}
+
+TEST(AllocationTest, TestArenaNetworkFootprint) {
+    constexpr int kIntersections = 250;
+    constexpr int kLanesEach = 4;
+
+    size_t objectBytes = 0;
+    {
+        std::vector<std::shared_ptr<Intersection>> network;
+        AllocationWindow window;
+        for (int i = 0; i < kIntersections; ++i) {
+            auto intersection = std::make_shared<Intersection>("I" + std::to_string(i));
+            for (int j = 0; j < kLanesEach; ++j) {
+                std::string name = "L" + std::to_string(j);
+                intersection->addLane(std::make_shared<Lane>(name, 20), std::make_shared<TrafficLight>(name));
+            }
+            network.push_back(intersection);
+        }
+        window.close();
+        objectBytes = window.bytes();
+    }
+
+    size_t arenaBytes = 0;
+    {
+        AllocationWindow window;
+        ArenaNetwork network(kIntersections, kIntersections * kLanesEach);
+        for (int i = 0; i < kIntersections; ++i) {
+            ArenaIntersection intersection = network.addIntersection();
+            for (int j = 0; j < kLanesEach; ++j) {
+                network.addLane(intersection, 20);
+            }
+        }
+        EXPECT_EQ(window.close(), 1u);   // the arena itself
+        arenaBytes = window.bytes();
+        EXPECT_GE(arenaBytes, network.getArenaBytes());
+        EXPECT_LT(arenaBytes, network.getArenaBytes() + 1024);
+    }
+
+    double lanes = kIntersections * kLanesEach;
+    std::cout << "bytes per lane: objects " << objectBytes / lanes << ", arena " << arenaBytes / lanes << std::endl;
+    EXPECT_GT(objectBytes, 20 * arenaBytes);
+}
+
+TEST(AllocationTest, TestArenaNetworkStepDoesNotAllocate) {
+    ArenaNetwork network(100, 400);
+    for (int i = 0; i < 100; ++i) {
+        ArenaIntersection intersection = network.addIntersection();
+        for (int j = 0; j < 4; ++j) {
+            network.addLane(intersection, 10);
+        }
+    }
+    Clock::time_point now{};
+    AllocationWindow window;
+    for (int step = 0; step < 2000; ++step) {
+        auto lane = static_cast<ArenaLane>((step * 37) % 400);
+        network.addVehicles(lane, step % 3);
+        network.removeVehicles(static_cast<ArenaLane>((step * 11) % 400), 1);
+        if (step % 50 == 0) {
+            network.reportEmergencyVehicle(lane, EmergencyVehicleType::FIRE_TRUCK);
+        }
+        if (step % 50 == 25) {
+            network.clearEmergencyVehicle(static_cast<ArenaLane>(((step - 25) * 37) % 400));
+        }
+        now += std::chrono::milliseconds(500);
+        network.step(now);
+    }
+    EXPECT_EQ(window.close(), 0u);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,37 @@
+/* Compiled as C, so the public header is checked by a C compiler and the
+ * library is exercised the way a C embedder links it. Called from
+ * CApiTest.TestHeaderCompilesAsC; returns 0 or the number of the failed check. */
+
+#include "smart_traffic_c.h"
+
+int stl_c_api_smoke(void) {
+    stl_network* network = stl_network_create();
+    stl_intersection intersection = 0;
+    stl_lane north = 0;
+    stl_lane east = 0;
+    int32_t applied = 0;
+    stl_state_view state = {0};
+    int result = 0;
+
+    if (!network) {
+        return 1;
+    }
+    if (stl_network_add_intersection(network, "C Junction", &intersection) != STL_OK ||
+        stl_network_add_lane(network, intersection, "North", 10, &north) != STL_OK ||
+        stl_network_add_lane(network, intersection, "East", 10, &east) != STL_OK) {
+        result = 2;
+    } else if (stl_lane_arrive(network, east, 6, &applied) != STL_OK || applied != 6 ||
+               stl_network_step(network, 1000) != STL_OK) {
+        result = 3;
+    } else {
+        state.struct_size = sizeof(state);
+        if (stl_network_state(network, &state) != STL_OK || state.lane_count != 2 || state.step_count != 1) {
+            result = 4;
+        } else if (state.vehicle_counts[east] != 6 || state.light_states[east] != STL_LIGHT_GREEN ||
+                   state.light_states[north] != STL_LIGHT_RED) {
+            result = 5;
+        }
+    }
+    stl_network_destroy(network);
+    return result;
+}
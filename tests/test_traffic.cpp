@@ -1,7 +1,30 @@
 #include <gtest/gtest.h>
 #include "Lane.hpp"
+#include "ArenaNetwork.hpp"
+#include "CorridorPreemption.hpp"
+#include "GreenWave.hpp"
+#include "HorizonPlanner.hpp"
 #include "TrafficLight.hpp"
 #include "Intersection.hpp"
+#include "IngestServer.hpp"
+#include "PolicySweep.hpp"
+#include "RcuCell.hpp"
+#include "ScenarioEngine.hpp"
+#include "ShardedSimulation.hpp"
+#include "SignalEvents.hpp"
+#include "SpatialIndex.hpp"
+#include "TimeSeriesStore.hpp"
+#include "smart_traffic_c.h"
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
 
 TEST(LaneTest, TestVehicleCountOperations) {
     Lane lane("Test Lane", 10);
@@ -39,6 +62,52 @@ TEST(LaneTest, TestEmergencyVehicleDetection) {
     EXPECT_EQ(lane.getEmergencyVehicleType(), EmergencyVehicleType::NONE);
 }
 
+TEST(LaneStatisticsTest, TestP2QuantileTracksUniformDistribution) {
+    P2Quantile median(0.5);
+    P2Quantile tail(0.9);
+    for (int i = 0; i < 10000; ++i) {
+        double value = (i * 7919 % 10000) / 10000.0; // permutation of [0, 1)
+        median.add(value);
+        tail.add(value);
+    }
+    EXPECT_EQ(median.count(), 10000u);
+    EXPECT_NEAR(median.value(), 0.5, 0.02);
+    EXPECT_NEAR(tail.value(), 0.9, 0.02);
+}
+
+TEST(LaneStatisticsTest, TestRatesAndWindowedMax) {
+    Lane lane("North", 1000);
+    ManualClock clock;
+
+    // Two arrivals and one departure per second for five minutes
+    for (int second = 0; second < 300; ++second) {
+        lane.addVehicle();
+        lane.addVehicle();
+        lane.removeVehicle();
+        clock.advance(std::chrono::seconds(1));
+        lane.sampleStatistics(clock.now());
+    }
+    auto stats = lane.getStatistics().snapshot();
+    EXPECT_EQ(stats.samples, 300u);
+    EXPECT_NEAR(stats.arrivalRate, 2.0, 0.05);
+    EXPECT_NEAR(stats.dischargeRate, 1.0, 0.05);
+    EXPECT_NEAR(stats.windowMaxOccupancy, 0.3, 1e-9);
+    EXPECT_NEAR(lane.predictedDemand(std::chrono::seconds(10)), 300 + 20, 1.0);
+
+    // The peak rotates out of the window once the queue has drained
+    for (int i = 0; i < 300; ++i) {
+        lane.removeVehicle();
+    }
+    for (int second = 0; second < 90; ++second) {
+        clock.advance(std::chrono::seconds(1));
+        lane.sampleStatistics(clock.now());
+    }
+    stats = lane.getStatistics().snapshot();
+    EXPECT_DOUBLE_EQ(stats.windowMaxOccupancy, 0.0);
+    EXPECT_NEAR(stats.smoothedOccupancy, 0.0, 1e-6);
+    EXPECT_GT(stats.occupancyP90, 0.1);
+}
+
 TEST(TrafficLightTest, TestStateChanges) {
     TrafficLight light("Test Light");
     EXPECT_EQ(light.getState(), LightState::RED);
@@ -85,6 +154,1560 @@ TEST(IntersectionTest, TestEmergencyVehicleReporting) {
     EXPECT_FALSE(light->isInEmergencyMode());
 }
 
+TEST(IntersectionTest, TestSteppedControlWithManualClock) {
+    Intersection intersection("Stepped Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+
+    auto north = std::make_shared<Lane>("North", 10);
+    auto south = std::make_shared<Lane>("South", 10);
+    intersection.addLane(north, std::make_shared<TrafficLight>("North Light"));
+    intersection.addLane(south, std::make_shared<TrafficLight>("South Light"));
+
+    for (int i = 0; i < 6; ++i) {
+        south->addVehicle();
+    }
+    intersection.step();
+
+    // The yellow phase advances the manual clock instead of blocking
+    EXPECT_EQ(intersection.getLight(1)->getState(), LightState::GREEN);
+    EXPECT_EQ(intersection.getLight(0)->getState(), LightState::RED);
+    EXPECT_EQ(clock->now().time_since_epoch(), std::chrono::seconds(1));
+}
+
+TEST(IntersectionTest, TestPedestrianCrossingHoldsAllRed) {
+    Intersection intersection("Crossing Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+
+    auto north = std::make_shared<Lane>("North", 10);
+    auto east = std::make_shared<Lane>("East", 10);
+    auto northLight = std::make_shared<TrafficLight>("North Light");
+    auto eastLight = std::make_shared<TrafficLight>("East Light");
+    intersection.addLane(north, northLight);
+    intersection.addLane(east, eastLight);
+
+    north->addVehicle();
+    intersection.step();
+    EXPECT_EQ(northLight->getState(), LightState::GREEN);
+
+    intersection.requestPedestrianCrossing();
+    intersection.step();
+    EXPECT_TRUE(intersection.isPedestrianCrossingActive());
+    EXPECT_EQ(northLight->getState(), LightState::RED);
+    EXPECT_EQ(eastLight->getState(), LightState::RED);
+
+    // Emergency vehicles still take priority over the crossing
+    intersection.reportEmergencyVehicle("East", EmergencyVehicleType::AMBULANCE);
+    intersection.step();
+    EXPECT_EQ(eastLight->getState(), LightState::GREEN);
+
+    intersection.clearEmergencyVehicle("East");
+    intersection.clearPedestrianCrossing();
+    clock->advance(std::chrono::seconds(5)); // minimum green of the emergency lane
+    intersection.step();
+    EXPECT_EQ(northLight->getState(), LightState::GREEN);
+}
+
+TEST(ShardedSimulationTest, TestCrossShardHandoffConservesVehicles) {
+    ShardedSimulation simulation(2, [](uint32_t shard) {
+        auto intersection = std::make_shared<Intersection>("Shard " + std::to_string(shard));
+        auto east = std::make_shared<Lane>("East", 50);
+        auto west = std::make_shared<Lane>("West", 50);
+        intersection->addLane(east, std::make_shared<TrafficLight>("East Light"));
+        intersection->addLane(west, std::make_shared<TrafficLight>("West Light"));
+        for (int i = 0; i < 10; ++i) {
+            (shard == 0 ? east : west)->addVehicle();
+        }
+        if (shard == 0) {
+            intersection->reportEmergencyVehicle("East", EmergencyVehicleType::AMBULANCE);
+        }
+        return std::vector<std::shared_ptr<Intersection>>{intersection};
+    });
+    simulation.addLink({{0, 0, 0}, {1, 0, 0}});
+    simulation.addLink({{1, 0, 1}, {0, 0, 1}});
+
+    auto stats = simulation.run(40);
+    ASSERT_EQ(stats.size(), 2u);
+
+    uint64_t sent = 0, received = 0;
+    int64_t vehicles = 0;
+    for (const auto& shard : stats) {
+        EXPECT_EQ(shard.stepsCompleted, 40u);
+        sent += shard.handoffsSent;
+        received += shard.handoffsReceived;
+        vehicles += shard.vehiclesInShard;
+    }
+    EXPECT_GT(sent, 0u);
+    EXPECT_EQ(sent, received);
+    EXPECT_EQ(stats[0].messagesUndeliverable + stats[1].messagesUndeliverable, 0u);
+    EXPECT_EQ(vehicles, 20);
+    EXPECT_EQ(stats[0].emergenciesForwarded, 1u);
+}
+
+TEST(ShardedSimulationTest, TestLinkToMissingLaneFailsTheRun) {
+    ShardedSimulation simulation(2, [](uint32_t shard) {
+        auto intersection = std::make_shared<Intersection>("Shard " + std::to_string(shard));
+        auto east = std::make_shared<Lane>("East", 10);
+        intersection->addLane(east, std::make_shared<TrafficLight>("East Light"));
+        for (int i = 0; i < 5; ++i) {
+            east->addVehicle();
+        }
+        return std::vector<std::shared_ptr<Intersection>>{intersection};
+    });
+    // Shard 1 has a single lane, so lane 3 only exists in the link
+    simulation.addLink({{0, 0, 0}, {1, 0, 3}});
+    EXPECT_THROW(simulation.run(20), std::runtime_error);
+}
+
+TEST(ShardedSimulationTest, TestCrashedShardReleasesTheOthers) {
+    // The last shard dies without unwinding; the first is already waiting at
+    // the step barrier for it
+    ShardedSimulation simulation(3, [](uint32_t shard) {
+        if (shard == 2) {
+            ::raise(SIGKILL);
+        }
+        auto intersection = std::make_shared<Intersection>("Shard " + std::to_string(shard));
+        intersection->addLane(std::make_shared<Lane>("East", 10), std::make_shared<TrafficLight>("East Light"));
+        return std::vector<std::shared_ptr<Intersection>>{intersection};
+    });
+    EXPECT_THROW(simulation.run(1000), std::runtime_error);
+}
+
+TEST(ScenarioTest, TestParseScenarioFile) {
+    std::istringstream input(
+        "# two scenarios\n"
+        "scenario first\n"
+        "seed 9\n"
+        "duration 120\n"
+        "lane North 10 arrivals 0.4\n"
+        "lane East 12 discharge 2\n"
+        "emergency at 30 lane East type fire for 10\n"
+        "pedestrian every 20-40 for 5-10\n"
+        "demand at 60 lane North arrivals 1.5\n"
+        "scenario second\n"
+        "lane West 5\n");
+    auto scenarios = Scenario::parse(input, "inline");
+
+    ASSERT_EQ(scenarios.size(), 2u);
+    const auto& first = scenarios[0];
+    EXPECT_EQ(first.name, "first");
+    EXPECT_EQ(first.seed, 9u);
+    EXPECT_DOUBLE_EQ(first.duration, 120.0);
+    ASSERT_EQ(first.lanes.size(), 2u);
+    EXPECT_DOUBLE_EQ(first.lanes[0].arrivalRate, 0.4);
+    EXPECT_DOUBLE_EQ(first.lanes[1].dischargeRate, 2.0);
+    ASSERT_EQ(first.events.size(), 3u);
+    EXPECT_EQ(first.events[0].lane, 1);
+    EXPECT_EQ(first.events[0].vehicle, EmergencyVehicleType::FIRE_TRUCK);
+    EXPECT_TRUE(first.events[1].recurring);
+    EXPECT_DOUBLE_EQ(first.events[1].intervalMax, 40.0);
+    EXPECT_DOUBLE_EQ(first.events[2].arrivalRate, 1.5);
+
+    std::istringstream broken("scenario bad\nlane North 10\nemergency at 5 lane South for 3\n");
+    try {
+        Scenario::parse(broken, "broken.scn");
+        FAIL() << "expected a parse error";
+    } catch (const std::runtime_error& error) {
+        EXPECT_NE(std::string(error.what()).find("broken.scn:3"), std::string::npos);
+    }
+
+    // stod would accept these; a scenario cannot run for ever or at a NaN rate
+    for (const char* text : {"scenario bad\nduration inf\n", "scenario bad\nlane North 10 arrivals nan\n"}) {
+        std::istringstream nonFinite(text);
+        try {
+            Scenario::parse(nonFinite, "nonfinite.scn");
+            FAIL() << "expected a parse error for " << text;
+        } catch (const std::runtime_error& error) {
+            EXPECT_NE(std::string(error.what()).find("nonfinite.scn:2"), std::string::npos);
+        }
+    }
+}
+
+TEST(ScenarioEngineTest, TestEmergencyPreemptionIsMeasured) {
+    std::istringstream input(
+        "scenario preempt\n"
+        "duration 120\n"
+        "lane North 15 arrivals 1.0\n"
+        "lane South 15 arrivals 0.2\n"
+        "emergency at 40 lane South type ambulance for 10\n");
+    auto scenario = Scenario::parse(input, "inline").front();
+
+    ScenarioEngine engine(1);
+    auto result = engine.run(scenario);
+    EXPECT_DOUBLE_EQ(result.simulatedSeconds, 120.0);
+    EXPECT_EQ(result.emergencies, 1u);
+    EXPECT_EQ(result.emergenciesServed, 1u);
+    EXPECT_LE(result.maxPreemptionLatency, 1.0);
+    EXPECT_GT(result.vehiclesServed, 0u);
+    EXPECT_LE(result.maxQueue, 15);
+}
+
+TEST(ScenarioEngineTest, TestParallelRunsAreDeterministic) {
+    std::vector<Scenario> scenarios;
+    for (uint64_t seed = 1; seed <= 16; ++seed) {
+        Scenario scenario = Scenario::demo();
+        scenario.name = "demo_" + std::to_string(seed);
+        scenario.seed = seed;
+        scenario.duration = 300.0;
+        scenarios.push_back(scenario);
+    }
+
+    auto parallel = ScenarioEngine(4).runAll(scenarios);
+    auto sequential = ScenarioEngine(1).runAll(scenarios);
+    ASSERT_EQ(parallel.size(), scenarios.size());
+    for (size_t i = 0; i < scenarios.size(); ++i) {
+        EXPECT_EQ(parallel[i].name, scenarios[i].name);
+        EXPECT_EQ(parallel[i].vehiclesArrived, sequential[i].vehiclesArrived);
+        EXPECT_EQ(parallel[i].emergencies, sequential[i].emergencies);
+        EXPECT_DOUBLE_EQ(parallel[i].meanDelay, sequential[i].meanDelay);
+    }
+
+    auto summary = ScenarioEngine::summarize(parallel);
+    EXPECT_EQ(summary.scenarios, scenarios.size());
+    EXPECT_GT(summary.emergencies, 0u);
+    EXPECT_LE(summary.maxQueue, 15);
+}
+
+TEST(ScenarioEngineTest, TestFailedScenarioIsReported) {
+    Scenario good = Scenario::demo();
+    good.duration = 60.0;
+    Scenario bad = good;
+    bad.name = "bad_lane";
+    ScenarioEvent event;
+    event.lane = 9;
+    bad.events.push_back(event);
+
+    auto results = ScenarioEngine(2).runAll({good, bad, good});
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_TRUE(results[0].error.empty());
+    EXPECT_EQ(results[1].name, "bad_lane");
+    EXPECT_NE(results[1].error.find("lane"), std::string::npos);
+    EXPECT_TRUE(results[2].error.empty());
+    EXPECT_EQ(results[2].vehiclesArrived, results[0].vehiclesArrived);
+
+    auto summary = ScenarioEngine::summarize(results);
+    EXPECT_EQ(summary.scenarios, 3u);
+    EXPECT_EQ(summary.failed, 1u);
+    EXPECT_DOUBLE_EQ(summary.meanDelay, results[0].meanDelay);
+}
+
+TEST(IntersectionTest, TestControllerParamsShapeGreenDuration) {
+    Intersection intersection("Tuned Intersection");
+    intersection.setClock(std::make_shared<ManualClock>());
+    ControllerParams params;
+    params.baseGreen = std::chrono::seconds(10);
+    params.greenRange = std::chrono::seconds(20);
+    intersection.setParams(params);
+
+    auto lane = std::make_shared<Lane>("North", 10);
+    auto light = std::make_shared<TrafficLight>("North Light");
+    intersection.addLane(lane, light);
+    intersection.addLane(std::make_shared<Lane>("South", 10), std::make_shared<TrafficLight>("South Light"));
+    for (int i = 0; i < 5; ++i) {
+        lane->addVehicle();
+    }
+    intersection.step();
+
+    EXPECT_EQ(light->getState(), LightState::GREEN);
+    EXPECT_EQ(light->getDuration(), std::chrono::seconds(20)); // 10 s + 50% of 20 s
+    EXPECT_EQ(intersection.getParams().baseGreen, std::chrono::seconds(10));
+
+    // Invalid settings are rejected and leave the current ones in place
+    ControllerParams bad = params;
+    bad.saturationThreshold = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_THROW(intersection.setParams(bad), std::invalid_argument);
+    bad = params;
+    bad.saturationThreshold = 1.5;
+    EXPECT_THROW(intersection.setParams(bad), std::invalid_argument);
+    bad = params;
+    bad.yellow = std::chrono::milliseconds(-1);
+    EXPECT_THROW(intersection.setParams(bad), std::invalid_argument);
+    bad = params;
+    bad.horizonSteps = 0;
+    EXPECT_THROW(intersection.setParams(bad), std::invalid_argument);
+    EXPECT_EQ(intersection.getParams().baseGreen, std::chrono::seconds(10));
+}
+
+TEST(IntersectionTest, TestSmoothedOccupancyIgnoresSingleSpike) {
+    for (bool smooth : {true, false}) {
+        Intersection intersection("Noisy Intersection");
+        auto clock = std::make_shared<ManualClock>();
+        intersection.setClock(clock);
+        ControllerParams params;
+        params.smoothOccupancy = smooth;
+        intersection.setParams(params);
+
+        auto north = std::make_shared<Lane>("North", 10);
+        auto south = std::make_shared<Lane>("South", 10);
+        auto northLight = std::make_shared<TrafficLight>("North Light");
+        intersection.addLane(north, northLight);
+        intersection.addLane(south, std::make_shared<TrafficLight>("South Light"));
+        for (int i = 0; i < 4; ++i) north->addVehicle();
+        for (int i = 0; i < 3; ++i) south->addVehicle();
+
+        for (int tick = 0; tick < 20; ++tick) {
+            clock->advance(std::chrono::milliseconds(500));
+            intersection.step();
+        }
+        ASSERT_EQ(northLight->getState(), LightState::GREEN);
+
+        // One noisy detector sample on the South approach
+        for (int i = 0; i < 3; ++i) south->addVehicle();
+        clock->advance(std::chrono::milliseconds(500));
+        intersection.step();
+        EXPECT_EQ(northLight->getState() == LightState::GREEN, smooth);
+    }
+}
+
+TEST(IntersectionTest, TestCollectStatistics) {
+    Intersection intersection("Statistics Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+    for (int i = 0; i < 64; ++i) {
+        intersection.addLane(std::make_shared<Lane>("Lane " + std::to_string(i), 10),
+                             std::make_shared<TrafficLight>("Light " + std::to_string(i)));
+    }
+    intersection.getLane(3)->addVehicle();
+    clock->advance(std::chrono::milliseconds(500));
+    intersection.step();
+
+    std::vector<LaneStatisticsSnapshot> stats;
+    intersection.collectStatistics(stats);
+    ASSERT_EQ(stats.size(), 64u);
+    EXPECT_EQ(stats[0].samples, 1u);
+    EXPECT_DOUBLE_EQ(stats[3].smoothedOccupancy, 0.1);
+}
+
+TEST(PolicySweepTest, TestSweepRanksGridPoints) {
+    ParameterGrid grid;
+    grid.saturationThresholds = {0.7, 0.9};
+    grid.minGreens = {std::chrono::seconds(3), std::chrono::seconds(8)};
+    auto points = grid.expand();
+    ASSERT_EQ(points.size(), 4u);
+
+    Scenario scenario = Scenario::demo();
+    scenario.duration = 120.0;
+    PolicySweep sweep(scenario, 2);
+    auto results = sweep.run(points, 3, 11);
+    ASSERT_EQ(results.size(), points.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i].runs, 3u);
+        if (i > 0) {
+            EXPECT_LE(results[i - 1].score, results[i].score);
+        }
+    }
+
+    // Same seeds give the same ranking
+    auto again = PolicySweep(scenario, 1).run(points, 3, 11);
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_DOUBLE_EQ(results[i].score, again[i].score);
+    }
+
+    // A run that throws on a pool thread surfaces from run() instead of terminating
+    scenario.duration = std::numeric_limits<double>::infinity();
+    EXPECT_THROW(PolicySweep(scenario, 3).run(points, 2, 11), std::invalid_argument);
+}
+
+TEST(SignalEventTest, TestSubscriberReceivesOrderedChanges) {
+    Intersection intersection("Event Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+    auto north = std::make_shared<Lane>("North", 10);
+    auto northLight = std::make_shared<TrafficLight>("North Light");
+    auto southLight = std::make_shared<TrafficLight>("South Light");
+    intersection.addLane(north, northLight);
+    intersection.addLane(std::make_shared<Lane>("South", 10), southLight);
+
+    auto all = intersection.subscribe();
+    SubscriptionOptions onlySouth;
+    onlySouth.light = 1;
+    auto south = intersection.subscribe(onlySouth);
+
+    for (int i = 0; i < 5; ++i) north->addVehicle();
+    clock->advance(std::chrono::seconds(1));
+    intersection.step();
+    intersection.requestPedestrianCrossing();
+    intersection.requestPedestrianCrossing();  // no change, no event
+
+    std::vector<SignalEvent> events;
+    SignalEvent event;
+    while (all->tryPop(event)) {
+        events.push_back(event);
+    }
+    ASSERT_GE(events.size(), 3u);
+    for (size_t i = 1; i < events.size(); ++i) {
+        EXPECT_EQ(events[i].sequence, events[i - 1].sequence + 1);
+    }
+    // North goes through yellow to green, with the yellow visible to subscribers
+    EXPECT_EQ(events[0].kind, SignalEvent::Kind::STATE_CHANGED);
+    EXPECT_EQ(events[0].light, 0u);
+    EXPECT_EQ(events[0].state, LightState::YELLOW);
+    EXPECT_EQ(events[1].state, LightState::GREEN);
+    EXPECT_GT(events[1].time, events[0].time);
+    EXPECT_EQ(events.back().kind, SignalEvent::Kind::PEDESTRIAN_ON);
+
+    // South never changed, so its filtered subscriber saw nothing
+    EXPECT_FALSE(south->tryPop(event));
+
+    intersection.unsubscribe(all);
+    EXPECT_FALSE(all->isActive());
+    intersection.clearPedestrianCrossing();
+    EXPECT_FALSE(all->tryPop(event));
+}
+
+TEST(SignalEventTest, TestOverflowPolicies) {
+    auto light = std::make_shared<TrafficLight>("Standalone Light");
+    SubscriptionOptions options;
+    options.capacity = 4;
+    options.overflow = OverflowPolicy::DROP_NEWEST;
+    auto newest = light->subscribe(options);
+    options.overflow = OverflowPolicy::DROP_OLDEST;
+    auto oldest = light->subscribe(options);
+    options.overflow = OverflowPolicy::BLOCK;
+    options.blockTimeout = std::chrono::microseconds(10);
+    auto blocking = light->subscribe(options);
+
+    for (int i = 1; i <= 10; ++i) {
+        light->setDuration(std::chrono::seconds(i));
+    }
+
+    SignalEvent event;
+    ASSERT_TRUE(newest->tryPop(event));
+    EXPECT_EQ(event.duration, std::chrono::seconds(1));
+    EXPECT_EQ(newest->dropped(), 6u);
+    ASSERT_TRUE(oldest->tryPop(event));
+    EXPECT_EQ(event.duration, std::chrono::seconds(7));
+    EXPECT_EQ(oldest->dropped(), 6u);
+    EXPECT_EQ(blocking->dropped(), 6u);
+
+    // A consumer waiting on an empty queue times out
+    while (oldest->tryPop(event)) {}
+    EXPECT_FALSE(oldest->waitPop(event, std::chrono::milliseconds(5)));
+}
+
+TEST(TimeSeriesStoreTest, TestRangeRollupAndReopen) {
+    auto directory = std::filesystem::temp_directory_path() /
+                     ("traffic_history_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(directory);
+
+    // Two hours of 2 Hz occupancy samples with the repetitive values lanes produce
+    const int64_t start = 1700000000000;
+    const int samples = 2 * 3600 * 2;
+    auto occupancy = [](int i) { return ((i / 7) % 11) / 10.0; };
+    {
+        TimeSeriesStore store(directory.string());
+        for (int i = 0; i < samples; ++i) {
+            store.append("Main/North/occupancy", start + i * 500, occupancy(i));
+        }
+        EXPECT_THROW(store.append("Main/North/occupancy", start, 0.0), std::invalid_argument);
+        EXPECT_EQ(store.sampleCount("Main/North/occupancy"), static_cast<uint64_t>(samples));
+
+        auto window = store.range("Main/North/occupancy", start + 1000 * 500, start + 1010 * 500);
+        ASSERT_EQ(window.size(), 10u);
+        EXPECT_EQ(window[0].time, start + 1000 * 500);
+        EXPECT_DOUBLE_EQ(window[3].value, occupancy(1003));
+        // Raw samples would take 16 bytes each
+        EXPECT_LT(store.compressedBytes("Main/North/occupancy"), static_cast<uint64_t>(samples) * 3);
+    }
+
+    TimeSeriesStore reopened(directory.string());
+    ASSERT_EQ(reopened.seriesNames().size(), 1u);
+    auto all = reopened.range("Main/North/occupancy", start, start + samples * 500);
+    ASSERT_EQ(all.size(), static_cast<size_t>(samples));
+    for (int i = 0; i < samples; i += 997) {
+        EXPECT_EQ(all[i].time, start + i * 500);
+        EXPECT_DOUBLE_EQ(all[i].value, occupancy(i));
+    }
+
+    auto minutes = reopened.rollup("Main/North/occupancy", RollupResolution::MINUTE, start, start + 3600000);
+    ASSERT_GE(minutes.size(), 60u);
+    EXPECT_EQ(minutes[1].count, 120u);
+    EXPECT_DOUBLE_EQ(minutes[1].min, 0.0);
+    EXPECT_DOUBLE_EQ(minutes[1].max, 1.0);
+    auto hours = reopened.rollup("Main/North/occupancy", RollupResolution::HOUR, 0, start * 2);
+    uint64_t counted = 0;
+    for (const auto& bucket : hours) {
+        counted += bucket.count;
+    }
+    EXPECT_EQ(counted, static_cast<uint64_t>(samples));
+
+    // The open bucket is rebuilt from raw samples, so appends continue it
+    const int64_t end = start + samples * 500;
+    const int64_t bucketStart = end - end % 60000;
+    reopened.append("Main/North/occupancy", end, 1.0);
+    auto last = reopened.rollup("Main/North/occupancy", RollupResolution::MINUTE, bucketStart, end + 1);
+    ASSERT_EQ(last.size(), 1u);
+    EXPECT_EQ(last[0].count, static_cast<uint32_t>((end - bucketStart) / 500 + 1));
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(CorridorPreemptionTest, TestClearsJustInTimeAndReleasesOnPass) {
+    using namespace std::chrono_literals;
+    auto corridorClock = std::make_shared<ManualClock>();
+    std::vector<std::shared_ptr<Intersection>> intersections;
+    std::vector<std::shared_ptr<ManualClock>> clocks;
+    std::vector<RouteLeg> route;
+    for (int i = 0; i < 3; ++i) {
+        auto intersection = std::make_shared<Intersection>("Avenue " + std::to_string(i));
+        clocks.push_back(std::make_shared<ManualClock>(corridorClock->now()));
+        intersection->setClock(clocks.back());
+        auto east = std::make_shared<Lane>("East", 20);
+        intersection->addLane(east, std::make_shared<TrafficLight>("East Light"));
+        intersection->addLane(std::make_shared<Lane>("North", 20), std::make_shared<TrafficLight>("North Light"));
+        // The last approach has a long queue, so it must be cleared earlier
+        for (int v = 0; v < (i == 2 ? 10 : 0); ++v) east->addVehicle();
+        intersections.push_back(intersection);
+        route.push_back({intersection, "East", 60s});
+    }
+
+    CorridorPreemption corridor(corridorClock);
+    auto run = corridor.dispatch(EmergencyVehicleType::AMBULANCE, route);
+    auto legs = corridor.status(run);
+    ASSERT_EQ(legs.size(), 3u);
+    EXPECT_EQ(legs[0].phase, LegPhase::PENDING);
+    // 10 queued vehicles at 0.5 veh/s, plus start-up and yellow
+    EXPECT_EQ(legs[2].eta - legs[2].clearAt, std::chrono::duration_cast<Clock::duration>(23s));
+    EXPECT_EQ(legs[0].eta - legs[0].clearAt, std::chrono::duration_cast<Clock::duration>(5s));
+
+    auto tick = [&]() {
+        corridorClock->advance(1s);
+        corridor.update();
+        for (size_t i = 0; i < intersections.size(); ++i) {
+            clocks[i]->advanceTo(corridorClock->now());
+            intersections[i]->step();
+        }
+    };
+
+    for (int second = 1; second <= 180; ++second) {
+        tick();
+        auto states = corridor.status(run);
+        if (second == 150) {
+            // Two legs passed; the last is not held until its queue needs clearing
+            ASSERT_EQ(states.size(), 3u);
+            EXPECT_EQ(states[1].phase, LegPhase::RELEASED);
+            EXPECT_EQ(states[2].phase, LegPhase::PENDING);
+        }
+        if (second == 157) {
+            EXPECT_EQ(states[2].phase, LegPhase::PREEMPTED);
+        }
+        if (second % 60 == 0) {
+            size_t leg = static_cast<size_t>(second / 60 - 1);
+            EXPECT_EQ(intersections[leg]->getLight(0)->getState(), LightState::GREEN) << "leg " << leg;
+            EXPECT_EQ(intersections[leg]->getLight(1)->getState(), LightState::RED) << "leg " << leg;
+            corridor.reportPassed(run, leg);
+            EXPECT_FALSE(intersections[leg]->getLight(0)->isInEmergencyMode());
+        }
+    }
+
+    EXPECT_EQ(corridor.activeRuns(), 0u);
+    auto stats = corridor.getStats();
+    EXPECT_EQ(stats.legsPreempted, 3u);
+    EXPECT_EQ(stats.legsReleasedOnPass, 3u);
+    EXPECT_EQ(stats.legsTimedOut, 0u);
+    EXPECT_LE(stats.maxHoldSeconds, 24.0);
+}
+
+TEST(CorridorPreemptionTest, TestSlowMeasuredDischargeUsesFloor) {
+    using namespace std::chrono_literals;
+    auto clock = std::make_shared<ManualClock>();
+    auto intersection = std::make_shared<Intersection>("Mostly Red Intersection");
+    intersection->setClock(clock);
+    auto east = std::make_shared<Lane>("East", 20);
+    intersection->addLane(east, std::make_shared<TrafficLight>("East Light"));
+    east->addVehicles(20);
+
+    // A trickle of departures: a measured rate well below the floor
+    for (int second = 0; second <= 60; ++second) {
+        if (second % 6 == 5) {
+            east->removeVehicle();
+        }
+        east->sampleStatistics(clock->now());
+        clock->advance(1s);
+    }
+    ASSERT_EQ(east->getVehicleCount(), 10);
+    ASSERT_GT(east->getStatistics().snapshot().dischargeRate, 0.05);
+    ASSERT_LT(east->getStatistics().snapshot().dischargeRate, 0.25);
+
+    CorridorPreemption corridor(clock);
+    auto run = corridor.dispatch(EmergencyVehicleType::AMBULANCE, {{intersection, "East", 120s}});
+    auto legs = corridor.status(run);
+    // 10 queued vehicles at 0.5 veh/s, plus start-up and yellow
+    EXPECT_EQ(legs[0].eta - legs[0].clearAt, std::chrono::duration_cast<Clock::duration>(23s));
+    corridor.cancel(run);
+}
+
+TEST(CorridorPreemptionTest, TestSharedApproachReleasedByLastRun) {
+    using namespace std::chrono_literals;
+    auto clock = std::make_shared<ManualClock>();
+    auto intersection = std::make_shared<Intersection>("Shared Intersection");
+    intersection->setClock(clock);
+    auto east = std::make_shared<Lane>("East", 10);
+    auto north = std::make_shared<Lane>("North", 10);
+    intersection->addLane(east, std::make_shared<TrafficLight>("East Light"));
+    intersection->addLane(north, std::make_shared<TrafficLight>("North Light"));
+
+    CorridorPreemption corridor(clock);
+    auto police = corridor.dispatch(EmergencyVehicleType::POLICE, {{intersection, "East", 3s}});
+    auto ambulance = corridor.dispatch(EmergencyVehicleType::AMBULANCE, {{intersection, "East", 4s}});
+    EXPECT_EQ(east->getEmergencyVehicleType(), EmergencyVehicleType::AMBULANCE);
+
+    // The first vehicle through does not release the approach for the second
+    corridor.reportPassed(police, 0);
+    EXPECT_EQ(east->getEmergencyVehicleType(), EmergencyVehicleType::AMBULANCE);
+    corridor.reportPassed(ambulance, 0);
+    EXPECT_FALSE(east->hasEmergencyVehicle());
+
+    // An emergency a detector reported is left in place
+    intersection->reportEmergencyVehicle("North", EmergencyVehicleType::FIRE_TRUCK);
+    auto run = corridor.dispatch(EmergencyVehicleType::AMBULANCE, {{intersection, "North", 3s}});
+    EXPECT_EQ(north->getEmergencyVehicleType(), EmergencyVehicleType::FIRE_TRUCK);
+    corridor.cancel(run);
+    EXPECT_EQ(north->getEmergencyVehicleType(), EmergencyVehicleType::FIRE_TRUCK);
+    EXPECT_EQ(corridor.activeRuns(), 0u);
+}
+
+TEST(CorridorPreemptionTest, TestUnreportedLegTimesOut) {
+    using namespace std::chrono_literals;
+    auto clock = std::make_shared<ManualClock>();
+    auto intersection = std::make_shared<Intersection>("Lone Intersection");
+    intersection->setClock(clock);
+    intersection->addLane(std::make_shared<Lane>("East", 10), std::make_shared<TrafficLight>("East Light"));
+
+    CorridorParams params;
+    params.releaseTimeout = 20s;
+    CorridorPreemption corridor(clock, params);
+    auto run = corridor.dispatch(EmergencyVehicleType::FIRE_TRUCK, {{intersection, "East", 3s}});
+    // Already within the minimum lead, so it is held immediately
+    EXPECT_EQ(corridor.status(run)[0].phase, LegPhase::PREEMPTED);
+    EXPECT_TRUE(intersection->getLight(0)->isInEmergencyMode());
+
+    clock->advance(22s);
+    corridor.update();
+    EXPECT_EQ(corridor.status(run)[0].phase, LegPhase::PREEMPTED);
+    clock->advance(2s);
+    corridor.update();
+    EXPECT_EQ(corridor.activeRuns(), 0u);
+    EXPECT_FALSE(intersection->getLight(0)->isInEmergencyMode());
+    EXPECT_EQ(corridor.getStats().legsTimedOut, 1u);
+}
+
+TEST(SpatialIndexTest, TestRoutesPositionAndHeadingToApproach) {
+    // A 30 x 30 street grid with 200 m blocks; lanes are named by travel direction
+    const std::vector<std::pair<std::string, double>> approaches = {
+        {"Northbound", 0.0}, {"Eastbound", 90.0}, {"Southbound", 180.0}, {"Westbound", 270.0}};
+    std::vector<std::shared_ptr<Intersection>> grid;
+    for (int row = 0; row < 30; ++row) {
+        for (int column = 0; column < 30; ++column) {
+            auto intersection = std::make_shared<Intersection>(std::to_string(row) + "," + std::to_string(column));
+            intersection->setLocation({column * 200.0, row * 200.0});
+            for (size_t a = 0; a < approaches.size(); ++a) {
+                intersection->addLane(std::make_shared<Lane>(approaches[a].first, 10),
+                                      std::make_shared<TrafficLight>(approaches[a].first + " Light"));
+                intersection->setApproachHeading(a, approaches[a].second);
+            }
+            grid.push_back(intersection);
+        }
+    }
+    auto index = SpatialIndex::build(grid, 100.0);
+    ASSERT_EQ(index->intersectionCount(), grid.size());
+
+    // Driving north, 60 m short of intersection (row 4, column 7)
+    auto match = index->locate({1400.0, 740.0}, 2.0);
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match.intersection->getId(), "4,7");
+    EXPECT_EQ(match.intersection->getLane(match.lane)->getId(), "Northbound");
+
+    // Just past it and driving away: nothing ahead within range
+    EXPECT_FALSE(index->locate({1400.0, 860.0}, 0.0));
+    // At the stop line the heading filter no longer applies
+    EXPECT_TRUE(index->locate({1400.0, 805.0}, 0.0));
+
+    // A pedestrian button on the east arm has no heading
+    match = index->locate({1430.0, 800.0}, std::nan(""));
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match.intersection->getId(), "4,7");
+    EXPECT_EQ(match.intersection->getLane(match.lane)->getId(), "Westbound");
+
+    EXPECT_FALSE(index->locate({-500.0, -500.0}, 0.0));
+
+    // Heading-free lookups agree with a brute-force nearest search
+    std::mt19937 random(5);
+    std::uniform_real_distribution<double> coordinate(-100.0, 6000.0);
+    for (int i = 0; i < 2000; ++i) {
+        Position p{coordinate(random), coordinate(random)};
+        double nearest = 1e18;
+        std::shared_ptr<Intersection> expected;
+        for (const auto& intersection : grid) {
+            double distance = distanceBetween(p, intersection->getLocation());
+            if (distance <= 100.0 && distance < nearest) {
+                nearest = distance;
+                expected = intersection;
+            }
+        }
+        auto found = index->locate(p, std::nan(""));
+        ASSERT_EQ(found.intersection, expected.get());
+    }
+}
+
+TEST(SpatialIndexTest, TestSparseNetworkKeepsGridSmall) {
+    // Two towns 5000 km apart: radius-sized cells would number 2.5e9
+    std::vector<std::shared_ptr<Intersection>> towns;
+    for (double x : {0.0, 5.0e6}) {
+        auto intersection = std::make_shared<Intersection>("Town " + std::to_string(towns.size()));
+        intersection->setLocation({x, x});
+        intersection->addLane(std::make_shared<Lane>("Northbound", 10), std::make_shared<TrafficLight>("Light"));
+        intersection->setApproachHeading(0, 0.0);
+        towns.push_back(intersection);
+    }
+    auto index = SpatialIndex::build(towns, 100.0);
+    // Only the cells each town's radius overlaps are stored
+    EXPECT_LE(index->cellCount(), 9 * towns.size());
+
+    auto near = index->locate({5.0e6, 5.0e6 - 50.0}, 0.0);
+    ASSERT_TRUE(near);
+    EXPECT_EQ(near.intersectionIndex, 1u);
+    EXPECT_FALSE(index->locate({2.5e6, 2.5e6}, 0.0));
+
+    towns[0]->setLocation({std::numeric_limits<double>::infinity(), 0.0});
+    EXPECT_THROW(SpatialIndex::build(towns, 100.0), std::invalid_argument);
+}
+
+TEST(SpatialIndexTest, TestLatLonProjection) {
+    Position p = Position::fromLatLon(48.001, 11.0, 48.0, 11.0);
+    EXPECT_NEAR(p.y, 111.2, 0.1);
+    EXPECT_NEAR(p.x, 0.0, 1e-9);
+    EXPECT_NEAR(bearingBetween({0, 0}, {-1, 0}), 270.0, 1e-9);
+    EXPECT_NEAR(headingDifference(350.0, 10.0), 20.0, 1e-9);
+}
+
+namespace {
+
+int connectUnix(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+template <typename Predicate>
+bool waitFor(Predicate predicate) {
+    for (int i = 0; i < 2000 && !predicate(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return predicate();
+}
+
+} // namespace
+
+TEST(IngestServerTest, TestAppliesBatchedRecords) {
+    auto intersection = std::make_shared<Intersection>("Ingest Intersection");
+    auto north = std::make_shared<Lane>("North", 10);
+    auto south = std::make_shared<Lane>("South", 10);
+    intersection->addLane(north, std::make_shared<TrafficLight>("North Light"));
+    intersection->addLane(south, std::make_shared<TrafficLight>("South Light"));
+
+    std::string path = "/tmp/traffic_ingest_" + std::to_string(::getpid()) + ".sock";
+    IngestServer server({intersection});
+    server.listenUnix(path);
+    server.start();
+
+    int fd = connectUnix(path);
+    ASSERT_GE(fd, 0);
+    std::vector<ingest::Record> records = {
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 0, 0, 4},
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 1, 0, 25},   // clamped at capacity
+        {ingest::RecordKind::VEHICLE_DEPARTURES, 0, 1, 0, 3},
+        {ingest::RecordKind::EMERGENCY_REPORT, static_cast<uint8_t>(EmergencyVehicleType::AMBULANCE), 1, 0, 0},
+        {ingest::RecordKind::PEDESTRIAN_REQUEST, 0, 0, 0, 0},
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 7, 0, 1},    // no such lane
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 0, 3, 1},    // no such intersection
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 0, 0, -2},   // not a count
+        {ingest::RecordKind::VEHICLE_DEPARTURES, 0, 1, 0, 0},
+    };
+    std::vector<uint8_t> frame(ingest::frameBytes(records.size()));
+    size_t bytes = ingest::encodeFrame(records.data(), static_cast<uint32_t>(records.size()), frame.data());
+    // Split the frame across two writes to exercise reassembly
+    ASSERT_EQ(::send(fd, frame.data(), 10, 0), 10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(::send(fd, frame.data() + 10, bytes - 10, 0), static_cast<ssize_t>(bytes - 10));
+
+    ASSERT_TRUE(waitFor([&]() { return server.getStats().records == records.size(); }));
+    EXPECT_EQ(north->getVehicleCount(), 4);
+    EXPECT_EQ(south->getVehicleCount(), 7);
+    EXPECT_EQ(south->getEmergencyVehicleType(), EmergencyVehicleType::AMBULANCE);
+    EXPECT_TRUE(intersection->getLight(1)->isInEmergencyMode());
+    EXPECT_TRUE(intersection->isPedestrianCrossingActive());
+    EXPECT_EQ(server.getStats().recordsRejected, 4u);
+
+    // A frame with a bad magic drops the connection
+    frame[4] = 0;
+    ASSERT_GT(::send(fd, frame.data(), bytes, 0), 0);
+    ASSERT_TRUE(waitFor([&]() { return server.getStats().protocolErrors == 1; }));
+    char byte;
+    EXPECT_EQ(::recv(fd, &byte, 1, 0), 0);
+    ::close(fd);
+
+    server.stop();
+    EXPECT_EQ(server.getStats().connectionsAccepted, 1u);
+}
+
+TEST(IngestServerTest, TestFollowsLanesClosedWhileRunning) {
+    auto intersection = std::make_shared<Intersection>("Road Works Intersection");
+    std::vector<std::shared_ptr<Lane>> lanes;
+    for (const char* name : {"North", "South", "East"}) {
+        lanes.push_back(std::make_shared<Lane>(name, 10));
+        intersection->addLane(lanes.back(), std::make_shared<TrafficLight>(std::string(name) + " Light"));
+    }
+
+    std::string path = "/tmp/traffic_ingest_close_" + std::to_string(::getpid()) + ".sock";
+    IngestServer server({intersection});
+    server.listenUnix(path);
+    server.start();
+    int fd = connectUnix(path);
+    ASSERT_GE(fd, 0);
+    auto send = [&](const std::vector<ingest::Record>& records) {
+        std::vector<uint8_t> frame(ingest::frameBytes(records.size()));
+        size_t bytes = ingest::encodeFrame(records.data(), static_cast<uint32_t>(records.size()), frame.data());
+        ASSERT_EQ(::send(fd, frame.data(), bytes, 0), static_cast<ssize_t>(bytes));
+    };
+
+    send({{ingest::RecordKind::VEHICLE_ARRIVALS, 0, 0, 0, 2}});
+    ASSERT_TRUE(waitFor([&]() { return server.getStats().records == 1; }));
+    EXPECT_EQ(lanes[0]->getVehicleCount(), 2);
+
+    // North closes: lane indices now follow the remaining lanes
+    ASSERT_TRUE(intersection->removeLane("North"));
+    send({
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 0, 0, 5},
+        {ingest::RecordKind::EMERGENCY_REPORT, static_cast<uint8_t>(EmergencyVehicleType::POLICE), 1, 0, 0},
+        {ingest::RecordKind::VEHICLE_ARRIVALS, 0, 2, 0, 1},    // past the last lane now
+    });
+    ASSERT_TRUE(waitFor([&]() { return server.getStats().records == 4; }));
+    EXPECT_EQ(lanes[0]->getVehicleCount(), 2);
+    EXPECT_EQ(lanes[1]->getVehicleCount(), 5);
+    EXPECT_EQ(lanes[2]->getEmergencyVehicleType(), EmergencyVehicleType::POLICE);
+    EXPECT_FALSE(lanes[1]->hasEmergencyVehicle());
+    EXPECT_EQ(server.getStats().recordsRejected, 1u);
+
+    ::close(fd);
+    server.stop();
+
+    // A restarted server idles on a drained wakeup and still serves records
+    server.start();
+    fd = connectUnix(path);
+    ASSERT_GE(fd, 0);
+    send({{ingest::RecordKind::EMERGENCY_CLEAR, 0, 1, 0, 0}});
+    ASSERT_TRUE(waitFor([&]() { return server.getStats().records == 5; }));
+    EXPECT_FALSE(lanes[2]->hasEmergencyVehicle());
+    ::close(fd);
+    server.stop();
+}
+
+namespace {
+
+// A manual clock whose yellow blocks until the test opens the gate
+class GateClock : public ManualClock {
+public:
+    void sleepFor(duration d) override {
+        sleeping = true;
+        while (!open.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ManualClock::sleepFor(d);
+    }
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> open{false};
+};
+
+} // namespace
+
+TEST(IntersectionTest, TestPostedEmergencyDoesNotWaitForYellow) {
+    Intersection intersection("Posting Intersection");
+    auto clock = std::make_shared<GateClock>();
+    intersection.setClock(clock);
+    auto north = std::make_shared<Lane>("North", 10);
+    auto east = std::make_shared<Lane>("East", 10);
+    auto eastLight = std::make_shared<TrafficLight>("East Light");
+    intersection.addLane(north, std::make_shared<TrafficLight>("North Light"));
+    intersection.addLane(east, eastLight);
+
+    // The tick holds the controller through North's yellow
+    north->addVehicles(5);
+    std::thread tick([&]() { intersection.step(); });
+    ASSERT_TRUE(waitFor([&]() { return clock->sleeping.load(); }));
+
+    EXPECT_TRUE(intersection.postEmergencyVehicle(*east, EmergencyVehicleType::FIRE_TRUCK));
+    EXPECT_FALSE(east->hasEmergencyVehicle());
+    clock->open = true;
+    tick.join();
+
+    // Applied in order at the start of the next tick
+    EXPECT_TRUE(intersection.postEmergencyClear(*east));
+    EXPECT_TRUE(intersection.postEmergencyVehicle(*east, EmergencyVehicleType::AMBULANCE));
+    EXPECT_EQ(east->getEmergencyVehicleType(), EmergencyVehicleType::AMBULANCE);
+    intersection.step();
+    EXPECT_EQ(eastLight->getState(), LightState::GREEN);
+
+    // Posts for a lane that is not part of the intersection are dropped
+    Lane stray("Stray", 10);
+    EXPECT_TRUE(intersection.postEmergencyVehicle(stray, EmergencyVehicleType::POLICE));
+    EXPECT_FALSE(stray.hasEmergencyVehicle());
+}
+
+TEST(SignalEventTest, TestHubReplacedWhileLightPublishes) {
+    auto light = std::make_shared<TrafficLight>("Busy Light");
+    std::atomic<bool> done{false};
+    std::thread publisher([&]() {
+        for (int i = 0; !done.load(); ++i) {
+            light->setState(i % 2 ? LightState::GREEN : LightState::RED);
+        }
+    });
+    // Each attach drops the only reference to the previous hub
+    for (uint32_t i = 0; i < 2000; ++i) {
+        light->attachEventHub(std::make_shared<SignalEventHub>(), i);
+    }
+    auto hub = std::make_shared<SignalEventHub>();
+    light->attachEventHub(hub, 7);
+    auto subscription = hub->subscribe();
+    ASSERT_TRUE(waitFor([&]() { return subscription->delivered() > 0; }));
+    done = true;
+    publisher.join();
+
+    SignalEvent event;
+    ASSERT_TRUE(subscription->tryPop(event));
+    EXPECT_EQ(event.light, 7u);
+    EXPECT_EQ(event.source, light->getKey());
+}
+
+TEST(SignalEventTest, TestUnsubscribeWhilePublishersRun) {
+    auto hub = std::make_shared<SignalEventHub>();
+    auto steady = hub->subscribe();
+    std::atomic<bool> done{false};
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 4; ++t) {
+        publishers.emplace_back([&, t]() {
+            while (!done.load()) {
+                hub->publish(SignalEvent::Kind::STATE_CHANGED, t, LightState::GREEN);
+            }
+        });
+    }
+    ASSERT_TRUE(waitFor([&]() { return steady->delivered() > 0; }));
+    // Publishers never pause together, so each change may only wait for the
+    // ones already walking the old subscriber table
+    for (int i = 0; i < 50; ++i) {
+        auto subscription = hub->subscribe();
+        ASSERT_NE(subscription, nullptr);
+        hub->unsubscribe(subscription);
+        EXPECT_FALSE(subscription->isActive());
+        if (i % 10 == 0) {
+            hub->setClock(std::make_shared<ManualClock>());
+        }
+    }
+    done = true;
+    for (auto& publisher : publishers) {
+        publisher.join();
+    }
+}
+
+TEST(SignalEventTest, TestWaitPopWakesOnPublish) {
+    SignalEventHub hub;
+    auto subscription = hub.subscribe();
+    SignalEvent event;
+    bool popped = false;
+    std::thread consumer([&]() { popped = subscription->waitPop(event, std::chrono::seconds(10)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto published = std::chrono::steady_clock::now();
+    hub.publish(SignalEvent::Kind::DURATION_CHANGED, 3, LightState::OFF, EmergencyVehicleType::NONE,
+                std::chrono::seconds(12));
+    consumer.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - published, std::chrono::seconds(1));
+    ASSERT_TRUE(popped);
+    EXPECT_EQ(event.duration, std::chrono::seconds(12));
+
+    // Unsubscribing releases a parked consumer without an event
+    std::thread parked([&]() { popped = subscription->waitPop(event, std::chrono::seconds(10)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto unsubscribed = std::chrono::steady_clock::now();
+    hub.unsubscribe(subscription);
+    parked.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - unsubscribed, std::chrono::seconds(1));
+    EXPECT_FALSE(popped);
+}
+
+TEST(IntersectionTest, TestTicklessControllerSleepsUntilChange) {
+    using namespace std::chrono_literals;
+    Intersection intersection("Tickless Intersection");
+    auto north = std::make_shared<Lane>("North", 10);
+    auto south = std::make_shared<Lane>("South", 10);
+    auto southLight = std::make_shared<TrafficLight>("South Light");
+    intersection.addLane(north, std::make_shared<TrafficLight>("North Light"));
+    intersection.addLane(south, southLight);
+    ControllerParams params;
+    params.minGreen = 200ms;
+    params.yellow = 10ms;
+    params.smoothOccupancy = false;
+    intersection.setParams(params);
+
+    intersection.start();
+    std::this_thread::sleep_for(700ms);
+    // Initial green, then one look when its minimum green ran out; a 500 ms
+    // poll would have woken at least twice more
+    uint64_t idleWakeups = intersection.getWakeupCount();
+    EXPECT_LE(idleWakeups, 3u);
+
+    // An empty lane becoming non-empty wakes the controller at once
+    south->addVehicle();
+    EXPECT_TRUE(waitFor([&]() { return southLight->getState() == LightState::GREEN; }));
+    EXPECT_LE(intersection.getWakeupCount(), idleWakeups + 2);
+
+    // Vehicles below the signal level are only activity: the controller is
+    // woken once and then re-evaluates at the activity period
+    std::this_thread::sleep_for(300ms);
+    uint64_t before = intersection.getWakeupCount();
+    for (int i = 0; i < 3; ++i) north->addVehicle();
+    for (int i = 0; i < 20 && intersection.getWakeupCount() == before; ++i) {
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_GT(intersection.getWakeupCount(), before);
+    intersection.stop();
+}
+
+TEST(RcuCellTest, TestReadersSeeWholeSnapshots) {
+    struct Pair {
+        int a = 0;
+        int b = 0;
+    };
+    RcuCell<Pair> cell(std::make_unique<Pair>());
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                auto value = cell.read();
+                if (value->a != value->b) {
+                    torn++;
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 2000; ++i) {
+        cell.update([i](Pair& next) {
+            next.a = i;
+            next.b = i;
+        });
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(cell.read()->a, 2000);
+}
+
+TEST(IntersectionTest, TestLanesReconfigureWhileControlRuns) {
+    using namespace std::chrono_literals;
+    Intersection intersection("Road Works");
+    std::vector<std::shared_ptr<TrafficLight>> lights;
+    for (int i = 0; i < 3; ++i) {
+        lights.push_back(std::make_shared<TrafficLight>("Light " + std::to_string(i)));
+        intersection.addLane(std::make_shared<Lane>("Lane " + std::to_string(i), 10), lights.back());
+    }
+    ControllerParams params;
+    params.minGreen = 20ms;
+    params.yellow = 1ms;
+    params.smoothOccupancy = false;
+    intersection.setParams(params);
+    intersection.start();
+
+    // Open and close a temporary lane and retune while the controller ticks
+    uint64_t version = intersection.getConfigVersion();
+    std::weak_ptr<Lane> closed;
+    for (int round = 0; round < 50; ++round) {
+        auto lane = std::make_shared<Lane>("Temporary", 10);
+        auto light = std::make_shared<TrafficLight>("Temporary Light");
+        lane->addVehicles(8);
+        intersection.addLane(lane, light);
+        params.saturationThreshold = round % 2 ? 0.8 : 0.6;
+        intersection.setParams(params);
+        EXPECT_TRUE(intersection.removeLane("Temporary"));
+        EXPECT_EQ(light->getState(), LightState::RED);
+        closed = lane;
+    }
+    EXPECT_FALSE(intersection.removeLane("Temporary"));
+    EXPECT_EQ(intersection.getConfigVersion(), version + 150);
+    EXPECT_EQ(intersection.getLaneCount(), 3u);
+    intersection.stop();
+    // Nothing, including the per-lane control state, keeps a closed lane alive
+    EXPECT_TRUE(closed.expired());
+
+    // Closing a lane re-numbers the events of the lanes behind it, without a
+    // phantom event for the lane that takes over the closed lane's index
+    lights[0]->setState(LightState::GREEN);
+    auto subscription = intersection.subscribe();
+    auto lastLight = lights[2]->subscribe();
+    EXPECT_TRUE(intersection.removeLane("Lane 0"));
+    EXPECT_EQ(intersection.getLight(0), lights[1]);
+    SignalEvent event;
+    EXPECT_FALSE(subscription->tryPop(event));
+    lights[2]->setState(lights[2]->getState() == LightState::GREEN ? LightState::RED : LightState::GREEN);
+    ASSERT_TRUE(subscription->tryPop(event));
+    EXPECT_EQ(event.light, 1u);
+    // A per-light subscription follows its light, not its old index
+    ASSERT_TRUE(lastLight->tryPop(event));
+    EXPECT_EQ(event.source, lights[2]->getKey());
+    lights[1]->setState(lights[1]->getState() == LightState::GREEN ? LightState::RED : LightState::GREEN);
+    EXPECT_FALSE(lastLight->tryPop(event));
+}
+
+TEST(HorizonPlannerTest, TestMatchesExhaustiveSearch) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> queue(0.0, 15.0);
+    std::uniform_real_distribution<double> rate(0.0, 1.0);
+    HorizonPlanner planner;
+    HorizonSettings settings;
+    settings.steps = 5;
+    settings.stepSeconds = 4.0;
+    settings.minGreenSeconds = 6.0;
+    settings.budget = std::chrono::seconds(1);
+    for (int trial = 0; trial < 50; ++trial) {
+        std::vector<PlannerLane> lanes(3);
+        for (auto& lane : lanes) {
+            lane.queue = queue(rng);
+            lane.arrivalRate = rate(rng);
+            lane.dischargeRate = 0.3 + rate(rng);
+            lane.weight = 1.0 + rate(rng);
+        }
+        int currentGreen = trial % 4 - 1;
+        double elapsed = trial % 3 * 3.0;
+
+        // Every sequence of 3^5 phases
+        double bestCost = std::numeric_limits<double>::infinity();
+        int phases[5];
+        for (int code = 0; code < 243; ++code) {
+            for (int step = 0, rest = code; step < 5; ++step, rest /= 3) {
+                phases[step] = rest % 3;
+            }
+            bestCost = std::min(bestCost, HorizonPlanner::sequenceCost(lanes, currentGreen, elapsed, settings, phases, 5));
+        }
+
+        HorizonPlan plan = planner.plan(lanes, currentGreen, elapsed, settings);
+        ASSERT_TRUE(plan.complete);
+        ASSERT_EQ(plan.steps, 5);
+        EXPECT_NEAR(plan.cost, bestCost, 1e-9);
+        EXPECT_NEAR(HorizonPlanner::sequenceCost(lanes, currentGreen, elapsed, settings, plan.phases, 5), plan.cost, 1e-9);
+    }
+}
+
+TEST(HorizonPlannerTest, TestBudgetReturnsBestPlanSoFar) {
+    std::vector<PlannerLane> lanes(12);
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        lanes[i].queue = static_cast<double>(i % 5) + 3.0;
+        lanes[i].arrivalRate = 0.1 * static_cast<double>(i % 4);
+        lanes[i].dischargeRate = 0.5;
+    }
+    HorizonPlanner planner;
+    HorizonSettings settings;
+    settings.steps = HorizonPlan::kMaxSteps;
+    settings.minGreenSeconds = 0.0;
+    settings.budget = std::chrono::microseconds(100);
+
+    auto begin = std::chrono::steady_clock::now();
+    HorizonPlan plan = planner.plan(lanes, 0, 30.0, settings);
+    auto spent = std::chrono::steady_clock::now() - begin;
+    EXPECT_LT(spent, std::chrono::milliseconds(20));
+    EXPECT_FALSE(plan.complete);
+    ASSERT_EQ(plan.steps, HorizonPlan::kMaxSteps);
+    EXPECT_NEAR(HorizonPlanner::sequenceCost(lanes, 0, 30.0, settings, plan.phases, plan.steps), plan.cost, 1e-6);
+
+    // Without time to search, the greedy rollout is still a usable plan
+    settings.budget = std::chrono::nanoseconds(0);
+    HorizonPlan rollout = planner.plan(lanes, 0, 30.0, settings);
+    EXPECT_EQ(rollout.steps, HorizonPlan::kMaxSteps);
+    EXPECT_LE(plan.cost, rollout.cost);
+}
+
+TEST(IntersectionTest, TestRollingHorizonPolicyServesQueue) {
+    using namespace std::chrono_literals;
+    Intersection intersection("Horizon Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+    std::vector<std::shared_ptr<Lane>> lanes;
+    for (int i = 0; i < 3; ++i) {
+        lanes.push_back(std::make_shared<Lane>("Lane " + std::to_string(i), 20));
+        intersection.addLane(lanes.back(), std::make_shared<TrafficLight>("Light " + std::to_string(i)));
+    }
+    ControllerParams params;
+    params.policy = ControlPolicy::ROLLING_HORIZON;
+    intersection.setParams(params);
+
+    lanes[2]->addVehicles(12);
+    lanes[0]->addVehicles(2);
+    intersection.step();
+    EXPECT_EQ(intersection.getLight(2)->getState(), LightState::GREEN);
+    HorizonPlan plan = intersection.getLastPlan();
+    EXPECT_TRUE(plan.complete);
+    EXPECT_EQ(plan.firstPhase(), 2);
+    // The green runs until the plan would switch, and at least four seconds
+    EXPECT_GE(intersection.getLight(2)->getDuration(), std::chrono::seconds(4));
+
+    // Once the queue has discharged the planner moves on to the waiting lane
+    clock->advance(20s);
+    lanes[2]->removeVehicles(12);
+    intersection.step();
+    EXPECT_EQ(intersection.getLight(0)->getState(), LightState::GREEN);
+}
+
+TEST(GreenWaveTest, TestFindsTwoWayBand) {
+    // 40 s links: an 80 s cycle with alternating offsets lets half of every
+    // cycle through in both directions, and no other cycle in range can
+    GreenWaveOptimizer optimizer({0.5, 0.5, 0.5, 0.5}, {40, 40, 40}, {40, 40, 40});
+    GreenWaveSettings settings;
+    settings.minCycle = 60;
+    settings.maxCycle = 100;
+    settings.threads = 2;
+    GreenWavePlan plan = optimizer.optimize(settings);
+    EXPECT_EQ(plan.cycle, 80);
+    EXPECT_DOUBLE_EQ(plan.forwardBandwidth, 40.0);
+    EXPECT_DOUBLE_EQ(plan.reverseBandwidth, 40.0);
+    EXPECT_DOUBLE_EQ(plan.efficiency, 0.5);
+    ASSERT_EQ(plan.offsets.size(), 4u);
+    EXPECT_EQ((plan.offsets[1] - plan.offsets[0] + 80) % 80, 40);
+
+    EXPECT_THROW(GreenWaveOptimizer({0.5, 0.5}, {40}, {}), std::invalid_argument);
+    EXPECT_THROW(GreenWaveOptimizer({0.5, 0.5}, {-40}, {40}), std::invalid_argument);
+    EXPECT_THROW(GreenWaveOptimizer({0.5, 0.5}, {40}, {std::numeric_limits<double>::quiet_NaN()}),
+                 std::invalid_argument);
+    settings.maxCycle = 300;
+    EXPECT_THROW(optimizer.optimize(settings), std::invalid_argument);
+}
+
+TEST(GreenWaveTest, TestLongArterialIsDeterministic) {
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> travel(15.0, 60.0);
+    std::uniform_real_distribution<double> split(0.4, 0.65);
+    std::vector<double> fractions(30), forward(29), reverse(29);
+    for (auto& fraction : fractions) fraction = split(rng);
+    for (size_t i = 0; i < forward.size(); ++i) {
+        forward[i] = travel(rng);
+        reverse[i] = forward[i] * 1.05;
+    }
+    GreenWaveOptimizer optimizer(fractions, forward, reverse);
+    GreenWaveSettings settings;
+    settings.restarts = 3;
+    settings.balance = 0.0;   // the plain weighted sum, so the start point bounds it
+    settings.threads = 1;
+    GreenWavePlan single = optimizer.optimize(settings);
+    settings.threads = 4;
+    GreenWavePlan parallel = optimizer.optimize(settings);
+    EXPECT_EQ(single.cycle, parallel.cycle);
+    EXPECT_EQ(single.offsets, parallel.offsets);
+    EXPECT_EQ(single.sweeps, parallel.sweeps);
+
+    auto bands = optimizer.bandwidth(single.cycle, single.offsets, settings.span);
+    EXPECT_DOUBLE_EQ(bands.first, single.forwardBandwidth);
+    EXPECT_DOUBLE_EQ(bands.second, single.reverseBandwidth);
+
+    // The search starts from perfect forward progression and only improves on it
+    std::vector<int> progression(fractions.size(), 0);
+    double elapsed = 0.0;
+    for (size_t i = 1; i < progression.size(); ++i) {
+        elapsed += forward[i - 1];
+        progression[i] = static_cast<int>(std::lround(elapsed)) % single.cycle;
+    }
+    auto start = optimizer.bandwidth(single.cycle, progression, settings.span);
+    EXPECT_GE(single.forwardBandwidth + single.reverseBandwidth, start.first + start.second);
+    EXPECT_GT(single.reverseBandwidth, 0.0);
+}
+
+TEST(GreenWaveTest, TestLongArterialKeepsBothBands) {
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> travel(15.0, 60.0);
+    std::uniform_real_distribution<double> split(0.4, 0.65);
+    std::vector<double> fractions(50), forward(49), reverse(49);
+    for (auto& fraction : fractions) fraction = split(rng);
+    for (size_t i = 0; i < forward.size(); ++i) {
+        forward[i] = travel(rng);
+        reverse[i] = forward[i] * std::uniform_real_distribution<double>(0.9, 1.1)(rng);
+    }
+    GreenWaveOptimizer optimizer(fractions, forward, reverse);
+    GreenWaveSettings settings;
+    settings.restarts = 3;
+    settings.threads = 4;
+
+    // Unconstrained, the weighted sum gives up most of one direction
+    settings.balance = 0.0;
+    GreenWavePlan free = optimizer.optimize(settings);
+    EXPECT_LT(std::min(free.forwardBandwidth, free.reverseBandwidth),
+              0.5 * std::max(free.forwardBandwidth, free.reverseBandwidth));
+
+    settings.balance = 0.5;
+    GreenWavePlan balanced = optimizer.optimize(settings);
+    EXPECT_GE(balanced.reverseBandwidth, 0.5 * balanced.forwardBandwidth);
+    EXPECT_GE(balanced.forwardBandwidth, 0.5 * balanced.reverseBandwidth);
+    EXPECT_GT(std::min(balanced.forwardBandwidth, balanced.reverseBandwidth), 0.1 * balanced.cycle);
+
+    settings.balance = 1.5;
+    EXPECT_THROW(optimizer.optimize(settings), std::invalid_argument);
+}
+
+TEST(IntersectionTest, TestCoordinationPlanDrivesPhases) {
+    using namespace std::chrono_literals;
+    Intersection intersection("Coordinated Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+    auto main = std::make_shared<Lane>("Main", 20);
+    auto side = std::make_shared<Lane>("Side", 20);
+    intersection.addLane(main, std::make_shared<TrafficLight>("Main Light"));
+    intersection.addLane(side, std::make_shared<TrafficLight>("Side Light"));
+
+    CoordinationPlan plan;
+    plan.epoch = clock->now();
+    plan.cycle = 60s;
+    plan.offset = 10s;
+    plan.green = 30s;
+    plan.arterialLanes = {"Main"};
+    EXPECT_THROW(intersection.setCoordinationPlan(CoordinationPlan{}), std::invalid_argument);
+    plan.arterialLanes = {"Nowhere"};
+    EXPECT_THROW(intersection.setCoordinationPlan(plan), std::invalid_argument);
+    plan.arterialLanes = {"Main"};
+    intersection.setCoordinationPlan(plan);
+    EXPECT_TRUE(intersection.isCoordinated());
+
+    // 50 s into the cycle: the cross street's phase, whatever the queues say
+    main->addVehicles(10);
+    intersection.step();
+    EXPECT_EQ(intersection.getLight(1)->getState(), LightState::GREEN);
+    EXPECT_EQ(intersection.getLight(0)->getState(), LightState::RED);
+
+    // The arterial phase starts at the offset and its green runs to the phase end
+    clock->advanceTo(plan.epoch + 10s);
+    intersection.step();
+    EXPECT_EQ(intersection.getLight(0)->getState(), LightState::GREEN);
+    EXPECT_EQ(intersection.getLight(1)->getState(), LightState::RED);
+    EXPECT_EQ(intersection.getLight(0)->getDuration(), 30s);
+
+    // A cross street about to spill back hands control to the local policy
+    clock->advanceTo(plan.epoch + 20s);
+    side->addVehicles(19);
+    intersection.step();
+    EXPECT_EQ(intersection.getLight(1)->getState(), LightState::GREEN);
+
+    intersection.clearCoordinationPlan();
+    EXPECT_FALSE(intersection.isCoordinated());
+}
+
+TEST(CApiTest, TestStepAndReadStateArrays) {
+    EXPECT_EQ(stl_abi_version(), static_cast<uint32_t>(STL_ABI_VERSION));
+    stl_network* network = stl_network_create();
+    ASSERT_NE(network, nullptr);
+
+    stl_intersection first = 0;
+    stl_intersection second = 0;
+    ASSERT_EQ(stl_network_add_intersection(network, "First", &first), STL_OK);
+    ASSERT_EQ(stl_network_add_intersection(network, "Second", &second), STL_OK);
+    std::vector<stl_lane> lanes(4);
+    ASSERT_EQ(stl_network_add_lane(network, first, "North", 10, &lanes[0]), STL_OK);
+    ASSERT_EQ(stl_network_add_lane(network, second, "East", 10, &lanes[1]), STL_OK);
+    ASSERT_EQ(stl_network_add_lane(network, first, "South", 10, &lanes[2]), STL_OK);
+    ASSERT_EQ(stl_network_add_lane(network, second, "West", 10, &lanes[3]), STL_OK);
+    for (stl_lane i = 0; i < 4; ++i) {
+        EXPECT_EQ(lanes[i], i);
+    }
+
+    int32_t applied = 0;
+    ASSERT_EQ(stl_lane_arrive(network, lanes[2], 15, &applied), STL_OK);
+    EXPECT_EQ(applied, 10);
+    ASSERT_EQ(stl_lane_arrive(network, lanes[3], 4, nullptr), STL_OK);
+    ASSERT_EQ(stl_network_step(network, 1000), STL_OK);
+
+    // The arrays are read in place, indexed by lane handle
+    stl_state_view state{};
+    EXPECT_EQ(stl_network_state(network, &state), STL_INVALID_ARGUMENT);
+    state.struct_size = sizeof(state);
+    ASSERT_EQ(stl_network_state(network, &state), STL_OK);
+    ASSERT_EQ(state.lane_count, 4u);
+    EXPECT_EQ(state.step_count, 1u);
+    EXPECT_EQ(state.vehicle_counts[2], 10);
+    EXPECT_EQ(state.vehicle_counts[3], 4);
+    EXPECT_EQ(state.light_states[2], STL_LIGHT_GREEN);
+    EXPECT_EQ(state.light_states[0], STL_LIGHT_RED);
+    EXPECT_EQ(state.light_states[3], STL_LIGHT_GREEN);
+
+    ASSERT_EQ(stl_lane_depart(network, lanes[2], 3, &applied), STL_OK);
+    EXPECT_EQ(applied, 3);
+    EXPECT_EQ(state.vehicle_counts[2], 7);
+
+    // Preemption takes effect on the next tick, at the reporting intersection only
+    ASSERT_EQ(stl_lane_report_emergency(network, lanes[0], STL_EMERGENCY_AMBULANCE), STL_OK);
+    ASSERT_EQ(stl_network_step(network, 1000), STL_OK);
+    EXPECT_EQ(state.light_states[0], STL_LIGHT_GREEN);
+    EXPECT_EQ(state.light_states[2], STL_LIGHT_RED);
+    EXPECT_EQ(state.light_states[3], STL_LIGHT_GREEN);
+    ASSERT_EQ(stl_lane_clear_emergency(network, lanes[0]), STL_OK);
+
+    EXPECT_EQ(stl_lane_arrive(network, 99, 1, nullptr), STL_INVALID_ARGUMENT);
+    EXPECT_NE(std::string(stl_last_error()).find("unknown lane"), std::string::npos);
+    EXPECT_EQ(stl_lane_report_emergency(network, lanes[0], 42), STL_INVALID_ARGUMENT);
+    EXPECT_EQ(stl_network_add_lane(network, 7, "Nowhere", 10, &lanes[0]), STL_INVALID_ARGUMENT);
+
+    // A caller that only knows the first fields gets nothing past them
+    stl_state_view shorter;
+    std::memset(&shorter, 0xAB, sizeof(shorter));
+    shorter.struct_size = offsetof(stl_state_view, vehicle_counts);
+    ASSERT_EQ(stl_network_state(network, &shorter), STL_OK);
+    EXPECT_EQ(shorter.lane_count, 4u);
+    EXPECT_EQ(shorter.step_count, 0xABABABABABABABABu);
+    stl_network_destroy(network);
+}
+
+extern "C" int stl_c_api_smoke(void);
+
+TEST(CApiTest, TestHeaderCompilesAsC) {
+    EXPECT_EQ(stl_c_api_smoke(), 0);
+}
+
+TEST(ArenaNetworkTest, TestMatchesIntersectionDecisions) {
+    using namespace std::chrono_literals;
+    ControllerParams params;
+    params.smoothOccupancy = false;
+    Intersection intersection("Reference Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+    intersection.setParams(params);
+    ArenaNetwork network(1, 4, params);
+    ArenaIntersection junction = network.addIntersection();
+    std::vector<std::shared_ptr<Lane>> lanes;
+    std::vector<ArenaLane> handles;
+    for (int i = 0; i < 4; ++i) {
+        lanes.push_back(std::make_shared<Lane>("Lane " + std::to_string(i), 10));
+        intersection.addLane(lanes.back(), std::make_shared<TrafficLight>("Light " + std::to_string(i)));
+        handles.push_back(network.addLane(junction, 10));
+    }
+
+    std::mt19937 rng(11);
+    auto start = clock->now();
+    for (int step = 1; step <= 3000; ++step) {
+        size_t lane = rng() % 4;
+        int count = static_cast<int>(rng() % 4);
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(lanes[lane]->removeVehicles(count), network.removeVehicles(handles[lane], count));
+        } else {
+            EXPECT_EQ(lanes[lane]->addVehicles(count), network.addVehicles(handles[lane], count));
+        }
+        if (step % 97 == 0) {
+            intersection.reportEmergencyVehicle(lane, EmergencyVehicleType::POLICE);
+            network.reportEmergencyVehicle(handles[lane], EmergencyVehicleType::POLICE);
+        }
+        if (step % 97 == 20) {
+            for (size_t i = 0; i < 4; ++i) {
+                intersection.clearEmergencyVehicle(i);
+                network.clearEmergencyVehicle(handles[i]);
+            }
+        }
+        if (step % 131 == 0) {
+            intersection.requestPedestrianCrossing();
+            network.requestPedestrianCrossing(junction);
+        }
+        if (step % 131 == 10) {
+            intersection.clearPedestrianCrossing();
+            network.clearPedestrianCrossing(junction);
+        }
+
+        auto now = start + std::chrono::seconds(2 * step);
+        clock->advanceTo(now);
+        intersection.step();
+        network.step(now);
+        for (size_t i = 0; i < 4; ++i) {
+            ASSERT_EQ(intersection.getLight(i)->getState(), network.getLightState(handles[i])) << "step " << step;
+            if (network.getLightState(handles[i]) == LightState::GREEN) {
+                EXPECT_EQ(intersection.getLight(i)->getDuration(), network.getGreenDuration(junction));
+            }
+        }
+    }
+}
+
+TEST(ArenaNetworkTest, TestSmoothedOccupancyTracksLaneStatistics) {
+    // With default params decisions use the smoothed occupancy, which the
+    // arena keeps in float; it must follow LaneStatistics to that precision
+    Intersection intersection("Reference Intersection");
+    auto clock = std::make_shared<ManualClock>();
+    intersection.setClock(clock);
+    ArenaNetwork network(1, 4);
+    ArenaIntersection junction = network.addIntersection();
+    std::vector<std::shared_ptr<Lane>> lanes;
+    std::vector<ArenaLane> handles;
+    for (int i = 0; i < 4; ++i) {
+        lanes.push_back(std::make_shared<Lane>("Lane " + std::to_string(i), 10));
+        intersection.addLane(lanes.back(), std::make_shared<TrafficLight>("Light " + std::to_string(i)));
+        handles.push_back(network.addLane(junction, 10));
+    }
+
+    std::mt19937 rng(5);
+    auto start = clock->now();
+    int agreeing = 0;
+    for (int step = 1; step <= 3000; ++step) {
+        size_t lane = rng() % 4;
+        int count = static_cast<int>(rng() % 4);
+        if (rng() % 3 == 0) {
+            lanes[lane]->removeVehicles(count);
+            network.removeVehicles(handles[lane], count);
+        } else {
+            lanes[lane]->addVehicles(count);
+            network.addVehicles(handles[lane], count);
+        }
+        auto now = start + std::chrono::seconds(2 * step);
+        clock->advanceTo(now);
+        intersection.step();
+        network.step(now);
+        bool same = true;
+        for (size_t i = 0; i < 4; ++i) {
+            ASSERT_NEAR(lanes[i]->getStatistics().smoothedOccupancy(), network.getSmoothedOccupancy(handles[i]), 1e-5);
+            same = same && intersection.getLight(i)->getState() == network.getLightState(handles[i]);
+        }
+        agreeing += same;
+    }
+    // Only near-ties between lanes can resolve differently
+    EXPECT_GT(agreeing, 2700);
+}
+
+TEST(ArenaNetworkTest, TestHandlesCapacityAndFootprint) {
+    ArenaNetwork network(2, 5);
+    ArenaIntersection first = network.addIntersection();
+    EXPECT_EQ(network.addLane(first, 10), 0u);
+    EXPECT_EQ(network.addLane(first, 10), 1u);
+    ArenaIntersection second = network.addIntersection();
+    EXPECT_THROW(network.addLane(first, 10), std::invalid_argument);
+    EXPECT_EQ(network.addLane(second, 20), 2u);
+    EXPECT_EQ(network.addLane(second, 20), 3u);
+    EXPECT_EQ(network.addLane(second, 20), 4u);
+    EXPECT_THROW(network.addLane(second, 20), std::runtime_error);
+    EXPECT_THROW(network.addIntersection(), std::runtime_error);
+    EXPECT_EQ(network.getIntersection(1), first);
+    EXPECT_EQ(network.getIntersection(2), second);
+    EXPECT_THROW(network.getVehicleCount(5), std::out_of_range);
+
+    EXPECT_EQ(network.addVehicles(2, 25), 20);
+    EXPECT_EQ(network.removeVehicles(2, 30), 20);
+    EXPECT_THROW(ArenaNetwork(0, 1), std::invalid_argument);
+    ControllerParams horizon;
+    horizon.policy = ControlPolicy::ROLLING_HORIZON;
+    EXPECT_THROW(ArenaNetwork(1, 1, horizon), std::invalid_argument);
+
+    // At scale the padding vanishes: a lane costs its six arrays plus a
+    // share of its intersection's state
+    ArenaNetwork large(250000, 1000000);
+    EXPECT_LT(large.getBytesPerLane(), 24.0);
+    EXPECT_EQ(large.getArenaBytes(), static_cast<size_t>(large.getBytesPerLane() * 1000000 + 0.5));
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
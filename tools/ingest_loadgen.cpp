@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "IngestServer.hpp"
+
+// Load generator for IngestServer. Streams batched vehicle arrival/departure
+// records over N connections and reports the achieved event rate. Without
+// --socket or --tcp it hosts a server in-process on a temporary Unix socket
+// and measures until every record has been applied.
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: ingest_loadgen [--socket PATH | --tcp PORT] [--connections N] [--events N]\n"
+                 "                      [--batch N] [--intersections N] [--lanes N]\n";
+}
+
+int connectTo(const std::string& socketPath, int tcpPort) {
+    int fd;
+    if (tcpPort > 0) {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(tcpPort));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+    } else {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Alternating arrivals and departures keep the lanes below capacity
+bool runClient(const std::string& socketPath, int tcpPort, size_t events, uint32_t batch,
+               uint32_t intersections, uint32_t lanes, unsigned seed) {
+    int fd = connectTo(socketPath, tcpPort);
+    if (fd < 0) {
+        return false;
+    }
+    std::vector<ingest::Record> records(batch);
+    std::vector<uint8_t> frame(ingest::frameBytes(batch));
+    uint64_t sequence = seed;
+    size_t remaining = events;
+    bool ok = true;
+    while (remaining > 0 && ok) {
+        auto count = static_cast<uint32_t>(std::min<size_t>(batch, remaining));
+        for (uint32_t i = 0; i < count; ++i, ++sequence) {
+            records[i].kind = (sequence & 1) ? ingest::RecordKind::VEHICLE_DEPARTURES
+                                             : ingest::RecordKind::VEHICLE_ARRIVALS;
+            records[i].vehicle = 0;
+            records[i].intersection = static_cast<uint32_t>((sequence / 2) % intersections);
+            records[i].lane = static_cast<uint16_t>((sequence / 2 / intersections) % lanes);
+            records[i].value = 1;
+        }
+        size_t bytes = ingest::encodeFrame(records.data(), count, frame.data());
+        ok = sendAll(fd, frame.data(), bytes);
+        remaining -= count;
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string socketPath;
+    int tcpPort = 0;
+    unsigned connections = 4;
+    size_t events = 5000000;
+    uint32_t batch = 512;
+    uint32_t intersectionCount = 64;
+    uint32_t laneCount = 4;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--tcp" && i + 1 < argc) {
+            tcpPort = std::atoi(argv[++i]);
+        } else if (arg == "--connections" && i + 1 < argc) {
+            connections = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--events" && i + 1 < argc) {
+            events = static_cast<size_t>(std::atoll(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--intersections" && i + 1 < argc) {
+            intersectionCount = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--lanes" && i + 1 < argc) {
+            laneCount = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (batch == 0 || batch > ingest::kMaxRecordsPerBatch) {
+        std::cerr << "--batch must be between 1 and " << ingest::kMaxRecordsPerBatch << "\n";
+        return 2;
+    }
+
+    std::unique_ptr<IngestServer> server;
+    if (socketPath.empty() && tcpPort == 0) {
+        std::vector<std::shared_ptr<Intersection>> intersections;
+        for (uint32_t i = 0; i < intersectionCount; ++i) {
+            auto intersection = std::make_shared<Intersection>("Loadgen " + std::to_string(i));
+            for (uint32_t lane = 0; lane < laneCount; ++lane) {
+                intersection->addLane(std::make_shared<Lane>("Lane " + std::to_string(lane), 1000),
+                                      std::make_shared<TrafficLight>("Light " + std::to_string(lane)));
+            }
+            intersections.push_back(intersection);
+        }
+        socketPath = "/tmp/ingest_loadgen_" + std::to_string(::getpid()) + ".sock";
+        try {
+            server = std::make_unique<IngestServer>(intersections);
+            server->listenUnix(socketPath);
+            server->start();
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    std::vector<char> results(connections, 0);
+    for (unsigned c = 0; c < connections; ++c) {
+        size_t share = events / connections + (c < events % connections ? 1 : 0);
+        clients.emplace_back([&, c, share]() {
+            results[c] = runClient(socketPath, tcpPort, share, batch, intersectionCount, laneCount, c * 7919u);
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    for (char ok : results) {
+        if (!ok) {
+            std::cerr << "connection to " << (tcpPort > 0 ? "port " + std::to_string(tcpPort) : socketPath)
+                      << " failed" << std::endl;
+            return 1;
+        }
+    }
+
+    if (server) {
+        while (server->getStats().records < events) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << events << " events over " << connections << " connection(s) in "
+              << seconds << " s: " << static_cast<uint64_t>(events / seconds) << " events/s" << std::endl;
+    if (server) {
+        auto stats = server->getStats();
+        std::cout << "server applied " << stats.records << " records in " << stats.frames << " frames, "
+                  << stats.recordsRejected << " rejected, " << stats.protocolErrors << " protocol errors"
+                  << std::endl;
+        server->stop();
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "PolicySweep.hpp"
+
+// Sweeps controller constants over a grid, simulating many seeded days per
+// grid point on all cores, and prints the configurations ranked by cost.
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: policy_sweep [--scenario FILE] [--runs N] [--duration S] [--threads N] [--seed N] [--top K]\n"
+              << "                    [--threshold LIST] [--min-green LIST] [--base-green LIST]\n"
+              << "                    [--green-range LIST] [--emergency-green LIST] [--yellow LIST]\n"
+              << "                    [--policy LIST]\n"
+              << "  LIST is comma separated; green and yellow times are in seconds.\n"
+              << "  Policies are greedy and horizon (rolling-horizon search).\n"
+              << "  Without --scenario the live demo traffic is simulated for --duration seconds (default one day).\n";
+}
+
+std::vector<double> parseList(const std::string& text) {
+    std::vector<double> values;
+    std::stringstream stream(text);
+    for (std::string item; std::getline(stream, item, ',');) {
+        values.push_back(std::stod(item));
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("empty list");
+    }
+    return values;
+}
+
+template <typename Duration>
+std::vector<Duration> parseDurations(const std::string& text) {
+    std::vector<Duration> durations;
+    for (double seconds : parseList(text)) {
+        durations.push_back(std::chrono::duration_cast<Duration>(std::chrono::duration<double>(seconds)));
+    }
+    return durations;
+}
+
+std::vector<ControlPolicy> parsePolicies(const std::string& text) {
+    std::vector<ControlPolicy> policies;
+    std::stringstream stream(text);
+    for (std::string item; std::getline(stream, item, ',');) {
+        if (item == "greedy") {
+            policies.push_back(ControlPolicy::GREEDY);
+        } else if (item == "horizon") {
+            policies.push_back(ControlPolicy::ROLLING_HORIZON);
+        } else {
+            throw std::invalid_argument("unknown policy: " + item);
+        }
+    }
+    if (policies.empty()) {
+        throw std::invalid_argument("empty list");
+    }
+    return policies;
+}
+
+const char* policyName(ControlPolicy policy) {
+    return policy == ControlPolicy::ROLLING_HORIZON ? "horizon" : "greedy";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Scenario scenario = Scenario::demo();
+    scenario.name = "demo_day";
+    scenario.duration = 24 * 3600.0;
+    ParameterGrid grid;
+    size_t runs = 100;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    size_t top = 10;
+    double duration = -1.0;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                printUsage();
+                return 2;
+            }
+            std::string value = argv[++i];
+            if (arg == "--scenario") scenario = Scenario::loadFile(value).front();
+            else if (arg == "--runs") runs = std::stoul(value);
+            else if (arg == "--duration") {
+                duration = std::stod(value);
+                if (!std::isfinite(duration) || duration <= 0.0) {
+                    throw std::invalid_argument("--duration must be a positive number of seconds");
+                }
+            }
+            else if (arg == "--threads") threads = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--seed") seed = std::stoull(value);
+            else if (arg == "--top") top = std::stoul(value);
+            else if (arg == "--threshold") grid.saturationThresholds = parseList(value);
+            else if (arg == "--min-green") grid.minGreens = parseDurations<std::chrono::milliseconds>(value);
+            else if (arg == "--base-green") grid.baseGreens = parseDurations<std::chrono::seconds>(value);
+            else if (arg == "--green-range") grid.greenRanges = parseDurations<std::chrono::seconds>(value);
+            else if (arg == "--emergency-green") grid.emergencyGreens = parseDurations<std::chrono::seconds>(value);
+            else if (arg == "--yellow") grid.yellows = parseDurations<std::chrono::milliseconds>(value);
+            else if (arg == "--policy") grid.policies = parsePolicies(value);
+            else {
+                printUsage();
+                return 2;
+            }
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "policy_sweep: " << error.what() << std::endl;
+        return 2;
+    }
+    if (duration > 0.0) {
+        scenario.duration = duration;
+    }
+
+    auto points = grid.expand();
+    std::cerr << "Sweeping " << points.size() << " configurations x " << runs << " runs of "
+              << scenario.duration << " simulated seconds (" << scenario.name << ")" << std::endl;
+
+    auto started = std::chrono::steady_clock::now();
+    PolicySweep sweep(scenario, threads);
+    std::vector<SweepPointResult> results;
+    try {
+        results = sweep.run(points, runs, seed);
+    } catch (const std::exception& error) {
+        std::cerr << "policy_sweep: " << error.what() << std::endl;
+        return 2;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << std::setw(5) << "rank" << std::setw(9) << "policy" << std::setw(7) << "thresh" << std::setw(8) << "minG s"
+              << std::setw(8) << "baseG s" << std::setw(8) << "rangeG s" << std::setw(8) << "emerG s"
+              << std::setw(8) << "yellow" << std::setw(11) << "delay s" << std::setw(12) << "starve s"
+              << std::setw(11) << "emerg s" << std::setw(8) << "missed" << std::setw(10) << "score" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < results.size() && i < top; ++i) {
+        const auto& result = results[i];
+        const auto& params = result.params;
+        std::cout << std::setw(5) << i + 1
+                  << std::setw(9) << policyName(params.policy)
+                  << std::setw(7) << params.saturationThreshold
+                  << std::setw(8) << params.minGreen.count() / 1000.0
+                  << std::setw(8) << params.baseGreen.count()
+                  << std::setw(8) << params.greenRange.count()
+                  << std::setw(8) << params.emergencyGreen.count()
+                  << std::setw(8) << params.yellow.count() / 1000.0
+                  << std::setw(11) << result.meanDelay
+                  << std::setw(12) << result.meanStarvation
+                  << std::setw(11) << result.meanEmergencyLatency
+                  << std::setw(8) << result.emergenciesMissed
+                  << std::setw(10) << result.score << "\n";
+    }
+    std::cerr << "Simulated " << points.size() * runs * scenario.duration / 86400.0 << " days in "
+              << elapsed << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ScenarioEngine.hpp"
+
+// Runs scenario files against independent intersections in parallel and
+// reports per-scenario and aggregate outcomes. Exits non-zero when a limit
+// given on the command line is exceeded or a scenario fails to run, so it
+// can gate CI jobs.
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: scenario_runner [--threads N] [--max-latency S] [--max-queue N] FILE...\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned threads = 0;
+    double maxLatency = -1.0;
+    int maxQueue = -1;
+    std::vector<Scenario> scenarios;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc) {
+                threads = static_cast<unsigned>(std::atoi(argv[++i]));
+            } else if (arg == "--max-latency" && i + 1 < argc) {
+                maxLatency = std::atof(argv[++i]);
+            } else if (arg == "--max-queue" && i + 1 < argc) {
+                maxQueue = std::atoi(argv[++i]);
+            } else if (!arg.empty() && arg[0] == '-') {
+                printUsage();
+                return 2;
+            } else {
+                auto loaded = Scenario::loadFile(arg);
+                scenarios.insert(scenarios.end(), loaded.begin(), loaded.end());
+            }
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 2;
+    }
+    if (scenarios.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    ScenarioEngine engine(threads);
+    auto results = engine.runAll(scenarios);
+
+    std::cout << std::left << std::setw(24) << "scenario"
+              << std::right << std::setw(10) << "sim s"
+              << std::setw(8) << "emerg"
+              << std::setw(12) << "mean lat s"
+              << std::setw(11) << "max lat s"
+              << std::setw(10) << "max queue"
+              << std::setw(12) << "mean delay"
+              << std::setw(12) << "starvation" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& result : results) {
+        if (!result.error.empty()) {
+            std::cout << std::left << std::setw(24) << result.name << " FAILED: " << result.error << "\n";
+            continue;
+        }
+        std::cout << std::left << std::setw(24) << result.name
+                  << std::right << std::setw(10) << result.simulatedSeconds
+                  << std::setw(8) << result.emergencies
+                  << std::setw(12) << result.meanPreemptionLatency
+                  << std::setw(11) << result.maxPreemptionLatency
+                  << std::setw(10) << result.maxQueue
+                  << std::setw(12) << result.meanDelay
+                  << std::setw(12) << result.maxStarvation << "\n";
+    }
+
+    auto summary = ScenarioEngine::summarize(results);
+    std::cout << "\n" << summary.scenarios << " scenarios, "
+              << summary.emergenciesServed << "/" << summary.emergencies << " emergencies served, "
+              << "preemption latency mean " << summary.meanPreemptionLatency
+              << " s max " << summary.maxPreemptionLatency << " s, "
+              << "max queue " << summary.maxQueue << ", "
+              << "mean delay " << summary.meanDelay << " s\n";
+
+    bool failed = false;
+    if (summary.failed > 0) {
+        std::cerr << "FAIL: " << summary.failed << " scenario(s) could not be run\n";
+        failed = true;
+    }
+    if (maxLatency >= 0.0 && summary.maxPreemptionLatency > maxLatency) {
+        std::cerr << "FAIL: preemption latency " << summary.maxPreemptionLatency << " s exceeds " << maxLatency << " s\n";
+        failed = true;
+    }
+    if (maxQueue >= 0 && summary.maxQueue > maxQueue) {
+        std::cerr << "FAIL: queue " << summary.maxQueue << " exceeds " << maxQueue << "\n";
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}